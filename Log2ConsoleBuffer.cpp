@@ -0,0 +1,66 @@
+#include "Log2ConsoleBuffer.h"
+
+const std::size_t LogBuffer::kPoolSize;
+const std::size_t LogBuffer::kMaxRetainedCapacity;
+
+namespace {
+    // Capacity a new pooled buffer starts with, enough for a typical XML event
+    const std::size_t kInitialCapacity = 1024;
+
+    // Trivially destructible, so still readable while and after thread-local destructors run
+    thread_local bool t_poolDestroyed = false;
+
+    struct BufferPool {
+        std::string* free[LogBuffer::kPoolSize] = {};
+        std::size_t count = 0;
+
+        ~BufferPool() {
+            for (std::size_t i = 0; i < count; i++) {
+                delete free[i];
+            }
+            count = 0;
+            t_poolDestroyed = true;
+        }
+    };
+
+    BufferPool* GetPool() {
+        if (t_poolDestroyed) {
+            // Logging from a thread-local or static destructor after the pool is gone
+            return nullptr;
+        }
+        static thread_local BufferPool pool;
+        return &pool;
+    }
+}
+
+LogBuffer::LogBuffer()
+    : m_buffer(nullptr)
+    , m_pooled(false)
+{
+    BufferPool* pool = GetPool();
+    if (pool && pool->count > 0) {
+        m_buffer = pool->free[--pool->count];
+        m_pooled = true;
+        return;
+    }
+
+    m_buffer = new std::string();
+    m_buffer->reserve(kInitialCapacity);
+    m_pooled = pool != nullptr;
+}
+
+LogBuffer::~LogBuffer() {
+    BufferPool* pool = m_pooled ? GetPool() : nullptr;
+    if (!pool || pool->count == kPoolSize) {
+        delete m_buffer;
+        return;
+    }
+
+    if (m_buffer->capacity() > kMaxRetainedCapacity) {
+        std::string().swap(*m_buffer);
+        m_buffer->reserve(kInitialCapacity);
+    } else {
+        m_buffer->clear();
+    }
+    pool->free[pool->count++] = m_buffer;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Formatting buffer borrowed from a per-thread pool of recycled strings. It is handed back cleared
+// but with its capacity when the LogBuffer goes out of scope, so once a thread has logged a few
+// events, formatting and sending them reuses memory instead of allocating.
+class LogBuffer {
+public:
+    // Buffers kept per thread; more nested LogBuffers than this fall back to plain allocation
+    static const std::size_t kPoolSize = 8;
+
+    // Buffers that grew beyond this are released instead of pooled, so one huge event does not
+    // pin the memory for the lifetime of the thread
+    static const std::size_t kMaxRetainedCapacity = 256 * 1024;
+
+    LogBuffer();
+    ~LogBuffer();
+
+    LogBuffer(const LogBuffer&) = delete;
+    LogBuffer& operator=(const LogBuffer&) = delete;
+
+    std::string& operator*() { return *m_buffer; }
+    const std::string& operator*() const { return *m_buffer; }
+    std::string* operator->() { return m_buffer; }
+    const std::string* operator->() const { return m_buffer; }
+
+private:
+    std::string* m_buffer;
+    bool m_pooled;
+};
@@ -0,0 +1,228 @@
+#include "Log2ConsoleClock.h"
+#include "PlatformUtils.h"
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <mutex>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <cpuid.h>
+    #include <x86intrin.h>
+    #define LTC_HAS_TSC
+#elif defined(_M_X64) || defined(_M_IX86)
+    #include <intrin.h>
+    #define LTC_HAS_TSC
+#endif
+
+#ifdef LTC_PLATFORM_LINUX
+    #include <time.h>
+#endif
+
+namespace {
+    std::atomic<int> g_clockSource(static_cast<int>(ClockSource::System));
+
+    const std::chrono::seconds kReanchorInterval(1);
+
+    // Rate changes between anchors above this are taken for a stepped system clock, not drift
+    const double kMaxRateChange = 0.001;
+
+    // TSC anchor: nanos = baseNanos + (tsc - baseTicks) * nanosPerTick. Published as a sequence lock
+    // (odd while being written), so readers take no lock and retry only during a re-anchor.
+    std::mutex g_calibrationMutex;
+    bool g_tscCalibrated = false;
+    std::atomic<std::uint32_t> g_tscSequence(0);
+    std::atomic<std::uint64_t> g_tscBaseTicks(0);
+    std::atomic<std::int64_t> g_tscBaseNanos(0);
+    std::atomic<double> g_tscNanosPerTick(0.0);
+    std::chrono::steady_clock::time_point g_nextReanchor;
+
+    std::int64_t SystemNanos() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    std::int64_t CoarseNanos() {
+#ifdef LTC_PLATFORM_WINDOWS
+        FILETIME ft;
+        GetSystemTimeAsFileTime(&ft);
+        std::uint64_t ticks = (static_cast<std::uint64_t>(ft.dwHighDateTime) << 32) | ft.dwLowDateTime;
+        // FILETIME counts 100ns intervals since 1601-01-01
+        return static_cast<std::int64_t>(ticks - 116444736000000000ULL) * 100;
+#else
+        struct timespec ts;
+        if (clock_gettime(CLOCK_REALTIME_COARSE, &ts) != 0) {
+            return SystemNanos();
+        }
+        return static_cast<std::int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+#endif
+    }
+
+#ifdef LTC_HAS_TSC
+    std::int64_t TscNanos() {
+        std::uint64_t ticks = __rdtsc();
+        for (;;) {
+            std::uint32_t sequence = g_tscSequence.load(std::memory_order_acquire);
+            std::uint64_t baseTicks = g_tscBaseTicks.load(std::memory_order_relaxed);
+            std::int64_t baseNanos = g_tscBaseNanos.load(std::memory_order_relaxed);
+            double nanosPerTick = g_tscNanosPerTick.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if ((sequence & 1) == 0 && g_tscSequence.load(std::memory_order_relaxed) == sequence) {
+                return baseNanos + static_cast<std::int64_t>(static_cast<double>(
+                    static_cast<std::int64_t>(ticks - baseTicks)) * nanosPerTick);
+            }
+        }
+    }
+
+    // g_calibrationMutex must be held
+    void PublishTscAnchor(std::uint64_t baseTicks, std::int64_t baseNanos, double nanosPerTick) {
+        std::uint32_t sequence = g_tscSequence.load(std::memory_order_relaxed);
+        g_tscSequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        g_tscBaseTicks.store(baseTicks, std::memory_order_relaxed);
+        g_tscBaseNanos.store(baseNanos, std::memory_order_relaxed);
+        g_tscNanosPerTick.store(nanosPerTick, std::memory_order_relaxed);
+        g_tscSequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    // A TSC whose rate varies with frequency scaling or stops in deep C-states cannot be scaled
+    // to wall time (CPUID 0x80000007, EDX bit 8)
+    bool HasInvariantTsc() {
+    #if defined(_MSC_VER)
+        int registers[4];
+        __cpuid(registers, 0x80000000);
+        if (static_cast<unsigned int>(registers[0]) < 0x80000007u) {
+            return false;
+        }
+        __cpuid(registers, 0x80000007);
+        return (registers[3] & (1 << 8)) != 0;
+    #else
+        unsigned int eax, ebx, ecx, edx;
+        if (__get_cpuid_max(0x80000000u, nullptr) < 0x80000007u ||
+            !__get_cpuid(0x80000007u, &eax, &ebx, &ecx, &edx)) {
+            return false;
+        }
+        return (edx & (1u << 8)) != 0;
+    #endif
+    }
+#endif
+}
+
+bool Log2ConsoleClock::SetSource(ClockSource source) {
+    if (source == ClockSource::Tsc && !CalibrateTsc()) {
+        return false;
+    }
+
+    g_clockSource.store(static_cast<int>(source), std::memory_order_release);
+    return true;
+}
+
+ClockSource Log2ConsoleClock::GetSource() {
+    return static_cast<ClockSource>(g_clockSource.load(std::memory_order_acquire));
+}
+
+LogTimestamp Log2ConsoleClock::Now() {
+    switch (static_cast<ClockSource>(g_clockSource.load(std::memory_order_acquire))) {
+        case ClockSource::RealtimeCoarse:
+            return LogTimestamp{CoarseNanos()};
+#ifdef LTC_HAS_TSC
+        case ClockSource::Tsc:
+            return LogTimestamp{TscNanos()};
+#endif
+        default:
+            return LogTimestamp{SystemNanos()};
+    }
+}
+
+void Log2ConsoleClock::AppendLocalTime(const LogTimestamp& timestamp, std::string& out) {
+    struct CachedSecond {
+        std::int64_t second = -1;
+        char text[32] = {};
+        std::size_t length = 0;
+    };
+    static thread_local CachedSecond cache;
+
+    std::int64_t millis = timestamp.MillisSinceEpoch();
+    std::int64_t second = millis / 1000;
+    int ms = static_cast<int>(millis % 1000);
+
+    if (second != cache.second) {
+        std::time_t time = static_cast<std::time_t>(second);
+        std::tm tm{};
+#ifdef WIN32
+        localtime_s(&tm, &time);
+#else
+        localtime_r(&time, &tm);
+#endif
+        cache.length = std::strftime(cache.text, sizeof(cache.text), "%Y-%m-%d %H:%M:%S", &tm);
+        cache.second = second;
+    }
+
+    out.append(cache.text, cache.length);
+    out += '.';
+    out += static_cast<char>('0' + ms / 100);
+    out += static_cast<char>('0' + (ms / 10) % 10);
+    out += static_cast<char>('0' + ms % 10);
+}
+
+bool Log2ConsoleClock::CalibrateTsc() {
+#ifdef LTC_HAS_TSC
+    std::lock_guard<std::mutex> lock(g_calibrationMutex);
+
+    if (g_tscCalibrated) {
+        return true;
+    }
+    if (!HasInvariantTsc()) {
+        return false;
+    }
+
+    std::int64_t startNanos = SystemNanos();
+    std::uint64_t startTicks = __rdtsc();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    std::int64_t endNanos = SystemNanos();
+    std::uint64_t endTicks = __rdtsc();
+
+    if (endTicks <= startTicks || endNanos <= startNanos) {
+        return false;
+    }
+
+    PublishTscAnchor(endTicks, endNanos,
+                     static_cast<double>(endNanos - startNanos) / static_cast<double>(endTicks - startTicks));
+    g_nextReanchor = std::chrono::steady_clock::now() + kReanchorInterval;
+    g_tscCalibrated = true;
+    return true;
+#else
+    return false;
+#endif
+}
+
+void Log2ConsoleClock::Reanchor() {
+#ifdef LTC_HAS_TSC
+    if (GetSource() != ClockSource::Tsc) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(g_calibrationMutex);
+    auto now = std::chrono::steady_clock::now();
+    if (!g_tscCalibrated || now < g_nextReanchor) {
+        return;
+    }
+    g_nextReanchor = now + kReanchorInterval;
+
+    std::uint64_t ticks = __rdtsc();
+    std::int64_t nanos = SystemNanos();
+    std::uint64_t baseTicks = g_tscBaseTicks.load(std::memory_order_relaxed);
+    std::int64_t baseNanos = g_tscBaseNanos.load(std::memory_order_relaxed);
+    double nanosPerTick = g_tscNanosPerTick.load(std::memory_order_relaxed);
+
+    // The rate measured over the whole interval follows NTP slew and is far more precise than the
+    // first 20 ms sample; a system clock step only moves the base
+    if (ticks > baseTicks && nanos > baseNanos) {
+        double measured = static_cast<double>(nanos - baseNanos) / static_cast<double>(ticks - baseTicks);
+        if (measured > nanosPerTick * (1.0 - kMaxRateChange) && measured < nanosPerTick * (1.0 + kMaxRateChange)) {
+            nanosPerTick = measured;
+        }
+    }
+    PublishTscAnchor(ticks, nanos, nanosPerTick);
+#endif
+}
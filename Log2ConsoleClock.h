@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Clock used to timestamp log events
+enum class ClockSource {
+    System = 0,          // std::chrono::system_clock
+    RealtimeCoarse = 1,  // CLOCK_REALTIME_COARSE on Linux, GetSystemTimeAsFileTime on Windows
+    Tsc = 2              // CPU timestamp counter calibrated against the system clock (x86 with an
+                         // invariant TSC only), re-anchored by Reanchor()
+};
+
+// Point in time taken once per event and shared by every formatter and sink
+struct LogTimestamp {
+    std::int64_t nanosSinceEpoch;
+
+    std::int64_t MillisSinceEpoch() const { return nanosSinceEpoch / 1000000; }
+};
+
+class Log2ConsoleClock {
+public:
+    // Select the clock source; returns false (and keeps the current source) if unsupported
+    static bool SetSource(ClockSource source);
+    static ClockSource GetSource();
+
+    static LogTimestamp Now();
+
+    // Re-anchors the TSC to the system clock and refines its rate once per interval, so Tsc
+    // timestamps follow wall time (NTP slew, calibration error). Called from the logger's
+    // maintenance thread; does nothing for the other sources or before the interval is up.
+    static void Reanchor();
+
+    // Append "YYYY-MM-DD HH:MM:SS.mmm" in local time. The date/time prefix is cached per thread
+    // and only re-rendered when the second changes, so timezone conversion runs once per second.
+    static void AppendLocalTime(const LogTimestamp& timestamp, std::string& out);
+
+private:
+    static bool CalibrateTsc();
+};
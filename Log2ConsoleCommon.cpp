@@ -1,92 +1,317 @@
 #include "Log2ConsoleCommon.h"
 #include "PlatformUtils.h"
-#include <sstream>
-#include <iomanip>
-#include <chrono>
-#include <ctime>
-#include <mutex>
-
-std::string Log2ConsoleFormatter::FormatPlainText(LogLevel level, const std::string& category, const std::string& message) {
-    auto now = std::chrono::system_clock::now();
-    auto time_t_now = std::chrono::system_clock::to_time_t(now);
-    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()) % 1000;
-    
-    std::tm tm{};
-#ifdef WIN32
-    localtime_s(&tm, &time_t_now);
-#else
-    localtime_r(&time_t_now, &tm);
-#endif
-    
-    std::stringstream ss;
-    ss << std::put_time(&tm, "%Y-%m-%d %H:%M:%S");
-    ss << "." << std::setfill('0') << std::setw(3) << ms.count();
-    ss << " [" << LogLevelToString(level) << "] ";
-    ss << "[" << category << "] ";
-    ss << message;
-    ss << "\r\n";
-    
-    return ss.str();
-}
-
-std::string Log2ConsoleFormatter::FormatLog4jXml(LogLevel level, const std::string& category, const std::string& message) {
-    auto now = std::chrono::system_clock::now();
-    auto ms_since_epoch = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count();
-    
-    // Get sequence number for this log message
-    unsigned long sequenceNumber = GetNextSequenceNumber();
-    
-    std::stringstream ss;
-    ss << "<log4j:event logger=\"" << EscapeXml(category) << "\" ";
-    ss << "timestamp=\"" << ms_since_epoch << "\" ";
-    ss << "level=\"" << LogLevelToLog4jString(level) << "\" ";
-    ss << "thread=\"" << PlatformUtils::GetCurrentThreadId() << "\">";
-    ss << "<log4j:message><![CDATA[" << message << "]]></log4j:message>";
-    ss << "<log4j:properties>";
-    ss << "<log4j:data name=\"log4net:HostName\" value=\"" << EscapeXml(PlatformUtils::GetHostName()) << "\"/>";
-    ss << "<nlog:eventSequenceNumber>" << sequenceNumber << "</nlog:eventSequenceNumber>";
-    ss << "</log4j:properties>";
-    ss << "</log4j:event>\0";
-    
-    return ss.str();
-}
-
-std::string Log2ConsoleFormatter::FormatLog4jXml(LogLevel level, const std::string& category, const std::string& message,
-                                                  const char* file, const char* function, int line) {
-    auto now = std::chrono::system_clock::now();
-    auto ms_since_epoch = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count();
-    
-    // Get sequence number for this log message
-    unsigned long sequenceNumber = GetNextSequenceNumber();
-    
-    // Extract just the filename from the full path
-    const char* filename = file;
-    const char* lastSlash = file;
-    while (*lastSlash) {
-        if (*lastSlash == '\\' || *lastSlash == '/') {
-            filename = lastSlash + 1;
+#include <cstdio>
+#include <cstring>
+#include <ostream>
+#include <atomic>
+
+void LogField::WriteValue(std::ostream& out) const {
+    switch (m_type) {
+        case Type::Bool:
+            out << (m_value.b ? "true" : "false");
+            break;
+        case Type::Int:
+            out << m_value.i;
+            break;
+        case Type::UInt:
+            out << m_value.u;
+            break;
+        case Type::Double: {
+            // Shortest round-trippable-enough form without going through the stream's precision state
+            char buffer[32];
+            int length = std::snprintf(buffer, sizeof(buffer), "%.15g", m_value.d);
+            out.write(buffer, length);
+            break;
         }
-        lastSlash++;
-    }
-    
-    std::stringstream ss;
-    ss << "<log4j:event logger=\"" << EscapeXml(category) << "\" ";
-    ss << "timestamp=\"" << ms_since_epoch << "\" ";
-    ss << "level=\"" << LogLevelToLog4jString(level) << "\" ";
-    ss << "thread=\"" << PlatformUtils::GetCurrentThreadId() << "\">";
-    ss << "<log4j:message><![CDATA[" << message << "]]></log4j:message>";
-    ss << "<log4j:locationInfo class=\"" << EscapeXml(category) << "\" ";
-    ss << "method=\"" << EscapeXml(function) << "\" ";
-    ss << "file=\"" << EscapeXml(filename) << "\" ";
-    ss << "line=\"" << line << "\"/>";
-    ss << "<log4j:properties>";
-    ss << "<log4j:data name=\"log4net:HostName\" value=\"" << EscapeXml(PlatformUtils::GetHostName()) << "\"/>";
-    ss << "<log4j:data name=\"log4net:UserName\" value=\"" << EscapeXml(PlatformUtils::GetUserName()) << "\"/>";
-    ss << "<nlog:eventSequenceNumber>" << sequenceNumber << "</nlog:eventSequenceNumber>";
-    ss << "</log4j:properties>";
-    ss << "</log4j:event>\0";
-    
-    return ss.str();
+        case Type::String:
+            out.write(m_value.s, static_cast<std::streamsize>(m_length));
+            break;
+    }
+}
+
+void LogField::AppendValue(std::string& out) const {
+    switch (m_type) {
+        case Type::Bool:
+            out += m_value.b ? "true" : "false";
+            break;
+        case Type::Int:
+            Log2ConsoleFormatter::AppendDecimal(out, static_cast<long long>(m_value.i));
+            break;
+        case Type::UInt:
+            Log2ConsoleFormatter::AppendDecimal(out, static_cast<unsigned long long>(m_value.u));
+            break;
+        case Type::Double: {
+            char buffer[32];
+            int length = std::snprintf(buffer, sizeof(buffer), "%.15g", m_value.d);
+            out.append(buffer, static_cast<std::size_t>(length));
+            break;
+        }
+        case Type::String:
+            out.append(m_value.s, m_length);
+            break;
+    }
+}
+
+void LogEventFragments::Append(const char* data, std::size_t length) {
+    if (length == 0 || m_count == kMaxFragments) {
+        return;
+    }
+    m_fragments[m_count].data = data;
+    m_fragments[m_count].length = length;
+    m_count++;
+    m_size += length;
+}
+
+namespace {
+    // Room for the markup around category and message, so the string variants allocate once
+    std::size_t EstimateSize(LogStringRef category, LogStringRef message) {
+        return 512 + 2 * category.Size() + message.Size();
+    }
+}
+
+std::string LogEventFragments::Join() const {
+    std::string result;
+    JoinTo(result);
+    return result;
+}
+
+void LogEventFragments::JoinTo(std::string& out) const {
+    out.reserve(out.size() + m_size);
+    for (std::size_t i = 0; i < m_count; i++) {
+        out.append(m_fragments[i].data, m_fragments[i].length);
+    }
+}
+
+std::string Log2ConsoleFormatter::FormatPlainText(LogLevel level, LogStringRef category, LogStringRef message,
+                                                  const std::vector<LogProperty>& properties) {
+    return FormatPlainText(Log2ConsoleClock::Now(), level, category, message, properties);
+}
+
+std::string Log2ConsoleFormatter::FormatLog4jXml(LogLevel level, LogStringRef category, LogStringRef message,
+                                                  const std::vector<LogProperty>& properties) {
+    return FormatLog4jXml(Log2ConsoleClock::Now(), level, category, message, properties);
+}
+
+std::string Log2ConsoleFormatter::FormatLog4jXml(LogLevel level, LogStringRef category, LogStringRef message,
+                                                  const char* file, const char* function, int line,
+                                                  const std::vector<LogProperty>& properties) {
+    return FormatLog4jXml(Log2ConsoleClock::Now(), level, category, message, file, function, line, properties);
+}
+
+std::string Log2ConsoleFormatter::FormatPlainText(const LogTimestamp& timestamp, LogLevel level, LogStringRef category,
+                                                  LogStringRef message, const std::vector<LogProperty>& properties,
+                                                  LogFieldList fields, const std::string& context) {
+    std::string result;
+    result.reserve(EstimateSize(category, message));
+    AppendPlainText(result, timestamp, level, category, message, properties, fields, context);
+    return result;
+}
+
+std::string Log2ConsoleFormatter::FormatLog4jXml(const LogTimestamp& timestamp, LogLevel level, LogStringRef category,
+                                                  LogStringRef message, const std::vector<LogProperty>& properties,
+                                                  LogFieldList fields, const std::string& context) {
+    std::string result;
+    result.reserve(EstimateSize(category, message));
+    AppendLog4jXml(result, timestamp, CaptureOrigin(), level, category, message, nullptr, nullptr, 0, properties, fields, context);
+    return result;
+}
+
+std::string Log2ConsoleFormatter::FormatLog4jXml(const LogTimestamp& timestamp, LogLevel level, LogStringRef category,
+                                                  LogStringRef message, const char* file, const char* function, int line,
+                                                  const std::vector<LogProperty>& properties,
+                                                  LogFieldList fields, const std::string& context) {
+    std::string result;
+    result.reserve(EstimateSize(category, message));
+    AppendLog4jXml(result, timestamp, CaptureOrigin(), level, category, message, file, function, line, properties, fields, context);
+    return result;
+}
+
+void Log2ConsoleFormatter::AppendPlainText(std::string& out, const LogTimestamp& timestamp, LogLevel level,
+                                           LogStringRef category, LogStringRef message,
+                                           const std::vector<LogProperty>& properties,
+                                           LogFieldList fields, const std::string& context) {
+    AppendPlainHead(out, timestamp, level, category);
+    out.append(message.Data(), message.Size());
+    AppendFieldsPlainText(out, properties, fields);
+    out += context;
+    out += "\r\n";
+}
+
+void Log2ConsoleFormatter::AppendLog4jXml(std::string& out, const LogTimestamp& timestamp,
+                                          const LogEventOrigin& origin, LogLevel level,
+                                          LogStringRef category, LogStringRef message,
+                                          const char* file, const char* function, int line,
+                                          const std::vector<LogProperty>& properties, LogFieldList fields,
+                                          const std::string& context) {
+    AppendXmlHead(out, timestamp, origin.threadId, level, category);
+    out.append(message.Data(), message.Size());
+    AppendXmlMiddle(out, category, file, function, line);
+    out += IdentityFragment(file != nullptr);
+    AppendXmlTail(out, properties, fields, context, origin.sequenceNumber);
+}
+
+void Log2ConsoleFormatter::FormatLog4jXmlFragments(const LogTimestamp& timestamp, const LogEventOrigin& origin,
+                                                   LogLevel level, LogStringRef category, LogStringRef message, const char* file, const char* function, int line,
+                                                   const std::vector<LogProperty>& properties, LogFieldList fields,
+                                                   const std::string& context, LogEventFragments& event) {
+    // Head, middle and tail go back to back into the storage; the ranges are taken once it is complete
+    std::string& storage = event.Storage();
+    AppendXmlHead(storage, timestamp, origin.threadId, level, category);
+    std::size_t headEnd = storage.size();
+    AppendXmlMiddle(storage, category, file, function, line);
+    std::size_t middleEnd = storage.size();
+    AppendXmlTail(storage, properties, fields, context, origin.sequenceNumber);
+
+    event.AppendStorage(0, headEnd);
+    event.Append(message);
+    event.AppendStorage(headEnd, middleEnd - headEnd);
+    event.Append(IdentityFragment(file != nullptr));
+    event.AppendStorage(middleEnd, storage.size() - middleEnd);
+}
+
+void Log2ConsoleFormatter::FormatPlainTextFragments(const LogTimestamp& timestamp, LogLevel level, LogStringRef category,
+                                                    LogStringRef message, const std::vector<LogProperty>& properties,
+                                                    LogFieldList fields, const std::string& context, LogEventFragments& event) {
+    std::string& storage = event.Storage();
+    AppendPlainHead(storage, timestamp, level, category);
+    std::size_t headEnd = storage.size();
+    AppendFieldsPlainText(storage, properties, fields);
+    storage += context;
+    storage += "\r\n";
+
+    event.AppendStorage(0, headEnd);
+    event.Append(message);
+    event.AppendStorage(headEnd, storage.size() - headEnd);
+}
+
+void Log2ConsoleFormatter::AppendXmlHead(std::string& out, const LogTimestamp& timestamp, unsigned long threadId,
+                                         LogLevel level, LogStringRef category) {
+    out += "<log4j:event logger=\"";
+    AppendEscapedXml(out, category);
+    out += "\" timestamp=\"";
+    AppendDecimal(out, static_cast<long long>(timestamp.MillisSinceEpoch()));
+    out += "\" level=\"";
+    out += LogLevelToLog4jString(level);
+    out += "\" thread=\"";
+    AppendDecimal(out, static_cast<unsigned long long>(threadId));
+    out += "\"><log4j:message><![CDATA[";
+}
+
+void Log2ConsoleFormatter::AppendXmlMiddle(std::string& out, LogStringRef category, const char* file,
+                                           const char* function, int line) {
+    out += "]]></log4j:message>";
+    if (file) {
+        // Extract just the filename from the full path
+        const char* filename = file;
+        for (const char* p = file; *p; p++) {
+            if (*p == '\\' || *p == '/') {
+                filename = p + 1;
+            }
+        }
+        out += "<log4j:locationInfo class=\"";
+        AppendEscapedXml(out, category);
+        out += "\" method=\"";
+        AppendEscapedXml(out, function);
+        out += "\" file=\"";
+        AppendEscapedXml(out, filename);
+        out += "\" line=\"";
+        AppendDecimal(out, static_cast<long long>(line));
+        out += "\"/>";
+    }
+    out += "<log4j:properties>";
+}
+
+void Log2ConsoleFormatter::AppendXmlTail(std::string& out, const std::vector<LogProperty>& properties, LogFieldList fields,
+                                         const std::string& context, unsigned long sequenceNumber) {
+    for (const auto& property : properties) {
+        out += "<log4j:data name=\"";
+        AppendEscapedXml(out, property.name);
+        out += "\" value=\"";
+        AppendEscapedXml(out, property.value);
+        out += "\"/>";
+    }
+    AppendFieldsXml(out, fields);
+    out += context;
+    out += "<nlog:eventSequenceNumber>";
+    AppendDecimal(out, static_cast<unsigned long long>(sequenceNumber));
+    out += "</nlog:eventSequenceNumber></log4j:properties></log4j:event>";
+}
+
+void Log2ConsoleFormatter::AppendPlainHead(std::string& out, const LogTimestamp& timestamp, LogLevel level,
+                                           LogStringRef category) {
+    Log2ConsoleClock::AppendLocalTime(timestamp, out);
+    out += " [";
+    out += LogLevelToString(level);
+    out += "] [";
+    out.append(category.Data(), category.Size());
+    out += "] ";
+}
+
+void Log2ConsoleFormatter::AppendFieldsPlainText(std::string& out, const std::vector<LogProperty>& properties,
+                                                 LogFieldList fields) {
+    for (const auto& property : properties) {
+        out += " [";
+        out += property.name;
+        out += "=";
+        out += property.value;
+        out += "]";
+    }
+    for (const auto& field : fields) {
+        out += " [";
+        out += field.GetName();
+        out += "=";
+        field.AppendValue(out);
+        out += "]";
+    }
+}
+
+const std::string& Log2ConsoleFormatter::IdentityFragment(bool withUserName) {
+    static const std::string hostFragment =
+        "<log4j:data name=\"log4net:HostName\" value=\"" + EscapeXml(PlatformUtils::GetHostName()) + "\"/>";
+    static const std::string hostUserFragment = hostFragment +
+        "<log4j:data name=\"log4net:UserName\" value=\"" + EscapeXml(PlatformUtils::GetUserName()) + "\"/>";
+    return withUserName ? hostUserFragment : hostFragment;
+}
+
+LogEventOrigin Log2ConsoleFormatter::CaptureOrigin() {
+    LogEventOrigin origin;
+    origin.threadId = CurrentThreadId();
+    origin.sequenceNumber = GetNextSequenceNumber();
+    return origin;
+}
+
+unsigned long Log2ConsoleFormatter::CurrentThreadId() {
+    static thread_local unsigned long threadId = PlatformUtils::GetCurrentThreadId();
+    return threadId;
+}
+
+std::string Log2ConsoleFormatter::FormatFieldXml(const LogField& field) {
+    std::string result;
+    AppendFieldsXml(result, {field});
+    return result;
+}
+
+std::string Log2ConsoleFormatter::FormatFieldPlainText(const LogField& field) {
+    std::string result;
+    AppendFieldsPlainText(result, std::vector<LogProperty>(), {field});
+    return result;
+}
+
+std::size_t Log2ConsoleFormatter::FindMessage(const std::string& formatted, LogStringRef category, bool xml) {
+    if (xml) {
+        // The logger attribute is escaped, so the first CDATA opener is the message
+        static const std::string kMessageStart = "<log4j:message><![CDATA[";
+        std::size_t start = formatted.find(kMessageStart);
+        return start == std::string::npos ? start : start + kMessageStart.size();
+    }
+
+    // "time [LEVEL] [category] message..."
+    std::size_t levelEnd = formatted.find("] [");
+    if (levelEnd == std::string::npos) {
+        return levelEnd;
+    }
+    std::size_t start = levelEnd + 3 + category.Size() + 2;
+    return start <= formatted.size() ? start : std::string::npos;
 }
 
 const char* Log2ConsoleFormatter::LogLevelToString(LogLevel level) {
@@ -116,24 +341,82 @@ const char* Log2ConsoleFormatter::LogLevelToLog4jString(LogLevel level) {
 std::string Log2ConsoleFormatter::EscapeXml(const std::string& text) {
     std::string result;
     result.reserve(text.size());
-    
-    for (char c : text) {
-        switch (c) {
-            case '&':  result += "&amp;"; break;
-            case '<':  result += "&lt;"; break;
-            case '>':  result += "&gt;"; break;
-            case '"':  result += "&quot;"; break;
-            case '\'': result += "&apos;"; break;
-            default:   result += c; break;
+    AppendEscapedXml(result, text.data(), text.size());
+    return result;
+}
+
+void Log2ConsoleFormatter::AppendEscapedXml(std::string& out, const char* text, std::size_t length) {
+    // Copy unescaped runs in one append instead of character by character
+    std::size_t runStart = 0;
+    for (std::size_t i = 0; i < length; i++) {
+        const char* entity = nullptr;
+        switch (text[i]) {
+            case '&':  entity = "&amp;"; break;
+            case '<':  entity = "&lt;"; break;
+            case '>':  entity = "&gt;"; break;
+            case '"':  entity = "&quot;"; break;
+            case '\'': entity = "&apos;"; break;
+            default:   continue;
         }
+        out.append(text + runStart, i - runStart);
+        out += entity;
+        runStart = i + 1;
     }
-    
-    return result;
+    out.append(text + runStart, length - runStart);
+}
+
+void Log2ConsoleFormatter::AppendFieldsXml(std::string& out, LogFieldList fields) {
+    for (const auto& field : fields) {
+        out += "<log4j:data name=\"";
+        AppendEscapedXml(out, field.m_name, std::strlen(field.m_name));
+        out += "\" value=\"";
+        if (field.m_type == LogField::Type::String) {
+            AppendEscapedXml(out, field.m_value.s, field.m_length);
+        } else {
+            field.AppendValue(out);
+        }
+        out += "\"/>";
+    }
+}
+
+void Log2ConsoleFormatter::AppendDecimal(std::string& out, long long value) {
+    if (value < 0) {
+        out += '-';
+        AppendDecimal(out, 0ull - static_cast<unsigned long long>(value));
+        return;
+    }
+    AppendDecimal(out, static_cast<unsigned long long>(value));
+}
+
+void Log2ConsoleFormatter::AppendDecimal(std::string& out, unsigned long long value) {
+    char buffer[24];
+    char* end = buffer + sizeof(buffer);
+    char* p = end;
+    do {
+        *--p = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    out.append(p, static_cast<std::size_t>(end - p));
+}
+
+void Log2ConsoleFormatter::AppendHex(std::string& out, unsigned long long value, bool uppercase, bool prefix) {
+    const char* digits = uppercase ? "0123456789ABCDEF" : "0123456789abcdef";
+    char buffer[24];
+    char* end = buffer + sizeof(buffer);
+    char* p = end;
+    do {
+        *--p = digits[value & 0xF];
+        value >>= 4;
+    } while (value != 0);
+    if (prefix) {
+        *--p = uppercase ? 'X' : 'x';
+        *--p = '0';
+    }
+    out.append(p, static_cast<std::size_t>(end - p));
 }
 
 unsigned long Log2ConsoleFormatter::GetNextSequenceNumber() {
-    static unsigned long sequenceCounter = 0;
-    static std::mutex sequenceMutex;
-    std::lock_guard<std::mutex> lock(sequenceMutex);
-    return ++sequenceCounter;
+    // Taken by every XML event from every thread, so a single atomic add rather than a lock
+    static std::atomic<unsigned long> sequenceCounter{0};
+    return sequenceCounter.fetch_add(1, std::memory_order_relaxed) + 1;
 }
\ No newline at end of file
@@ -1,7 +1,15 @@
 #pragma once
 
+#include "Log2ConsoleBuffer.h"
+#include "Log2ConsoleClock.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <iosfwd>
 #include <string>
 #include <memory>
+#include <vector>
 
 enum class LogLevel {
     L_TRACE = 0,
@@ -12,17 +20,350 @@ enum class LogLevel {
     L_FATAL = 5
 };
 
+// Severity classes; each has a queue of its own on the formatting workers
+enum class LogSeverityClass {
+    Low = 0,          // L_TRACE, L_DEBUG
+    Normal = 1,       // L_INFO, L_WARN
+    High = 2          // L_ERROR, L_FATAL
+};
+
+const std::size_t kLogSeverityClassCount = 3;
+
+inline LogSeverityClass GetSeverityClass(LogLevel level) {
+    return level >= LogLevel::L_ERROR ? LogSeverityClass::High
+         : level >= LogLevel::L_INFO ? LogSeverityClass::Normal
+         : LogSeverityClass::Low;
+}
+
+// What a logging thread does with an event whose severity class queue is full
+enum class LogOverflowPolicy {
+    Block = 0,        // wait for the workers to catch up
+    DropNewest,       // discard the new event
+    DropOldest        // discard the oldest queued event of the class to make room
+};
+
+// Queue of one severity class: capacity per logging thread's queue, and the share of a worker's
+// turn it gets while several classes have events waiting
+struct LogPriorityLane {
+    std::size_t capacity = 4096;
+    LogOverflowPolicy overflow = LogOverflowPolicy::Block;
+    unsigned int weight = 1;
+
+    bool operator==(const LogPriorityLane& other) const {
+        return capacity == other.capacity && overflow == other.overflow && weight == other.weight;
+    }
+    bool operator!=(const LogPriorityLane& other) const { return !(*this == other); }
+};
+
+// The priority lanes, indexed by LogSeverityClass. By default debug events are shed when their
+// lane is full while info and error events wait, and errors are drained first.
+struct LogPriorityLanes {
+    LogPriorityLane lanes[kLogSeverityClassCount];
+
+    LogPriorityLanes() {
+        lanes[0].overflow = LogOverflowPolicy::DropNewest;
+        lanes[1].weight = 4;
+        lanes[2].weight = 16;
+    }
+
+    LogPriorityLane& operator[](LogSeverityClass severityClass) { return lanes[static_cast<std::size_t>(severityClass)]; }
+    const LogPriorityLane& operator[](LogSeverityClass severityClass) const {
+        return lanes[static_cast<std::size_t>(severityClass)];
+    }
+
+    bool operator==(const LogPriorityLanes& other) const {
+        for (std::size_t i = 0; i < kLogSeverityClassCount; i++) {
+            if (lanes[i] != other.lanes[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+    bool operator!=(const LogPriorityLanes& other) const { return !(*this == other); }
+};
+
+// When formatting workers send the events they collected: a batch goes out once it holds maxEvents
+// events or maxBytes bytes, or maxDelayMicros after its first event. Adaptive batching sizes the
+// batch by the observed event rate, so a quiet logger still sends every event right away.
+struct LogFlushPolicy {
+    std::size_t maxEvents = 64;                  // 1 = no batching
+    std::size_t maxBytes = 64 * 1024;
+    unsigned int maxDelayMicros = 100;
+    bool adaptive = true;
+
+    // An event at or above this level is sent at once together with everything queued before it,
+    // and the logging thread waits until it is out
+    LogLevel flushLevel = LogLevel::L_ERROR;
+
+    bool operator==(const LogFlushPolicy& other) const {
+        return maxEvents == other.maxEvents && maxBytes == other.maxBytes &&
+               maxDelayMicros == other.maxDelayMicros && adaptive == other.adaptive &&
+               flushLevel == other.flushLevel;
+    }
+    bool operator!=(const LogFlushPolicy& other) const { return !(*this == other); }
+};
+
+// Non-owning reference to a character range, standing in for C++17's std::string_view. Log calls
+// take category, message and format as LogStringRef, so string literals and std::string arguments
+// reach the formatter without a temporary std::string. Must not outlive the referenced text.
+class LogStringRef {
+public:
+    LogStringRef() : m_data(""), m_size(0) {}
+    LogStringRef(const char* text) : m_data(text ? text : ""), m_size(text ? std::char_traits<char>::length(text) : 0) {}
+    LogStringRef(const char* text, std::size_t size) : m_data(text), m_size(size) {}
+    LogStringRef(const std::string& text) : m_data(text.data()), m_size(text.size()) {}
+
+    const char* Data() const { return m_data; }
+    std::size_t Size() const { return m_size; }
+    bool Empty() const { return m_size == 0; }
+
+    const char* begin() const { return m_data; }
+    const char* end() const { return m_data + m_size; }
+    char operator[](std::size_t index) const { return m_data[index]; }
+
+    // Position of c at or after position, std::string::npos if absent
+    std::size_t Find(char c, std::size_t position = 0) const {
+        if (position >= m_size) {
+            return std::string::npos;
+        }
+        const void* found = std::memchr(m_data + position, c, m_size - position);
+        return found ? static_cast<std::size_t>(static_cast<const char*>(found) - m_data) : std::string::npos;
+    }
+
+    LogStringRef Substr(std::size_t position, std::size_t count = std::string::npos) const {
+        position = position < m_size ? position : m_size;
+        return LogStringRef(m_data + position, count < m_size - position ? count : m_size - position);
+    }
+
+    bool StartsWith(LogStringRef prefix) const {
+        return prefix.m_size <= m_size && std::memcmp(m_data, prefix.m_data, prefix.m_size) == 0;
+    }
+
+    // In-process hash of the bytes (8 at a time), for tables keyed on text that is only sometimes copied
+    std::size_t Hash() const {
+        const std::uint64_t kMultiplier = 0x9e3779b97f4a7c15ull;
+        std::uint64_t hash = m_size * kMultiplier;
+        std::size_t i = 0;
+        for (; i + sizeof(std::uint64_t) <= m_size; i += sizeof(std::uint64_t)) {
+            std::uint64_t word;
+            std::memcpy(&word, m_data + i, sizeof(word));
+            hash = (((hash << 5) | (hash >> 59)) ^ word) * kMultiplier;
+        }
+        for (; i < m_size; i++) {
+            hash = (((hash << 5) | (hash >> 59)) ^ static_cast<unsigned char>(m_data[i])) * kMultiplier;
+        }
+        return static_cast<std::size_t>(hash ^ (hash >> 32));
+    }
+
+    std::string ToString() const { return std::string(m_data, m_size); }
+
+private:
+    const char* m_data;
+    std::size_t m_size;
+};
+
+inline bool operator==(LogStringRef left, LogStringRef right) {
+    return left.Size() == right.Size() && std::memcmp(left.Data(), right.Data(), left.Size()) == 0;
+}
+
+inline bool operator!=(LogStringRef left, LogStringRef right) {
+    return !(left == right);
+}
+
+// Additional name/value pair emitted as a log4j:data property
+struct LogProperty {
+    std::string name;
+    std::string value;
+};
+
+// Typed structured field, e.g. {"orderId", id}, rendered straight into a log4j:data property.
+// The value is stored as a tagged binary value; string values and the name are referenced,
+// not copied, so a field must not outlive the log call it is passed to.
+class LogField {
+public:
+    enum class Type {
+        Bool,
+        Int,
+        UInt,
+        Double,
+        String
+    };
+
+    LogField(const char* name, bool value) : m_name(name), m_type(Type::Bool) { m_value.b = value; }
+    LogField(const char* name, int value) : m_name(name), m_type(Type::Int) { m_value.i = value; }
+    LogField(const char* name, long value) : m_name(name), m_type(Type::Int) { m_value.i = value; }
+    LogField(const char* name, long long value) : m_name(name), m_type(Type::Int) { m_value.i = value; }
+    LogField(const char* name, unsigned int value) : m_name(name), m_type(Type::UInt) { m_value.u = value; }
+    LogField(const char* name, unsigned long value) : m_name(name), m_type(Type::UInt) { m_value.u = value; }
+    LogField(const char* name, unsigned long long value) : m_name(name), m_type(Type::UInt) { m_value.u = value; }
+    LogField(const char* name, double value) : m_name(name), m_type(Type::Double) { m_value.d = value; }
+    LogField(const char* name, const char* value) : m_name(name), m_type(Type::String), m_length(value ? std::char_traits<char>::length(value) : 0) { m_value.s = value ? value : ""; }
+    LogField(const char* name, const std::string& value) : m_name(name), m_type(Type::String), m_length(value.size()) { m_value.s = value.data(); }
+
+    const char* GetName() const { return m_name; }
+    Type GetType() const { return m_type; }
+
+    // Writes / appends the value without escaping (the formatter escapes string values for XML)
+    void WriteValue(std::ostream& out) const;
+    void AppendValue(std::string& out) const;
+
+private:
+    friend class Log2ConsoleFormatter;
+
+    const char* m_name;
+    Type m_type;
+    std::size_t m_length = 0;
+    union {
+        bool b;
+        std::int64_t i;
+        std::uint64_t u;
+        double d;
+        const char* s;
+    } m_value;
+};
+
+using LogFieldList = std::initializer_list<LogField>;
+
+// Byte range of a formatted event, see LogEventFragments
+struct LogFragment {
+    const char* data;
+    std::size_t length;
+};
+
+// Formatted event as an ordered list of byte ranges for scatter-gather sends: the per-event parts
+// rendered into the pooled storage, process-wide constant fragments and the caller's message.
+// The message is referenced, not copied, so the fragments must not outlive it.
+class LogEventFragments {
+public:
+    static const std::size_t kMaxFragments = 8;
+
+    LogEventFragments() = default;
+    LogEventFragments(const LogEventFragments&) = delete;
+    LogEventFragments& operator=(const LogEventFragments&) = delete;
+
+    // Per-event bytes (everything around the message that is not constant), rendered first
+    std::string& Storage() { return *m_storage; }
+
+    // Empty ranges are skipped; strings, including the storage, must not change after they were appended
+    void Append(const char* data, std::size_t length);
+    void Append(LogStringRef text) { Append(text.Data(), text.Size()); }
+    void AppendStorage(std::size_t offset, std::size_t length) { Append(m_storage->data() + offset, length); }
+
+    const LogFragment* Data() const { return m_fragments; }
+    std::size_t Count() const { return m_count; }
+    std::size_t Size() const { return m_size; }
+
+    // Contiguous copy, for paths that need the event as one string
+    std::string Join() const;
+    void JoinTo(std::string& out) const;
+
+private:
+    LogBuffer m_storage;
+    LogFragment m_fragments[kMaxFragments];
+    std::size_t m_count = 0;
+    std::size_t m_size = 0;
+};
+
+// Who logged an event and its place in the process-wide numbering, captured on the logging
+// thread so an event formatted elsewhere (see LogFormatterPool) renders as if it had not moved
+struct LogEventOrigin {
+    unsigned long threadId = 0;
+    unsigned long sequenceNumber = 0;
+};
+
 class Log2ConsoleFormatter {
 public:
-    static std::string FormatPlainText(LogLevel level, const std::string& category, const std::string& message);
-    static std::string FormatLog4jXml(LogLevel level, const std::string& category, const std::string& message);
-    static std::string FormatLog4jXml(LogLevel level, const std::string& category, const std::string& message, 
-                                      const char* file, const char* function, int line);
+    static std::string FormatPlainText(LogLevel level, LogStringRef category, LogStringRef message,
+                                       const std::vector<LogProperty>& properties = std::vector<LogProperty>());
+    static std::string FormatLog4jXml(LogLevel level, LogStringRef category, LogStringRef message,
+                                      const std::vector<LogProperty>& properties = std::vector<LogProperty>());
+    static std::string FormatLog4jXml(LogLevel level, LogStringRef category, LogStringRef message, 
+                                      const char* file, const char* function, int line,
+                                      const std::vector<LogProperty>& properties = std::vector<LogProperty>());
+
+    // Variants taking a timestamp captured once per event, so every sink renders the same time
+    // Structured fields follow the properties as additional log4j:data elements; context is a
+    // pre-rendered fragment (see LogContext) appended as is
+    static std::string FormatPlainText(const LogTimestamp& timestamp, LogLevel level, LogStringRef category,
+                                       LogStringRef message, const std::vector<LogProperty>& properties,
+                                       LogFieldList fields = LogFieldList(),
+                                       const std::string& context = std::string());
+    static std::string FormatLog4jXml(const LogTimestamp& timestamp, LogLevel level, LogStringRef category,
+                                      LogStringRef message, const std::vector<LogProperty>& properties,
+                                      LogFieldList fields = LogFieldList(),
+                                      const std::string& context = std::string());
+    static std::string FormatLog4jXml(const LogTimestamp& timestamp, LogLevel level, LogStringRef category,
+                                      LogStringRef message, const char* file, const char* function, int line,
+                                      const std::vector<LogProperty>& properties,
+                                      LogFieldList fields = LogFieldList(),
+                                      const std::string& context = std::string());
+
+    // Same events appended to out, typically a pooled LogBuffer, so formatting allocates only when
+    // the buffer has to grow. file == nullptr renders the event without location; the XML variants
+    // render thread and sequence number from origin (see CaptureOrigin).
+    static void AppendPlainText(std::string& out, const LogTimestamp& timestamp, LogLevel level, LogStringRef category,
+                                LogStringRef message, const std::vector<LogProperty>& properties,
+                                LogFieldList fields, const std::string& context);
+    static void AppendLog4jXml(std::string& out, const LogTimestamp& timestamp, const LogEventOrigin& origin,
+                               LogLevel level, LogStringRef category,
+                               LogStringRef message, const char* file, const char* function, int line,
+                               const std::vector<LogProperty>& properties, LogFieldList fields,
+                               const std::string& context);
     
+    // Same events split around the message for scatter-gather sends; the joined fragments equal
+    // the string variants byte for byte. file == nullptr renders the event without location.
+    static void FormatLog4jXmlFragments(const LogTimestamp& timestamp, const LogEventOrigin& origin, LogLevel level,
+                                        LogStringRef category,
+                                        LogStringRef message, const char* file, const char* function, int line,
+                                        const std::vector<LogProperty>& properties, LogFieldList fields,
+                                        const std::string& context, LogEventFragments& event);
+    static void FormatPlainTextFragments(const LogTimestamp& timestamp, LogLevel level, LogStringRef category,
+                                         LogStringRef message, const std::vector<LogProperty>& properties,
+                                         LogFieldList fields, const std::string& context, LogEventFragments& event);
+
+    // Calling thread and the next sequence number, for the XML variants taking an origin
+    static LogEventOrigin CaptureOrigin();
+
+    // Single field rendered as a log4j:data element / " [name=value]" suffix
+    static std::string FormatFieldXml(const LogField& field);
+    static std::string FormatFieldPlainText(const LogField& field);
+
+    // Properties and fields as the formats render them after the message; fields rendered up front
+    // and passed on as part of the context fragment produce the same bytes
+    static void AppendFieldsXml(std::string& out, LogFieldList fields);
+    static void AppendFieldsPlainText(std::string& out, const std::vector<LogProperty>& properties, LogFieldList fields);
+
+    // Position of the message text inside a formatted event (it is embedded verbatim in both
+    // formats), std::string::npos if it cannot be located
+    static std::size_t FindMessage(const std::string& formatted, LogStringRef category, bool xml);
+
+    // Decimal and hexadecimal renderings without a stream, for the "{}" placeholders of Logger::Log
+    static void AppendDecimal(std::string& out, long long value);
+    static void AppendDecimal(std::string& out, unsigned long long value);
+    static void AppendHex(std::string& out, unsigned long long value, bool uppercase, bool prefix);
+
     static const char* LogLevelToString(LogLevel level);
     static const char* LogLevelToLog4jString(LogLevel level);
+
+    // Text with the XML special characters replaced by entities
+    static std::string EscapeXml(const std::string& text);
     
 private:
-    static std::string EscapeXml(const std::string& text);
+    static void AppendEscapedXml(std::string& out, const char* text, std::size_t length);
+    static void AppendEscapedXml(std::string& out, LogStringRef text) { AppendEscapedXml(out, text.Data(), text.Size()); }
+
+    // Event parts around the message and the constant identity fragment (see FormatLog4jXmlFragments)
+    static void AppendXmlHead(std::string& out, const LogTimestamp& timestamp, unsigned long threadId, LogLevel level,
+                              LogStringRef category);
+    static void AppendXmlMiddle(std::string& out, LogStringRef category, const char* file, const char* function, int line);
+    static void AppendXmlTail(std::string& out, const std::vector<LogProperty>& properties, LogFieldList fields,
+                              const std::string& context, unsigned long sequenceNumber);
+    static void AppendPlainHead(std::string& out, const LogTimestamp& timestamp, LogLevel level, LogStringRef category);
+
+    // Cached per thread, the id does not change while the thread lives
+    static unsigned long CurrentThreadId();
+
+    // Host (and user) log4j:data elements, rendered once per process
+    static const std::string& IdentityFragment(bool withUserName);
     static unsigned long GetNextSequenceNumber();
 };
\ No newline at end of file
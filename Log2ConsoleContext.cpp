@@ -0,0 +1,48 @@
+#include "Log2ConsoleContext.h"
+#include <utility>
+#include <vector>
+
+namespace {
+    struct ThreadContext {
+        std::string xml;
+        std::string plain;
+
+        // Fragment lengths before each push, so a pop is a truncation
+        std::vector<std::pair<std::size_t, std::size_t>> marks;
+    };
+
+    ThreadContext& GetThreadContext() {
+        static thread_local ThreadContext context;
+        return context;
+    }
+}
+
+void LogContext::Push(const LogField& field) {
+    ThreadContext& context = GetThreadContext();
+    context.marks.push_back(std::make_pair(context.xml.size(), context.plain.size()));
+    context.xml += Log2ConsoleFormatter::FormatFieldXml(field);
+    context.plain += Log2ConsoleFormatter::FormatFieldPlainText(field);
+}
+
+void LogContext::Pop() {
+    ThreadContext& context = GetThreadContext();
+    if (context.marks.empty()) {
+        return;
+    }
+
+    context.xml.resize(context.marks.back().first);
+    context.plain.resize(context.marks.back().second);
+    context.marks.pop_back();
+}
+
+std::size_t LogContext::Depth() {
+    return GetThreadContext().marks.size();
+}
+
+const std::string& LogContext::XmlFragment() {
+    return GetThreadContext().xml;
+}
+
+const std::string& LogContext::PlainFragment() {
+    return GetThreadContext().plain;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "Log2ConsoleCommon.h"
+#include <cstddef>
+#include <string>
+
+// Thread-local mapped diagnostic context (MDC). Entries pushed on a thread are attached to every
+// event that thread logs. The XML and plain text renderings are kept pre-rendered and escaped
+// and only change when an entry is pushed or popped, so each event appends one cached buffer.
+namespace LogContext {
+    void Push(const LogField& field);
+    void Pop();
+    std::size_t Depth();
+
+    // "<log4j:data .../>" elements / " [name=value]" suffixes for the calling thread's context
+    const std::string& XmlFragment();
+    const std::string& PlainFragment();
+}
+
+// Pops the entry it pushed when it goes out of scope; must be destroyed on the pushing thread
+class LogContextGuard {
+public:
+    explicit LogContextGuard(const LogField& field) : m_active(true) {
+        LogContext::Push(field);
+    }
+
+    ~LogContextGuard() {
+        if (m_active) {
+            LogContext::Pop();
+        }
+    }
+
+    LogContextGuard(LogContextGuard&& other) noexcept : m_active(other.m_active) {
+        other.m_active = false;
+    }
+
+    LogContextGuard(const LogContextGuard&) = delete;
+    LogContextGuard& operator=(const LogContextGuard&) = delete;
+    LogContextGuard& operator=(LogContextGuard&&) = delete;
+
+private:
+    bool m_active;
+};
@@ -0,0 +1,457 @@
+#include "Log2ConsoleFormatterPool.h"
+#include "Log2ConsoleStats.h"
+#include <algorithm>
+
+const std::size_t LogFormatterPool::kNoWorker;
+
+namespace {
+    // Lanes per worker, and at least this many overall, so that threads rarely share a lane
+    const std::size_t kLanesPerWorker = 4;
+    const std::size_t kMinLanes = 64;
+
+    // Records a class gets per turn for each unit of its weight
+    const std::size_t kDrainQuantum = 16;
+
+    // Record buffers that grew beyond this are released after formatting instead of kept for reuse
+    const std::size_t kMaxRetainedCapacity = 16 * 1024;
+
+    // Weight of the latest batch in the smoothed event rate
+    const double kRateSmoothing = 0.25;
+
+    // Spreads threads over the lanes in the order they first log
+    std::atomic<std::size_t> g_nextLane{0};
+
+    void Trim(std::string& text) {
+        if (text.capacity() > kMaxRetainedCapacity) {
+            std::string().swap(text);
+        }
+    }
+}
+
+LogFormatterPool::LogFormatterPool(std::size_t workers, const LogThreadOptions& options, const LogFlushPolicy& policy,
+                                   const LogPriorityLanes& priorityLanes, Handler handler, FlushHandler flushHandler)
+    : m_options(options)
+    , m_policy(policy)
+    , m_priorityLanes(priorityLanes)
+    , m_handler(std::move(handler))
+    , m_flushHandler(std::move(flushHandler))
+{
+    m_policy.maxEvents = std::max<std::size_t>(m_policy.maxEvents, 1);
+    for (LogPriorityLane& priorityLane : m_priorityLanes.lanes) {
+        priorityLane.capacity = std::max<std::size_t>(priorityLane.capacity, 1);
+        priorityLane.weight = std::max(priorityLane.weight, 1u);
+    }
+
+    workers = std::max<std::size_t>(workers, 1);
+    std::size_t laneCount = std::max(kMinLanes, workers * kLanesPerWorker);
+    for (std::size_t i = 0; i < laneCount; i++) {
+        m_lanes.emplace_back(new Lane());
+        m_lanes.back()->home = i % workers;
+    }
+
+    for (std::size_t i = 0; i < workers; i++) {
+        m_workers.emplace_back(new Worker());
+        m_workers.back()->ready.resize(laneCount);
+        m_workers.back()->batchTarget = m_policy.adaptive ? 1 : m_policy.maxEvents;
+    }
+    for (std::size_t i = 0; i < workers; i++) {
+        m_workers[i]->thread = std::thread(&LogFormatterPool::WorkerLoop, this, i);
+    }
+}
+
+LogFormatterPool::~LogFormatterPool() {
+    Flush();
+
+    {
+        std::lock_guard<std::mutex> lock(m_idleMutex);
+        m_stop = true;
+    }
+    m_idleCondition.notify_all();
+
+    for (auto& worker : m_workers) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+
+    // Everything was sent above, so callers still in FlushThrough return at once
+    {
+        std::unique_lock<std::mutex> lock(m_flushMutex);
+        m_flushCondition.wait(lock, [this] { return m_tickets == 0; });
+    }
+    LogStats::SetQueueDepth(0);
+    for (std::size_t i = 0; i < kLogSeverityClassCount; i++) {
+        LogStats::SetLaneDepth(static_cast<LogSeverityClass>(i), 0);
+    }
+}
+
+void LogFormatterPool::Flush() {
+    std::unique_lock<std::mutex> lock(m_flushMutex);
+    m_flushWaiters++;
+    for (auto& lane : m_lanes) {
+        std::uint64_t target = 0;
+        {
+            std::lock_guard<std::mutex> laneLock(lane->mutex);
+            for (const Queue& queue : lane->queues) {
+                target += queue.submitted.load(std::memory_order_relaxed);
+            }
+        }
+        Lane* waited = lane.get();
+        m_flushCondition.wait(lock, [waited, target] {
+            std::uint64_t completed = 0;
+            for (const Queue& queue : waited->queues) {
+                completed += queue.completed.load();
+            }
+            return completed >= target;
+        });
+    }
+    m_flushWaiters--;
+
+    // Everything is handled now; what the workers still hold is sent from here
+    for (std::size_t i = 0; i < m_workers.size(); i++) {
+        std::lock_guard<std::mutex> batchLock(m_workers[i]->batchMutex);
+        SendBatchLocked(i, std::chrono::steady_clock::now());
+    }
+}
+
+void LogFormatterPool::FlushThrough(Ticket& ticket) {
+    Lane& lane = *ticket.lane;
+    {
+        std::unique_lock<std::mutex> lock(m_flushMutex);
+        m_flushWaiters++;
+        m_flushCondition.wait(lock, [&lane, &ticket] {
+            for (std::size_t i = 0; i < kLogSeverityClassCount; i++) {
+                if (lane.queues[i].completed.load() < ticket.submitted[i]) {
+                    return false;
+                }
+            }
+            return true;
+        });
+        m_flushWaiters--;
+    }
+
+    // Handled records still unsent wait in the batch of the worker that last processed the lane;
+    // Process sent any batch of an earlier worker before it took the lane over
+    std::size_t holder;
+    std::uint64_t generation;
+    {
+        std::lock_guard<std::mutex> lock(lane.mutex);
+        holder = lane.batchedBy;
+        generation = lane.batchGeneration;
+    }
+    if (holder != kNoWorker && m_workers[holder]->generation.load() == generation) {
+        std::lock_guard<std::mutex> batchLock(m_workers[holder]->batchMutex);
+        if (m_workers[holder]->generation.load() == generation) {
+            SendBatchLocked(holder, std::chrono::steady_clock::now());
+        }
+    }
+
+    // Notified under the lock: the destructor may free the pool as soon as it is released
+    std::lock_guard<std::mutex> lock(m_flushMutex);
+    m_tickets--;
+    m_flushCondition.notify_all();
+}
+
+std::uint64_t LogFormatterPool::GetQueueDepth() const {
+    std::uint64_t depth = 0;
+    for (const auto& lane : m_lanes) {
+        for (const Queue& queue : lane->queues) {
+            std::uint64_t completed = queue.completed.load(std::memory_order_relaxed);
+            std::uint64_t submitted = queue.submitted.load(std::memory_order_relaxed);
+            depth += submitted > completed ? submitted - completed : 0;
+        }
+    }
+    return depth;
+}
+
+std::uint64_t LogFormatterPool::GetCpuTime() const {
+    std::uint64_t total = 0;
+    for (const auto& worker : m_workers) {
+        total += LogThread::GetCpuTime(worker->thread);
+    }
+    return total;
+}
+
+void LogFormatterPool::PublishDepth() const {
+    std::uint64_t total = 0;
+    for (std::size_t i = 0; i < kLogSeverityClassCount; i++) {
+        std::uint64_t depth = 0;
+        for (const auto& lane : m_lanes) {
+            std::uint64_t completed = lane->queues[i].completed.load(std::memory_order_relaxed);
+            std::uint64_t submitted = lane->queues[i].submitted.load(std::memory_order_relaxed);
+            depth += submitted > completed ? submitted - completed : 0;
+        }
+        LogStats::SetLaneDepth(static_cast<LogSeverityClass>(i), depth);
+        total += depth;
+    }
+    LogStats::SetQueueDepth(total);
+}
+
+LogFormatterPool::Lane& LogFormatterPool::CurrentLane() {
+    static thread_local std::size_t laneSeed = g_nextLane.fetch_add(1, std::memory_order_relaxed);
+    return *m_lanes[laneSeed % m_lanes.size()];
+}
+
+void LogFormatterPool::DropOldestLocked(Queue& queue, std::size_t capacity) {
+    queue.skip++;
+    queue.completed.store(queue.completed.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+    // Dropped slots move behind the queued records once there are as many as the capacity, so the
+    // buffer stays at twice the capacity and every record is moved once per capacity drops
+    if (queue.skip >= capacity) {
+        std::rotate(queue.records.begin(), queue.records.begin() + static_cast<std::ptrdiff_t>(queue.skip),
+                    queue.records.begin() + static_cast<std::ptrdiff_t>(queue.count));
+        queue.count -= queue.skip;
+        queue.skip = 0;
+    }
+}
+
+void LogFormatterPool::Schedule(Lane& lane, std::size_t worker) {
+    // Counted before it is queued, so the count never falls below the lanes actually queued. Pairs
+    // with the sleeping count a worker raises before it checks the count, so either it sees this
+    // lane or it is waiting by the time it is notified.
+    m_readyLanes.fetch_add(1);
+    {
+        Worker& target = *m_workers[worker];
+        std::lock_guard<std::mutex> lock(target.mutex);
+        target.ready[(target.head + target.size++) % target.ready.size()] = &lane;
+    }
+
+    if (m_sleeping.load() > 0) {
+        std::lock_guard<std::mutex> lock(m_idleMutex);
+        m_idleCondition.notify_one();
+    }
+}
+
+LogFormatterPool::Lane* LogFormatterPool::Take(std::size_t self) {
+    if (m_readyLanes.load(std::memory_order_relaxed) == 0) {
+        return nullptr;
+    }
+
+    for (std::size_t i = 0; i < m_workers.size(); i++) {
+        Worker& worker = *m_workers[(self + i) % m_workers.size()];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (worker.size == 0) {
+            continue;
+        }
+
+        Lane* lane;
+        if (i == 0) {
+            lane = worker.ready[worker.head];
+            worker.head = (worker.head + 1) % worker.ready.size();
+        } else {
+            lane = worker.ready[(worker.head + worker.size - 1) % worker.ready.size()];
+        }
+        worker.size--;
+        m_readyLanes.fetch_sub(1);
+        return lane;
+    }
+    return nullptr;
+}
+
+void LogFormatterPool::Process(Lane& lane, std::size_t self) {
+    // Earlier records of the lane that another worker still holds go out first
+    if (lane.batchedBy != kNoWorker && lane.batchedBy != self) {
+        Worker& other = *m_workers[lane.batchedBy];
+        if (other.generation.load() == lane.batchGeneration) {
+            std::lock_guard<std::mutex> batchLock(other.batchMutex);
+            if (other.generation.load() == lane.batchGeneration) {
+                SendBatchLocked(lane.batchedBy, std::chrono::steady_clock::now());
+            }
+        }
+    }
+
+    // Classes from high to low, each up to its weight; what is left waits for the lane's next turn
+    std::size_t handled[kLogSeverityClassCount] = {};
+    Worker& worker = *m_workers[self];
+    std::uint64_t batchGeneration;
+    {
+        std::lock_guard<std::mutex> batchLock(worker.batchMutex);
+        for (std::size_t i = kLogSeverityClassCount; i-- > 0;) {
+            Queue& queue = lane.queues[i];
+            std::size_t quota = m_priorityLanes.lanes[i].weight * kDrainQuantum;
+            while (quota > 0) {
+                // The whole queue is taken in one swap; producers go on filling the other vector
+                if (queue.position == queue.batchCount) {
+                    bool wasFull;
+                    {
+                        std::lock_guard<std::mutex> lock(lane.mutex);
+                        if (queue.Queued() == 0) {
+                            break;
+                        }
+                        wasFull = queue.Queued() >= m_priorityLanes.lanes[i].capacity;
+                        std::swap(queue.records, queue.batch);
+                        queue.position = queue.skip;
+                        queue.batchCount = queue.count;
+                        queue.skip = 0;
+                        queue.count = 0;
+                    }
+                    if (wasFull) {
+                        lane.space.notify_all();
+                    }
+                }
+
+                HandleLocked(queue.batch[queue.position++], self);
+                handled[i]++;
+                quota--;
+            }
+        }
+        batchGeneration = worker.generation.load(std::memory_order_relaxed);
+    }
+
+    // Published with the completed counts, so FlushThrough finds the batch its records went to
+    bool more = false;
+    {
+        std::lock_guard<std::mutex> lock(lane.mutex);
+        lane.batchedBy = self;
+        lane.batchGeneration = batchGeneration;
+        for (std::size_t i = 0; i < kLogSeverityClassCount; i++) {
+            Queue& queue = lane.queues[i];
+            queue.completed.store(queue.completed.load(std::memory_order_relaxed) + handled[i]);
+            more = more || queue.Queued() > 0 || queue.position < queue.batchCount;
+        }
+        lane.scheduled = more;
+    }
+
+    // Still owned by this worker; it goes to the back of the own queue so other lanes get a turn
+    if (more) {
+        Schedule(lane, self);
+    }
+    if (m_flushWaiters.load() > 0) {
+        std::lock_guard<std::mutex> lock(m_flushMutex);
+        m_flushCondition.notify_all();
+    }
+    PublishDepth();
+}
+
+void LogFormatterPool::HandleLocked(LogRecord& record, std::size_t self) {
+    Worker& worker = *m_workers[self];
+    std::size_t bytes = m_handler(self, record);
+    if (bytes > 0) {
+        if (worker.batchEvents++ == 0) {
+            worker.batchStart = std::chrono::steady_clock::now();
+
+            // After a pause longer than the delay the old rate says nothing; start over
+            if (m_policy.adaptive &&
+                worker.batchStart - worker.lastSend > std::chrono::microseconds(m_policy.maxDelayMicros)) {
+                worker.eventRate = 0.0;
+                worker.batchTarget = 1;
+            }
+        }
+        worker.batchBytes += bytes;
+    }
+
+    // A severe event takes everything before it along at once
+    if (worker.batchEvents >= worker.batchTarget || worker.batchBytes >= m_policy.maxBytes ||
+        (worker.batchEvents > 0 && record.level >= m_policy.flushLevel)) {
+        SendBatchLocked(self, std::chrono::steady_clock::now());
+    }
+    Trim(record.message);
+    Trim(record.context);
+}
+
+void LogFormatterPool::SendBatchLocked(std::size_t index, std::chrono::steady_clock::time_point now) {
+    Worker& worker = *m_workers[index];
+    if (worker.batchEvents == 0) {
+        return;
+    }
+    m_flushHandler(index);
+
+    // Adaptive: as many events as arrive within the delay at the observed rate, so a quiet logger
+    // sends each event on its own and a busy one fills batches before the deadline
+    double elapsed = std::chrono::duration<double>(now - worker.lastSend).count();
+    if (elapsed > 0.0) {
+        double rate = static_cast<double>(worker.batchEvents) / elapsed;
+        worker.eventRate = worker.eventRate > 0.0 ? worker.eventRate + kRateSmoothing * (rate - worker.eventRate) : rate;
+    }
+    worker.lastSend = now;
+    if (m_policy.adaptive) {
+        double target = worker.eventRate * m_policy.maxDelayMicros / 1e6;
+        worker.batchTarget = target < 1.0 ? 1 : std::min(m_policy.maxEvents, static_cast<std::size_t>(target));
+    }
+
+    worker.batchEvents = 0;
+    worker.batchBytes = 0;
+    worker.generation.fetch_add(1);
+}
+
+std::chrono::steady_clock::time_point LogFormatterPool::SendExpired(std::size_t index) {
+    Worker& worker = *m_workers[index];
+    std::lock_guard<std::mutex> batchLock(worker.batchMutex);
+    if (worker.batchEvents == 0) {
+        return std::chrono::steady_clock::time_point();
+    }
+
+    auto deadline = worker.batchStart + std::chrono::microseconds(m_policy.maxDelayMicros);
+    auto now = std::chrono::steady_clock::now();
+    if (now < deadline) {
+        return deadline;
+    }
+    SendBatchLocked(index, now);
+    return std::chrono::steady_clock::time_point();
+}
+
+bool LogFormatterPool::Poll(std::chrono::steady_clock::time_point& idleSince) {
+    switch (m_options.waitStrategy) {
+        case LogWaitStrategy::BusyPoll:
+            LogThread::CpuRelax();
+            return true;
+        case LogWaitStrategy::Yield:
+            std::this_thread::yield();
+            return true;
+        case LogWaitStrategy::SpinThenPark: {
+            auto now = std::chrono::steady_clock::now();
+            if (idleSince == std::chrono::steady_clock::time_point()) {
+                idleSince = now;
+            }
+            if (now - idleSince < std::chrono::microseconds(m_options.spinMicros)) {
+                LogThread::CpuRelax();
+                return true;
+            }
+            return false;
+        }
+        case LogWaitStrategy::Block:
+        default:
+            return false;
+    }
+}
+
+void LogFormatterPool::WorkerLoop(std::size_t self) {
+    // Refusals are reported by LogThread::CanApply to whoever set the options
+    m_options.ApplyToCurrentThread();
+
+    std::chrono::steady_clock::time_point idleSince;
+    for (;;) {
+        Lane* lane = Take(self);
+        if (lane) {
+            Process(*lane, self);
+            SendExpired(self);
+            idleSince = std::chrono::steady_clock::time_point();
+            continue;
+        }
+        if (m_stop.load()) {
+            if (m_readyLanes.load() == 0) {
+                std::lock_guard<std::mutex> batchLock(m_workers[self]->batchMutex);
+                SendBatchLocked(self, std::chrono::steady_clock::now());
+                return;
+            }
+            continue;
+        }
+        auto deadline = SendExpired(self);
+        if (Poll(idleSince)) {
+            continue;
+        }
+
+        // A pending batch bounds the sleep
+        std::unique_lock<std::mutex> lock(m_idleMutex);
+        m_sleeping.fetch_add(1);
+        auto ready = [this] { return m_stop.load() || m_readyLanes.load() > 0; };
+        if (deadline == std::chrono::steady_clock::time_point()) {
+            m_idleCondition.wait(lock, ready);
+        } else {
+            m_idleCondition.wait_until(lock, deadline, ready);
+        }
+        m_sleeping.fetch_sub(1);
+        idleSince = std::chrono::steady_clock::time_point();
+    }
+}
@@ -0,0 +1,250 @@
+#pragma once
+
+#include "Log2ConsoleClock.h"
+#include "Log2ConsoleCommon.h"
+#include "Log2ConsoleStats.h"
+#include "Log2ConsoleThread.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Raw event captured on the logging thread and formatted later on a worker. Everything is copied,
+// so the caller's arguments may go away as soon as the record is queued.
+struct LogRecord {
+    LogTimestamp timestamp = LogTimestamp();
+    LogEventOrigin origin;
+    LogLevel level = LogLevel::L_INFO;
+    bool xml = true;
+    bool hasLocation = false;
+    int line = 0;
+    const char* sourceFile = nullptr;      // caller's file pointer, only used as attribution key
+    std::string category;
+    std::string message;
+    std::string file;
+    std::string function;
+    std::vector<LogProperty> properties;
+    std::string context;                   // fields rendered up front, then the LogContext fragment
+};
+
+// Formatting stage on a pool of worker threads. Every logging thread is bound to one lane, which
+// holds a bounded FIFO of records per severity class (the priority lanes). A lane is owned by one
+// worker at a time; each turn it drains the classes from high to low, each up to its weight, so
+// errors get ahead of a debug flood and the events of a thread within one class reach the handler
+// in the order they were logged. Lanes that have records wait on the run queue of a worker; a
+// worker whose queue is empty steals from the others, so a burst from a few threads still spreads
+// over all workers. Idle workers wait as the thread options say; only a sleeping worker costs
+// logging threads a wake-up call.
+//
+// What the handler produces is collected per worker and sent as one batch when the flush policy
+// says so. A lane whose last records still wait in the batch of another worker has that batch sent
+// before it is processed, so batching never reorders the events of a thread.
+class LogFormatterPool {
+    struct Lane;
+
+public:
+    // Formats the record into the worker's batch; size it added to the batch (0: nothing queued)
+    using Handler = std::function<std::size_t(std::size_t worker, LogRecord& record)>;
+
+    // Sends the worker's batch
+    using FlushHandler = std::function<void(std::size_t worker)>;
+
+    LogFormatterPool(std::size_t workers, const LogThreadOptions& options, const LogFlushPolicy& policy,
+                     const LogPriorityLanes& priorityLanes, Handler handler, FlushHandler flushHandler);
+
+    // Hands what is still queued to the handler, then stops the workers
+    ~LogFormatterPool();
+
+    LogFormatterPool(const LogFormatterPool&) = delete;
+    LogFormatterPool& operator=(const LogFormatterPool&) = delete;
+
+    // A queued record's place in its lane: the records of each class queued there up to and
+    // including it. Holding one keeps the pool alive until it is passed to FlushThrough, so the
+    // caller may leave the RCU read section the pool was found in before waiting.
+    struct Ticket {
+        Lane* lane = nullptr;
+        std::uint64_t submitted[kLogSeverityClassCount] = {};
+    };
+
+    // Queues a record of the level on the calling thread's lane; when the level's class is full,
+    // waits or drops as its overflow policy says (false: the record was dropped). fill(LogRecord&)
+    // writes it in place under the lane's lock, reusing the buffers of an earlier record. With a
+    // ticket, a queued record's place is written to it and must be passed to FlushThrough.
+    template <typename Fill>
+    bool Submit(LogLevel level, Fill&& fill, Ticket* ticket = nullptr);
+
+    // Blocks until every record queued before the call was handed to the handler and sent
+    void Flush();
+
+    // Blocks until the ticket's record and those queued before it on the same lane were sent;
+    // other lanes are not waited for
+    void FlushThrough(Ticket& ticket);
+
+    std::size_t GetWorkerCount() const { return m_workers.size(); }
+    const LogThreadOptions& GetThreadOptions() const { return m_options; }
+    const LogFlushPolicy& GetFlushPolicy() const { return m_policy; }
+    const LogPriorityLanes& GetPriorityLanes() const { return m_priorityLanes; }
+    std::uint64_t GetQueueDepth() const;
+
+    // CPU time the workers have used so far (ns)
+    std::uint64_t GetCpuTime() const;
+
+private:
+    static const std::size_t kNoWorker = static_cast<std::size_t>(-1);
+
+    // Records of one severity class: producers append to records[skip, count) under the lane's
+    // lock, the worker drains batch[position, batchCount) without it
+    struct Queue {
+        std::vector<LogRecord> records;
+        std::size_t skip = 0;               // DropOldest: records dropped from the front
+        std::size_t count = 0;
+        std::vector<LogRecord> batch;
+        std::size_t position = 0;
+        std::size_t batchCount = 0;
+        std::atomic<std::uint64_t> submitted{0};
+        std::atomic<std::uint64_t> completed{0};   // handled, or dropped after being queued
+
+        std::size_t Queued() const { return count - skip; }
+    };
+
+    struct Lane {
+        std::mutex mutex;
+        std::condition_variable space;      // signalled when a full queue was taken by a worker
+        Queue queues[kLogSeverityClassCount];
+        bool scheduled = false;             // on a run queue or being processed by a worker
+        std::size_t home = 0;               // worker whose run queue the lane joins
+        std::size_t batchedBy = kNoWorker;  // worker that handled the last records, and its batch
+        std::uint64_t batchGeneration = 0;  // generation then; still unsent while it is unchanged
+        char padding[64];
+    };
+
+    // Run queue as a ring sized for every lane, a lane is on at most one queue at a time
+    struct Worker {
+        std::mutex mutex;
+        std::vector<Lane*> ready;
+        std::size_t head = 0;
+        std::size_t size = 0;
+        std::thread thread;
+
+        // Batch state, under batchMutex, which is held while records are handled and while the
+        // batch is sent; the generation counts sent batches
+        std::mutex batchMutex;
+        std::size_t batchEvents = 0;
+        std::size_t batchBytes = 0;
+        std::size_t batchTarget = 1;
+        double eventRate = 0.0;             // events per second, smoothed over the sent batches
+        std::chrono::steady_clock::time_point batchStart;
+        std::chrono::steady_clock::time_point lastSend;
+        std::atomic<std::uint64_t> generation{0};
+        char padding[64];
+    };
+
+    Lane& CurrentLane();
+
+    // Makes room in a full DropOldest queue; lane lock held
+    void DropOldestLocked(Queue& queue, std::size_t capacity);
+    void Schedule(Lane& lane, std::size_t worker);
+
+    // Next lane with records: front of the own run queue, else the back of another worker's
+    Lane* Take(std::size_t self);
+    void Process(Lane& lane, std::size_t self);
+
+    // Formats one record into the worker's batch and sends the batch when the policy says so;
+    // the worker's batchMutex held
+    void HandleLocked(LogRecord& record, std::size_t self);
+
+    // Queue depth per severity class and in total, to LogStats
+    void PublishDepth() const;
+    void WorkerLoop(std::size_t self);
+
+    // Sends the worker's batch, if any, and sizes the next one; batchMutex held
+    void SendBatchLocked(std::size_t worker, std::chrono::steady_clock::time_point now);
+
+    // Sends the worker's batch once it is past its deadline; the deadline, or the zero time point
+    // when nothing is pending
+    std::chrono::steady_clock::time_point SendExpired(std::size_t worker);
+
+    // Polling step of the wait strategy; false once the worker should sleep
+    bool Poll(std::chrono::steady_clock::time_point& idleSince);
+
+    LogThreadOptions m_options;
+    LogFlushPolicy m_policy;
+    LogPriorityLanes m_priorityLanes;
+    Handler m_handler;
+    FlushHandler m_flushHandler;
+    std::vector<std::unique_ptr<Lane>> m_lanes;
+    std::vector<std::unique_ptr<Worker>> m_workers;
+
+    // Lanes on run queues; workers sleep while it is 0
+    std::atomic<std::size_t> m_readyLanes{0};
+    std::atomic<std::size_t> m_sleeping{0};
+    std::mutex m_idleMutex;
+    std::condition_variable m_idleCondition;
+    std::atomic<bool> m_stop{false};
+
+    std::atomic<std::size_t> m_flushWaiters{0};
+    std::mutex m_flushMutex;
+    std::condition_variable m_flushCondition;
+
+    // Tickets not yet passed to FlushThrough; the destructor waits for them
+    std::size_t m_tickets = 0;
+};
+
+template <typename Fill>
+bool LogFormatterPool::Submit(LogLevel level, Fill&& fill, Ticket* ticket) {
+    LogSeverityClass severityClass = GetSeverityClass(level);
+    const LogPriorityLane& options = m_priorityLanes[severityClass];
+    Lane& lane = CurrentLane();
+    Queue& queue = lane.queues[static_cast<std::size_t>(severityClass)];
+    bool schedule = false;
+    {
+        std::unique_lock<std::mutex> lock(lane.mutex);
+        if (queue.Queued() >= options.capacity) {
+            switch (options.overflow) {
+            case LogOverflowPolicy::DropNewest:
+                lock.unlock();
+                LogStats::RecordLaneDrop(severityClass);
+                return false;
+            case LogOverflowPolicy::DropOldest:
+                DropOldestLocked(queue, options.capacity);
+                LogStats::RecordLaneDrop(severityClass);
+                break;
+            case LogOverflowPolicy::Block:
+                lane.space.wait(lock, [&queue, &options] { return queue.Queued() < options.capacity; });
+                break;
+            }
+        }
+        if (queue.count == queue.records.size()) {
+            queue.records.emplace_back();
+        }
+        fill(queue.records[queue.count++]);
+        queue.submitted.store(queue.submitted.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        if (!lane.scheduled) {
+            lane.scheduled = true;
+            schedule = true;
+        }
+        if (ticket) {
+            ticket->lane = &lane;
+            for (std::size_t i = 0; i < kLogSeverityClassCount; i++) {
+                ticket->submitted[i] = lane.queues[i].submitted.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    if (ticket) {
+        std::lock_guard<std::mutex> lock(m_flushMutex);
+        m_tickets++;
+    }
+
+    if (schedule) {
+        Schedule(lane, lane.home);
+    }
+    return true;
+}
@@ -0,0 +1,66 @@
+#include "Log2ConsoleLevels.h"
+#include <algorithm>
+
+LogCategoryLevels::LogCategoryLevels(LogLevel defaultLevel)
+    : m_default(defaultLevel)
+{
+}
+
+std::uint32_t LogCategoryLevels::Hash(LogStringRef category) {
+    // FNV-1a
+    std::uint32_t hash = 2166136261u;
+    for (unsigned char c : category) {
+        hash ^= c;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+void LogCategoryLevels::Set(const std::string& category, LogLevel level) {
+    if (level == m_default) {
+        Remove(category);
+        return;
+    }
+
+    std::uint32_t hash = Hash(category);
+    auto it = std::lower_bound(m_entries.begin(), m_entries.end(), hash,
+                               [](const Entry& entry, std::uint32_t value) { return entry.hash < value; });
+    for (auto match = it; match != m_entries.end() && match->hash == hash; ++match) {
+        if (match->category == category) {
+            match->level = level;
+            return;
+        }
+    }
+    m_entries.insert(it, Entry{hash, category, level});
+}
+
+void LogCategoryLevels::Remove(const std::string& category) {
+    std::uint32_t hash = Hash(category);
+    m_entries.erase(std::remove_if(m_entries.begin(), m_entries.end(),
+                                   [&](const Entry& entry) { return entry.hash == hash && entry.category == category; }),
+                    m_entries.end());
+}
+
+LogLevel LogCategoryLevels::Find(LogStringRef category) const {
+    if (m_entries.empty()) {
+        return m_default;
+    }
+
+    std::uint32_t hash = Hash(category);
+    auto it = std::lower_bound(m_entries.begin(), m_entries.end(), hash,
+                               [](const Entry& entry, std::uint32_t value) { return entry.hash < value; });
+    for (; it != m_entries.end() && it->hash == hash; ++it) {
+        if (category == it->category) {
+            return it->level;
+        }
+    }
+    return m_default;
+}
+
+std::vector<std::pair<std::string, LogLevel>> LogCategoryLevels::GetEntries() const {
+    std::vector<std::pair<std::string, LogLevel>> entries;
+    for (const Entry& entry : m_entries) {
+        entries.emplace_back(entry.category, entry.level);
+    }
+    return entries;
+}
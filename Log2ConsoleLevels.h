@@ -0,0 +1,38 @@
+#pragma once
+
+#include "Log2ConsoleCommon.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Minimum level per category, with a default for every other category. Built once and then only
+// read, so a published table is shared by log calls without a lock; Find hashes the category and
+// does not allocate.
+class LogCategoryLevels {
+public:
+    explicit LogCategoryLevels(LogLevel defaultLevel = LogLevel::L_TRACE);
+
+    // Level of the category; setting the default level removes the entry
+    void Set(const std::string& category, LogLevel level);
+    void Remove(const std::string& category);
+    void SetDefault(LogLevel level) { m_default = level; }
+
+    LogLevel Find(LogStringRef category) const;
+    LogLevel GetDefault() const { return m_default; }
+
+    // Categories with a level of their own, in no particular order
+    std::vector<std::pair<std::string, LogLevel>> GetEntries() const;
+    bool IsEmpty() const { return m_entries.empty(); }
+
+private:
+    struct Entry {
+        std::uint32_t hash;
+        std::string category;
+        LogLevel level;
+    };
+
+    static std::uint32_t Hash(LogStringRef category);
+
+    std::vector<Entry> m_entries;   // sorted by hash
+    LogLevel m_default;
+};
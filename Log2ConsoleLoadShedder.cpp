@@ -0,0 +1,133 @@
+#include "Log2ConsoleLoadShedder.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+    // The logger's own events bypass the level filter, so raising them would change nothing
+    const char* const kInternalPrefix = "Log2Console.";
+
+    LogLevel NextLevel(LogLevel level) {
+        return static_cast<LogLevel>(static_cast<int>(level) + 1);
+    }
+
+    LogLevel PreviousLevel(LogLevel level) {
+        return static_cast<LogLevel>(static_cast<int>(level) - 1);
+    }
+
+    // Change of a counter since the previous sample; a counter that went back (replaced workers)
+    // starts over from 0
+    std::uint64_t Delta(std::uint64_t current, std::uint64_t previous) {
+        return current >= previous ? current - previous : current;
+    }
+}
+
+std::vector<LogSheddingTransition> LogLoadShedder::Update(const LogSheddingOptions& options, const LogLoadSample& sample) {
+    std::vector<LogSheddingTransition> transitions;
+
+    // Bytes each category logged during the interval, busiest first
+    std::vector<std::pair<std::uint64_t, const std::string*>> busiest;
+    for (const EmitterStats& category : sample.categories) {
+        std::uint64_t& previous = m_categoryBytes[category.name];
+        std::uint64_t bytes = Delta(category.bytes, previous);
+        previous = category.bytes;
+        if (bytes > 0 && category.name.compare(0, std::strlen(kInternalPrefix), kInternalPrefix) != 0) {
+            busiest.emplace_back(bytes, &category.name);
+        }
+    }
+    std::sort(busiest.begin(), busiest.end(),
+              [](const std::pair<std::uint64_t, const std::string*>& a, const std::pair<std::uint64_t, const std::string*>& b) {
+                  return a.first > b.first;
+              });
+
+    if (!m_primed) {
+        m_primed = true;
+        m_previous.time = sample.time;
+        m_previous.sendErrors = sample.sendErrors;
+        m_previous.busyNanos = sample.busyNanos;
+        return transitions;
+    }
+
+    double seconds = std::chrono::duration<double>(sample.time - m_previous.time).count();
+    m_queueDepth = sample.queueDepth;
+    m_sendErrors = Delta(sample.sendErrors, m_previous.sendErrors);
+    m_busyCores = seconds > 0.0 ? static_cast<double>(Delta(sample.busyNanos, m_previous.busyNanos)) / 1e9 / seconds : 0.0;
+    m_previous.time = sample.time;
+    m_previous.sendErrors = sample.sendErrors;
+    m_previous.busyNanos = sample.busyNanos;
+
+    bool pressure = m_queueDepth >= options.queueDepthHigh || m_sendErrors >= options.sendErrorsHigh ||
+                    m_busyCores >= options.busyCoresHigh;
+    bool calm = m_queueDepth <= options.queueDepthLow && m_sendErrors == 0 && m_busyCores <= options.busyCoresLow;
+
+    if (pressure) {
+        m_calm = 0;
+        std::size_t raised = 0;
+        for (const auto& candidate : busiest) {
+            if (raised == options.categoriesPerStep) {
+                break;
+            }
+            LogLevel level = m_levels.Find(*candidate.second);
+            if (level < options.maxLevel) {
+                Raise(*candidate.second, NextLevel(level), transitions);
+                raised++;
+            }
+        }
+        if (raised == 0 && m_levels.GetDefault() < options.maxLevel) {
+            RaiseDefault(NextLevel(m_levels.GetDefault()), transitions);
+        }
+    } else if (calm) {
+        if (++m_calm >= options.calmIntervals) {
+            m_calm = 0;
+            StepDown(transitions);
+        }
+    } else {
+        m_calm = 0;
+    }
+    return transitions;
+}
+
+std::shared_ptr<const LogCategoryLevels> LogLoadShedder::GetLevels() const {
+    if (m_levels.IsEmpty() && m_levels.GetDefault() == LogLevel::L_TRACE) {
+        return nullptr;
+    }
+    return std::make_shared<LogCategoryLevels>(m_levels);
+}
+
+void LogLoadShedder::Reset() {
+    m_primed = false;
+    m_previous = LogLoadSample();
+    m_categoryBytes.clear();
+    m_levels = LogCategoryLevels();
+    m_calm = 0;
+}
+
+void LogLoadShedder::Raise(const std::string& category, LogLevel to, std::vector<LogSheddingTransition>& transitions) {
+    transitions.push_back(LogSheddingTransition{category, m_levels.Find(category), to});
+    m_levels.Set(category, to);
+}
+
+void LogLoadShedder::RaiseDefault(LogLevel to, std::vector<LogSheddingTransition>& transitions) {
+    transitions.push_back(LogSheddingTransition{std::string(), m_levels.GetDefault(), to});
+    m_levels.SetDefault(to);
+
+    // Categories raised less than the default now have nothing of their own left
+    for (const auto& entry : m_levels.GetEntries()) {
+        if (entry.second <= to) {
+            m_levels.Remove(entry.first);
+        }
+    }
+}
+
+void LogLoadShedder::StepDown(std::vector<LogSheddingTransition>& transitions) {
+    // The default first, so that categories lowered to it drop out of the table
+    if (m_levels.GetDefault() > LogLevel::L_TRACE) {
+        LogLevel to = PreviousLevel(m_levels.GetDefault());
+        transitions.push_back(LogSheddingTransition{std::string(), m_levels.GetDefault(), to});
+        m_levels.SetDefault(to);
+    }
+    for (const auto& entry : m_levels.GetEntries()) {
+        LogLevel to = PreviousLevel(entry.second);
+        transitions.push_back(LogSheddingTransition{entry.first, entry.second, to});
+        m_levels.Set(entry.first, to);
+    }
+}
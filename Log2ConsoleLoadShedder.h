@@ -0,0 +1,80 @@
+#pragma once
+
+#include "Log2ConsoleCommon.h"
+#include "Log2ConsoleLevels.h"
+#include "Log2ConsoleStats.h"
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Thresholds of the load-shedding controller. Pressure is any of: queue depth, send errors or
+// logging time at or above its high mark; it has subsided when all of them are at or below the
+// low marks (no send errors at all). In between, levels are held.
+struct LogSheddingOptions {
+    bool enabled = false;
+    unsigned int intervalMs = 1000;          // how often the load is evaluated
+    std::uint64_t queueDepthHigh = 4096;     // events queued for the formatting workers
+    std::uint64_t queueDepthLow = 512;
+    std::uint64_t sendErrorsHigh = 10;       // failed sends per interval
+    double busyCoresHigh = 0.5;              // formatting workers' CPU time plus the CPU time of log
+    double busyCoresLow = 0.25;              // calls, per second of the interval
+    std::size_t categoriesPerStep = 3;       // busiest categories raised by one level per interval
+    unsigned int calmIntervals = 5;          // intervals without pressure before levels step down
+    LogLevel maxLevel = LogLevel::L_INFO;    // highest level shedding raises a category to
+};
+
+// Load indicators, sampled once per interval; counters are totals, the controller takes deltas
+struct LogLoadSample {
+    std::chrono::steady_clock::time_point time;
+    std::uint64_t queueDepth = 0;
+    std::uint64_t sendErrors = 0;
+    std::uint64_t busyNanos = 0;
+    std::vector<EmitterStats> categories;    // bytes of every category so far
+};
+
+// One change of a shed level; an empty category stands for all categories without a level of their own
+struct LogSheddingTransition {
+    std::string category;
+    LogLevel from;
+    LogLevel to;
+};
+
+// Feedback controller that raises the minimum level of the busiest categories one step at a time
+// (TRACE -> DEBUG -> INFO) while the logger is under pressure, and lowers all raised levels one
+// step after it has been calm for a while. When no category can be raised any more, or attribution
+// is off, the level of all other categories is raised instead. Not thread-safe; the logger drives
+// it from its maintenance thread.
+class LogLoadShedder {
+public:
+    // Feeds one sample and returns the level changes it caused (the first sample only sets the baseline)
+    std::vector<LogSheddingTransition> Update(const LogSheddingOptions& options, const LogLoadSample& sample);
+
+    // Shed levels to publish, nullptr while nothing is shed
+    std::shared_ptr<const LogCategoryLevels> GetLevels() const;
+
+    // Readings of the last interval, for reporting
+    std::uint64_t GetQueueDepth() const { return m_queueDepth; }
+    std::uint64_t GetSendErrors() const { return m_sendErrors; }
+    double GetBusyCores() const { return m_busyCores; }
+
+    // Forgets the levels and the baseline
+    void Reset();
+
+private:
+    void Raise(const std::string& category, LogLevel to, std::vector<LogSheddingTransition>& transitions);
+    void RaiseDefault(LogLevel to, std::vector<LogSheddingTransition>& transitions);
+    void StepDown(std::vector<LogSheddingTransition>& transitions);
+
+    bool m_primed = false;
+    LogLoadSample m_previous;
+    std::unordered_map<std::string, std::uint64_t> m_categoryBytes;
+    LogCategoryLevels m_levels;
+    unsigned int m_calm = 0;
+
+    std::uint64_t m_queueDepth = 0;
+    std::uint64_t m_sendErrors = 0;
+    double m_busyCores = 0.0;
+};
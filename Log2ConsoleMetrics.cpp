@@ -0,0 +1,128 @@
+#include "Log2ConsoleMetrics.h"
+#include <mutex>
+
+namespace {
+    using LogMetrics::kSlotsPerThread;
+    const int kCacheLineSize = 64;
+
+    // Per-thread slot block, written only by its owner; padded so blocks never share a line
+    struct ThreadMetricSlots {
+        char leadingPad[kCacheLineSize];
+        std::atomic<std::int64_t> values[kSlotsPerThread];
+        char trailingPad[kCacheLineSize];
+
+        ThreadMetricSlots() {
+            for (auto& value : values) {
+                value.store(0, std::memory_order_relaxed);
+            }
+        }
+    };
+
+    struct MetricsRegistry {
+        std::mutex mutex;
+        std::vector<ThreadMetricSlots*> live;
+        std::vector<std::int64_t> retired = std::vector<std::int64_t>(kSlotsPerThread, 0);
+    };
+
+    // Intentionally leaked so threads exiting during static destruction can still fold their slots
+    MetricsRegistry& GetMetricsRegistry() {
+        static MetricsRegistry* registry = new MetricsRegistry();
+        return *registry;
+    }
+
+    struct ThreadMetricSlotsHolder {
+        ThreadMetricSlots* slots;
+
+        ThreadMetricSlotsHolder() : slots(new ThreadMetricSlots()) {
+            MetricsRegistry& registry = GetMetricsRegistry();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            registry.live.push_back(slots);
+        }
+
+        ~ThreadMetricSlotsHolder() {
+            MetricsRegistry& registry = GetMetricsRegistry();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            for (std::size_t i = 0; i < kSlotsPerThread; i++) {
+                registry.retired[i] += slots->values[i].load(std::memory_order_relaxed);
+            }
+            for (auto it = registry.live.begin(); it != registry.live.end(); ++it) {
+                if (*it == slots) {
+                    registry.live.erase(it);
+                    break;
+                }
+            }
+            delete slots;
+        }
+    };
+
+    ThreadMetricSlots& GetThreadMetricSlots() {
+        static thread_local ThreadMetricSlotsHolder holder;
+        return *holder.slots;
+    }
+}
+
+MetricSite::MetricSite(const std::string& category, const std::string& name, MetricKind kind, std::size_t id)
+    : m_category(category)
+    , m_name(name)
+    , m_kind(kind)
+    , m_id(id)
+    , m_shared(0)
+    , m_gauge(0)
+    , m_gaugeSet(false)
+    , m_lastReported(0)
+{
+}
+
+void MetricSite::Add(std::int64_t delta) {
+    if (m_id < kSlotsPerThread) {
+        LogMetrics::AddToSlot(m_id, delta);
+    } else {
+        m_shared.fetch_add(delta, std::memory_order_relaxed);
+    }
+}
+
+void MetricSite::Set(std::int64_t value) {
+    m_gauge.store(value, std::memory_order_relaxed);
+    m_gaugeSet.store(true, std::memory_order_release);
+}
+
+bool MetricSite::GetGauge(std::int64_t& value) const {
+    if (!m_gaugeSet.load(std::memory_order_acquire)) {
+        return false;
+    }
+    value = m_gauge.load(std::memory_order_relaxed);
+    return true;
+}
+
+std::int64_t MetricSite::TakeCounterDelta(const std::vector<std::int64_t>& slotTotals) {
+    std::int64_t total = m_shared.load(std::memory_order_relaxed);
+    if (m_id < slotTotals.size()) {
+        total += slotTotals[m_id];
+    }
+
+    std::int64_t delta = total - m_lastReported;
+    m_lastReported = total;
+    return delta;
+}
+
+namespace LogMetrics {
+
+void AddToSlot(std::size_t id, std::int64_t delta) {
+    std::atomic<std::int64_t>& slot = GetThreadMetricSlots().values[id];
+    slot.store(slot.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+}
+
+std::vector<std::int64_t> SumSlots() {
+    MetricsRegistry& registry = GetMetricsRegistry();
+
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    std::vector<std::int64_t> totals = registry.retired;
+    for (const ThreadMetricSlots* slots : registry.live) {
+        for (std::size_t i = 0; i < kSlotsPerThread; i++) {
+            totals[i] += slots->values[i].load(std::memory_order_relaxed);
+        }
+    }
+    return totals;
+}
+
+} // namespace LogMetrics
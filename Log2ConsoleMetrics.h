@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum class MetricKind {
+    Counter = 0,   // summed across threads, reported as the delta of each interval
+    Gauge = 1      // last value set from any thread
+};
+
+// One instance per (category, name) metric used by LTC_COUNTER / LTC_GAUGE. Counter increments
+// go to per-thread slots written only by their owning thread; the flusher sums them.
+class MetricSite {
+public:
+    MetricSite(const std::string& category, const std::string& name, MetricKind kind, std::size_t id);
+
+    MetricSite(const MetricSite&) = delete;
+    MetricSite& operator=(const MetricSite&) = delete;
+
+    void Add(std::int64_t delta);
+    void Set(std::int64_t value);
+
+    const std::string& GetCategory() const { return m_category; }
+    const std::string& GetName() const { return m_name; }
+    MetricKind GetKind() const { return m_kind; }
+    std::size_t GetId() const { return m_id; }
+
+    // Gauge value; returns false if the gauge was never set
+    bool GetGauge(std::int64_t& value) const;
+
+    // Counter change since the previous call, given the slot totals from LogMetrics::SumSlots
+    std::int64_t TakeCounterDelta(const std::vector<std::int64_t>& slotTotals);
+
+private:
+    std::string m_category;
+    std::string m_name;
+    MetricKind m_kind;
+    std::size_t m_id;
+
+    std::atomic<std::int64_t> m_shared;   // counter storage for ids beyond the per-thread slots
+    std::atomic<std::int64_t> m_gauge;
+    std::atomic<bool> m_gaugeSet;
+    std::int64_t m_lastReported;
+};
+
+namespace LogMetrics {
+    // Number of metric ids with per-thread slots; later metrics share one atomic
+    const std::size_t kSlotsPerThread = 1024;
+
+    // Adds delta to the calling thread's slot for the metric id (id < kSlotsPerThread)
+    void AddToSlot(std::size_t id, std::int64_t delta);
+
+    // Sums every thread's slots (including exited threads) for ids [0, kSlotsPerThread)
+    std::vector<std::int64_t> SumSlots();
+}
@@ -0,0 +1,292 @@
+#include "Log2ConsoleProfiler.h"
+#include "PlatformUtils.h"
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+    const std::size_t kSpanRingSize = 4096;
+
+    struct SpanRecord {
+        const ScopeTimerSite* site;
+        std::chrono::steady_clock::time_point start;
+        std::chrono::steady_clock::time_point end;
+    };
+
+    // Single-producer (owning thread) / single-consumer (writer thread) ring of spans
+    struct SpanRing {
+        std::atomic<std::size_t> head{0};
+        std::atomic<std::size_t> tail{0};
+        std::atomic<bool> retired{false};
+        unsigned long threadId = 0;
+        SpanRecord records[kSpanRingSize];
+    };
+
+    struct SpanRegistry {
+        std::mutex mutex;
+        std::vector<SpanRing*> rings;
+        std::atomic<bool> active{false};
+        std::atomic<std::uint64_t> dropped{0};
+
+        std::ofstream file;
+        bool firstEvent = true;
+        unsigned long processId = 0;
+        std::chrono::steady_clock::time_point baseSteady;
+        long long baseWallNanos = 0;
+
+        std::thread writer;
+        std::condition_variable writerCondition;
+        bool writerStop = false;
+        bool recording = false;   // from Start() until Stop() has written the last spans
+    };
+
+    // Intentionally leaked so rings of threads exiting during static destruction stay valid
+    SpanRegistry& GetSpanRegistry() {
+        static SpanRegistry* registry = new SpanRegistry();
+        return *registry;
+    }
+
+    struct SpanRingHolder {
+        SpanRing* ring;
+
+        SpanRingHolder() : ring(new SpanRing()) {
+            ring->threadId = PlatformUtils::GetCurrentThreadId();
+            SpanRegistry& registry = GetSpanRegistry();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            registry.rings.push_back(ring);
+        }
+
+        // While recording, the writer thread frees the ring once it has been drained; otherwise its
+        // spans would be discarded by the next Start() anyway
+        ~SpanRingHolder() {
+            SpanRegistry& registry = GetSpanRegistry();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            if (registry.recording) {
+                ring->retired.store(true, std::memory_order_release);
+                return;
+            }
+            registry.rings.erase(std::find(registry.rings.begin(), registry.rings.end(), ring));
+            delete ring;
+        }
+    };
+
+    SpanRing& GetSpanRing() {
+        static thread_local SpanRingHolder holder;
+        return *holder.ring;
+    }
+
+    void AppendJsonString(std::string& out, const std::string& text) {
+        out += '"';
+        for (char c : text) {
+            switch (c) {
+                case '"':  out += "\\\""; break;
+                case '\\': out += "\\\\"; break;
+                case '\n': out += "\\n"; break;
+                case '\r': out += "\\r"; break;
+                case '\t': out += "\\t"; break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20) {
+                        char escaped[8];
+                        std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                        out += escaped;
+                    } else {
+                        out += c;
+                    }
+                    break;
+            }
+        }
+        out += '"';
+    }
+
+    // Writes all pending spans as "X" (complete) events; registry mutex must be held
+    void DrainSpansLocked(SpanRegistry& registry) {
+        std::string chunk;
+        // Worst case: the fixed text plus two 20-digit integer parts and two 4-character fractions
+        char number[96];
+
+        for (auto it = registry.rings.begin(); it != registry.rings.end();) {
+            SpanRing* ring = *it;
+            bool retired = ring->retired.load(std::memory_order_acquire);
+            std::size_t tail = ring->tail.load(std::memory_order_relaxed);
+            std::size_t head = ring->head.load(std::memory_order_acquire);
+
+            for (std::size_t i = tail; i != head; i++) {
+                const SpanRecord& record = ring->records[i & (kSpanRingSize - 1)];
+                // Integer nanoseconds keep sub-microsecond precision at epoch-sized timestamps
+                long long startNanos = registry.baseWallNanos + static_cast<long long>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(record.start - registry.baseSteady).count());
+                long long durationNanos = static_cast<long long>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(record.end - record.start).count());
+
+                chunk += registry.firstEvent ? "\n" : ",\n";
+                registry.firstEvent = false;
+                chunk += "{\"name\":";
+                AppendJsonString(chunk, record.site->GetName());
+                chunk += ",\"cat\":";
+                AppendJsonString(chunk, record.site->GetCategory());
+                std::snprintf(number, sizeof(number), ",\"ph\":\"X\",\"ts\":%lld.%03lld,\"dur\":%lld.%03lld",
+                              startNanos / 1000, startNanos % 1000, durationNanos / 1000, durationNanos % 1000);
+                chunk += number;
+                std::snprintf(number, sizeof(number), ",\"pid\":%lu,\"tid\":%lu}", registry.processId, ring->threadId);
+                chunk += number;
+            }
+            ring->tail.store(head, std::memory_order_release);
+
+            if (retired && ring->head.load(std::memory_order_acquire) == head) {
+                delete ring;
+                it = registry.rings.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        if (!chunk.empty() && registry.file.is_open()) {
+            registry.file << chunk;
+            registry.file.flush();
+        }
+    }
+
+    void SpanWriterLoop() {
+        SpanRegistry& registry = GetSpanRegistry();
+        std::unique_lock<std::mutex> lock(registry.mutex);
+        while (!registry.writerStop) {
+            registry.writerCondition.wait_for(lock, std::chrono::milliseconds(50));
+            DrainSpansLocked(registry);
+        }
+    }
+}
+
+ScopeTimerSite::ScopeTimerSite(const std::string& category, const std::string& name,
+                               const char* file, const char* function, int line)
+    : m_category(category)
+    , m_name(name)
+    , m_file(file)
+    , m_function(function)
+    , m_line(line)
+    , m_min(std::numeric_limits<std::uint64_t>::max())
+    , m_max(0)
+{
+    for (auto& bucket : m_buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+void ScopeTimerSite::Record(std::uint64_t nanos) {
+    m_buckets[HistogramSnapshot::BucketIndex(nanos)].fetch_add(1, std::memory_order_relaxed);
+
+    std::uint64_t current = m_min.load(std::memory_order_relaxed);
+    while (nanos < current && !m_min.compare_exchange_weak(current, nanos, std::memory_order_relaxed)) {
+    }
+
+    current = m_max.load(std::memory_order_relaxed);
+    while (nanos > current && !m_max.compare_exchange_weak(current, nanos, std::memory_order_relaxed)) {
+    }
+}
+
+ScopeTimerSummary ScopeTimerSite::TakeSummary() {
+    HistogramSnapshot histogram;
+    histogram.buckets.resize(HistogramSnapshot::kBucketCount);
+    for (int i = 0; i < HistogramSnapshot::kBucketCount; i++) {
+        histogram.buckets[i] = m_buckets[i].exchange(0, std::memory_order_relaxed);
+        histogram.count += histogram.buckets[i];
+    }
+
+    ScopeTimerSummary summary;
+    std::uint64_t min = m_min.exchange(std::numeric_limits<std::uint64_t>::max(), std::memory_order_relaxed);
+    histogram.max = m_max.exchange(0, std::memory_order_relaxed);
+
+    if (histogram.count == 0) {
+        return summary;
+    }
+
+    summary.count = histogram.count;
+    summary.minNanos = min;
+    summary.p50Nanos = histogram.Percentile(0.50);
+    summary.p99Nanos = histogram.Percentile(0.99);
+    summary.maxNanos = histogram.max;
+    return summary;
+}
+
+bool SpanRecorder::Start(const std::string& path) {
+    SpanRegistry& registry = GetSpanRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    if (registry.active.load() || registry.writer.joinable()) {
+        return false;
+    }
+
+    registry.file.open(path, std::ios::out | std::ios::trunc);
+    if (!registry.file.is_open()) {
+        return false;
+    }
+
+    // Discard spans left over from a previous recording
+    for (SpanRing* ring : registry.rings) {
+        ring->tail.store(ring->head.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+    // JSON array format - the closing bracket is optional, so a crashed process still leaves a usable trace
+    registry.file << "[";
+    registry.firstEvent = true;
+    registry.processId = PlatformUtils::GetCurrentProcessId();
+    registry.baseSteady = std::chrono::steady_clock::now();
+    registry.baseWallNanos = static_cast<long long>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+    registry.writerStop = false;
+    registry.recording = true;
+    registry.active.store(true, std::memory_order_release);
+    registry.writer = std::thread(SpanWriterLoop);
+    return true;
+}
+
+void SpanRecorder::Stop() {
+    SpanRegistry& registry = GetSpanRegistry();
+    {
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        if (!registry.writer.joinable()) {
+            return;
+        }
+        registry.active.store(false, std::memory_order_release);
+        registry.writerStop = true;
+    }
+    registry.writerCondition.notify_all();
+    registry.writer.join();
+
+    // Frees the rings of threads that exited during the recording, all of them drained now
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    DrainSpansLocked(registry);
+    registry.recording = false;
+    registry.file << "\n]\n";
+    registry.file.close();
+}
+
+bool SpanRecorder::IsActive() {
+    return GetSpanRegistry().active.load(std::memory_order_relaxed);
+}
+
+void SpanRecorder::Record(const ScopeTimerSite& site, std::chrono::steady_clock::time_point start,
+                          std::chrono::steady_clock::time_point end) {
+    SpanRing& ring = GetSpanRing();
+    std::size_t head = ring.head.load(std::memory_order_relaxed);
+    std::size_t tail = ring.tail.load(std::memory_order_acquire);
+
+    if (head - tail >= kSpanRingSize) {
+        GetSpanRegistry().dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    SpanRecord& record = ring.records[head & (kSpanRingSize - 1)];
+    record.site = &site;
+    record.start = start;
+    record.end = end;
+    ring.head.store(head + 1, std::memory_order_release);
+}
+
+std::uint64_t SpanRecorder::GetDroppedSpans() {
+    return GetSpanRegistry().dropped.load(std::memory_order_relaxed);
+}
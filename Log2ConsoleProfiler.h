@@ -0,0 +1,89 @@
+#pragma once
+
+#include "Log2ConsoleStats.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Aggregated durations of one scope-timer callsite over a reporting interval
+struct ScopeTimerSummary {
+    std::uint64_t count = 0;
+    std::uint64_t minNanos = 0;
+    std::uint64_t p50Nanos = 0;
+    std::uint64_t p99Nanos = 0;
+    std::uint64_t maxNanos = 0;
+};
+
+// One instance per LTC_SCOPE_TIMER callsite. Record() is lock-free (atomic increments into a
+// log-linear histogram); TakeSummary() drains the histogram for the current interval.
+class ScopeTimerSite {
+public:
+    ScopeTimerSite(const std::string& category, const std::string& name,
+                   const char* file, const char* function, int line);
+
+    ScopeTimerSite(const ScopeTimerSite&) = delete;
+    ScopeTimerSite& operator=(const ScopeTimerSite&) = delete;
+
+    void Record(std::uint64_t nanos);
+    ScopeTimerSummary TakeSummary();
+
+    const std::string& GetCategory() const { return m_category; }
+    const std::string& GetName() const { return m_name; }
+    const char* GetFile() const { return m_file; }
+    const char* GetFunction() const { return m_function; }
+    int GetLine() const { return m_line; }
+
+private:
+    std::string m_category;
+    std::string m_name;
+    const char* m_file;
+    const char* m_function;
+    int m_line;
+
+    std::atomic<std::uint64_t> m_min;
+    std::atomic<std::uint64_t> m_max;
+    std::atomic<std::uint64_t> m_buckets[HistogramSnapshot::kBucketCount];
+};
+
+// Optional recorder streaming the begin/end of every scope timer as Chrome/Perfetto trace-event
+// JSON. Each span costs a buffer write into a per-thread ring; a background thread drains the
+// rings into the file. Thread ids match the "thread" attribute of the log4j events.
+class SpanRecorder {
+public:
+    static bool Start(const std::string& path);
+    static void Stop();
+    static bool IsActive();
+
+    static void Record(const ScopeTimerSite& site, std::chrono::steady_clock::time_point start,
+                       std::chrono::steady_clock::time_point end);
+
+    // Spans lost because a thread's ring was full
+    static std::uint64_t GetDroppedSpans();
+};
+
+// RAII timer recording the lifetime of the enclosing scope into a site
+class ScopeTimer {
+public:
+    explicit ScopeTimer(ScopeTimerSite& site)
+        : m_site(site)
+        , m_start(std::chrono::steady_clock::now())
+    {
+    }
+
+    ~ScopeTimer() {
+        auto end = std::chrono::steady_clock::now();
+        m_site.Record(static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            end - m_start).count()));
+        if (SpanRecorder::IsActive()) {
+            SpanRecorder::Record(m_site, m_start, end);
+        }
+    }
+
+    ScopeTimer(const ScopeTimer&) = delete;
+    ScopeTimer& operator=(const ScopeTimer&) = delete;
+
+private:
+    ScopeTimerSite& m_site;
+    std::chrono::steady_clock::time_point m_start;
+};
@@ -0,0 +1,123 @@
+#include "Log2ConsoleRcu.h"
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+    const int kCacheLineSize = 64;
+
+    // Epoch the owning thread entered its read section in, 0 while quiescent. Padded rather
+    // than over-aligned: operator new does not honour alignas before C++17.
+    struct ReaderSlot {
+        char leadingPad[kCacheLineSize];
+        std::atomic<std::uint64_t> epoch{0};
+        bool inUse = false;
+        char trailingPad[kCacheLineSize];
+    };
+
+    std::atomic<std::uint64_t> g_epoch{1};
+
+    // Slots are never freed but reused by later threads, so Synchronize() can scan a copy
+    // of the slot list without holding the registry mutex
+    struct ReaderRegistry {
+        std::mutex mutex;
+        std::vector<ReaderSlot*> slots;
+    };
+
+    ReaderRegistry& GetReaderRegistry() {
+        static ReaderRegistry* registry = new ReaderRegistry();
+        return *registry;
+    }
+
+    ReaderSlot* AcquireReaderSlot() {
+        ReaderRegistry& registry = GetReaderRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        for (ReaderSlot* candidate : registry.slots) {
+            if (!candidate->inUse) {
+                candidate->inUse = true;
+                return candidate;
+            }
+        }
+        ReaderSlot* slot = new ReaderSlot();
+        slot->inUse = true;
+        registry.slots.push_back(slot);
+        return slot;
+    }
+
+    struct ThreadReader {
+        ReaderSlot* slot = nullptr;
+        unsigned int depth = 0;
+    };
+
+    // Trivially destructible, so still usable while and after thread-local destructors run,
+    // e.g. when logging from static destructors on the main thread
+    thread_local ThreadReader t_reader;
+    thread_local bool t_releaseRegistered = false;
+
+    // Returns the slot for reuse when the thread exits
+    struct ThreadReaderRelease {
+        ~ThreadReaderRelease() {
+            ReaderRegistry& registry = GetReaderRegistry();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            t_reader.slot->epoch.store(0, std::memory_order_release);
+            t_reader.slot->inUse = false;
+            t_reader.slot = nullptr;
+        }
+    };
+
+    ThreadReader& GetThreadReader() {
+        if (!t_reader.slot) {
+            t_reader.slot = AcquireReaderSlot();
+
+            // A thread reading again after its release ran keeps that slot for good
+            if (!t_releaseRegistered) {
+                t_releaseRegistered = true;
+                static thread_local ThreadReaderRelease release;
+                (void)release;
+            }
+        }
+        return t_reader;
+    }
+}
+
+void LogRcu::EnterRead() {
+    ThreadReader& reader = GetThreadReader();
+    if (reader.depth++ == 0) {
+        // The slot store must be ordered before the reader's loads of the protected pointer
+        reader.slot->epoch.store(g_epoch.load(std::memory_order_relaxed), std::memory_order_seq_cst);
+    }
+}
+
+void LogRcu::ExitRead() {
+    ThreadReader& reader = GetThreadReader();
+    if (--reader.depth == 0) {
+        reader.slot->epoch.store(0, std::memory_order_release);
+    }
+}
+
+void LogRcu::Synchronize() {
+    std::uint64_t target = g_epoch.fetch_add(1, std::memory_order_seq_cst) + 1;
+
+    std::vector<ReaderSlot*> slots;
+    {
+        ReaderRegistry& registry = GetReaderRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        slots = registry.slots;
+    }
+
+    // Readers that entered before the epoch advanced hold an older epoch; later readers
+    // can only observe the newly published pointer. The scan loads are seq_cst like the
+    // reader's slot store and the publishing exchange: either the scan sees a concurrently
+    // entering reader, or that reader sees the new pointer.
+    for (ReaderSlot* slot : slots) {
+        for (;;) {
+            std::uint64_t epoch = slot->epoch.load(std::memory_order_seq_cst);
+            if (epoch == 0 || epoch >= target) {
+                break;
+            }
+            std::this_thread::yield();
+        }
+    }
+}
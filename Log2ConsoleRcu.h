@@ -0,0 +1,39 @@
+#pragma once
+
+// Minimal epoch-based reclamation for read-mostly state. A reader marks itself active in a
+// per-thread, cache-line padded slot for the duration of a ReadGuard; a writer publishes a new
+// pointer, calls Synchronize() and may then free the old one, because every reader that could
+// still hold it has left its critical section. Readers never block and never take a lock.
+namespace LogRcu {
+    void EnterRead();
+    void ExitRead();
+
+    // Waits until all read sections that started before the call have finished.
+    // Must not be called from inside a read section.
+    void Synchronize();
+
+    class ReadGuard {
+    public:
+        ReadGuard() { EnterRead(); }
+        ~ReadGuard() {
+            if (m_held) {
+                ExitRead();
+            }
+        }
+
+        // Leaves the read section before the end of the scope; nothing read under the guard may
+        // be used afterwards
+        void Release() {
+            if (m_held) {
+                m_held = false;
+                ExitRead();
+            }
+        }
+
+        ReadGuard(const ReadGuard&) = delete;
+        ReadGuard& operator=(const ReadGuard&) = delete;
+
+    private:
+        bool m_held = true;
+    };
+}
@@ -0,0 +1,444 @@
+#include "Log2ConsoleSettings.h"
+#include "Log2ConsoleLoadShedder.h"
+#include "PlatformUtils.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <fstream>
+#include <limits>
+#include <sstream>
+
+#ifdef LTC_PLATFORM_LINUX
+    #include <sys/inotify.h>
+    #include <unistd.h>
+#endif
+
+namespace {
+    const char* const kEnvironmentPrefix = "LTC_";
+    const char* const kEnvironmentPath = "LTC_CONFIG";
+    const int kDefaultPort = 4445;
+    const std::chrono::seconds kPollInterval(1);
+
+    // Keys that can be given as environment variables (level.<category> cannot, use LTC_LEVELS)
+    const char* const kKeys[] = {
+        "destinations", "distribution", "format", "level", "levels", "collapse_repeats_ms",
+        "load_shedding", "load_shedding.interval_ms", "startup_buffer", "resolve_interval_ms",
+        "max_datagram_size", "formatting_workers", "flush.max_events", "flush.max_bytes",
+        "flush.max_delay_us", "flush.level", "lane.low", "lane.normal", "lane.high"
+    };
+
+    std::string Trim(const std::string& text) {
+        std::size_t begin = text.find_first_not_of(" \t\r\n");
+        if (begin == std::string::npos) {
+            return std::string();
+        }
+        std::size_t end = text.find_last_not_of(" \t\r\n");
+        return text.substr(begin, end - begin + 1);
+    }
+
+    std::string ToLower(std::string text) {
+        std::transform(text.begin(), text.end(), text.begin(),
+                       [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        return text;
+    }
+
+    std::string ToEnvironmentName(const std::string& key) {
+        std::string name = kEnvironmentPrefix;
+        for (unsigned char c : key) {
+            name += c == '.' ? '_' : static_cast<char>(std::toupper(c));
+        }
+        return name;
+    }
+
+    // Non-empty trimmed items separated by the given characters
+    std::vector<std::string> Split(const std::string& text, const char* separators) {
+        std::vector<std::string> items;
+        std::size_t begin = 0;
+        while (begin <= text.size()) {
+            std::size_t end = text.find_first_of(separators, begin);
+            if (end == std::string::npos) {
+                end = text.size();
+            }
+            std::string item = Trim(text.substr(begin, end - begin));
+            if (!item.empty()) {
+                items.push_back(item);
+            }
+            begin = end + 1;
+        }
+        return items;
+    }
+
+    bool ParseNumber(const std::string& text, unsigned long long& value) {
+        if (text.empty() || !std::isdigit(static_cast<unsigned char>(text[0]))) {
+            return false;
+        }
+        char* end = nullptr;
+        errno = 0;
+        value = std::strtoull(text.c_str(), &end, 10);
+        return *end == '\0' && errno != ERANGE;
+    }
+
+    // Values the setting's type cannot hold are invalid rather than cut down
+    template<typename T>
+    bool ParseNumber(const std::string& text, LogSetting<T>& setting) {
+        unsigned long long value;
+        if (!ParseNumber(text, value) || value > static_cast<unsigned long long>(std::numeric_limits<T>::max())) {
+            return false;
+        }
+        setting = static_cast<T>(value);
+        return true;
+    }
+
+    bool ParseLevel(const std::string& text, LogLevel& level) {
+        static const struct { const char* name; LogLevel level; } kLevels[] = {
+            {"trace", LogLevel::L_TRACE}, {"debug", LogLevel::L_DEBUG}, {"info", LogLevel::L_INFO},
+            {"warn", LogLevel::L_WARN}, {"error", LogLevel::L_ERROR}, {"fatal", LogLevel::L_FATAL}
+        };
+        std::string name = ToLower(text);
+        for (const auto& entry : kLevels) {
+            if (name == entry.name) {
+                level = entry.level;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool ParseLevel(const std::string& text, LogSetting<LogLevel>& setting) {
+        LogLevel level;
+        if (!ParseLevel(text, level)) {
+            return false;
+        }
+        setting = level;
+        return true;
+    }
+
+    // [udp://|tcp://]host[:port], IPv6 literals in brackets when a port is given
+    bool ParseDestination(const std::string& text, LogDestination& destination) {
+        std::string rest = text;
+        destination = LogDestination();
+        std::string scheme = ToLower(rest.substr(0, 6));
+        if (scheme == "udp://" || scheme == "tcp://") {
+            destination.transport = scheme == "tcp://" ? LogTransport::Tcp : LogTransport::Udp;
+            rest = rest.substr(6);
+        }
+
+        std::string port;
+        bool hasPort = false;
+        if (!rest.empty() && rest[0] == '[') {
+            std::size_t close = rest.find(']');
+            if (close == std::string::npos) {
+                return false;
+            }
+            destination.host = rest.substr(1, close - 1);
+            if (close + 1 < rest.size()) {
+                if (rest[close + 1] != ':') {
+                    return false;
+                }
+                port = rest.substr(close + 2);
+                hasPort = true;
+            }
+        } else if (std::count(rest.begin(), rest.end(), ':') == 1) {
+            std::size_t colon = rest.find(':');
+            destination.host = rest.substr(0, colon);
+            port = rest.substr(colon + 1);
+            hasPort = true;
+        } else {
+            destination.host = rest;   // name, IPv4 or bare IPv6 literal
+        }
+
+        unsigned long long number = kDefaultPort;
+        if (hasPort && (!ParseNumber(port, number) || number == 0 || number > 65535)) {
+            return false;
+        }
+        destination.port = static_cast<int>(number);
+        return !destination.host.empty();
+    }
+
+    // capacity [overflow [weight]]; what is left out keeps the default of the class
+    bool ParseLane(const std::string& text, LogSeverityClass severityClass, LogPriorityLane& lane) {
+        std::vector<std::string> parts = Split(text, " \t,");
+        lane = LogPriorityLanes()[severityClass];
+        if (parts.empty() || parts.size() > 3) {
+            return false;
+        }
+
+        unsigned long long number;
+        if (!ParseNumber(parts[0], number) || number == 0 || number > std::numeric_limits<std::size_t>::max()) {
+            return false;
+        }
+        lane.capacity = static_cast<std::size_t>(number);
+
+        if (parts.size() > 1) {
+            std::string overflow = ToLower(parts[1]);
+            if (overflow == "block") {
+                lane.overflow = LogOverflowPolicy::Block;
+            } else if (overflow == "drop_newest") {
+                lane.overflow = LogOverflowPolicy::DropNewest;
+            } else if (overflow == "drop_oldest") {
+                lane.overflow = LogOverflowPolicy::DropOldest;
+            } else {
+                return false;
+            }
+        }
+        if (parts.size() > 2) {
+            if (!ParseNumber(parts[2], number) || number == 0 || number > std::numeric_limits<unsigned int>::max()) {
+                return false;
+            }
+            lane.weight = static_cast<unsigned int>(number);
+        }
+        return true;
+    }
+
+    bool SetCategoryLevel(std::vector<std::pair<std::string, LogLevel>>& levels, const std::string& category,
+                          const std::string& value) {
+        LogLevel level;
+        if (category.empty() || !ParseLevel(value, level)) {
+            return false;
+        }
+        for (auto& entry : levels) {
+            if (entry.first == category) {
+                entry.second = level;
+                return true;
+            }
+        }
+        levels.emplace_back(category, level);
+        return true;
+    }
+}
+
+bool LogSettings::Parse(const std::string& text, std::vector<std::string>& errors) {
+    bool valid = true;
+    std::istringstream lines(text);
+    std::string line;
+    for (int number = 1; std::getline(lines, line); number++) {
+        line = Trim(line.substr(0, line.find('#')));
+        if (line.empty()) {
+            continue;
+        }
+
+        std::string error;
+        std::size_t equals = line.find('=');
+        if (equals == std::string::npos) {
+            error = "expected 'key = value'";
+        } else {
+            Set(Trim(line.substr(0, equals)), Trim(line.substr(equals + 1)), error);
+        }
+        if (!error.empty()) {
+            errors.push_back("line " + std::to_string(number) + ": " + error);
+            valid = false;
+        }
+    }
+    return valid;
+}
+
+bool LogSettings::ParseEnvironment(std::vector<std::string>& errors) {
+    bool valid = true;
+    for (const char* key : kKeys) {
+        std::string name = ToEnvironmentName(key);
+        const char* value = std::getenv(name.c_str());
+        std::string error;
+        if (value && !Set(key, Trim(value), error)) {
+            errors.push_back(name + ": " + error);
+            valid = false;
+        }
+    }
+    return valid;
+}
+
+bool LogSettings::Set(const std::string& key, const std::string& value, std::string& error) {
+    bool valid = true;
+    std::string name = ToLower(key);
+
+    if (name == "destinations") {
+        std::vector<LogDestination> list;
+        for (const std::string& item : Split(value, ",; \t")) {
+            LogDestination destination;
+            if (!ParseDestination(item, destination)) {
+                valid = false;
+                break;
+            }
+            list.push_back(destination);
+        }
+        if (valid && !list.empty()) {
+            destinations = list;
+        } else {
+            valid = false;
+        }
+    } else if (name == "distribution") {
+        std::string mode = ToLower(value);
+        if (mode == "shard") {
+            distribution = LogDistribution::ShardByCategory;
+        } else if (mode == "round_robin") {
+            distribution = LogDistribution::RoundRobin;
+        } else if (mode == "failover") {
+            distribution = LogDistribution::Failover;
+        } else {
+            valid = false;
+        }
+    } else if (name == "format") {
+        std::string format = ToLower(value);
+        valid = format == "xml" || format == "text";
+        if (valid) {
+            xmlFormat = format == "xml";
+        }
+    } else if (name == "level") {
+        valid = ParseLevel(value, minimumLevel);
+    } else if (name.compare(0, 6, "level.") == 0) {
+        // The category keeps its case
+        valid = SetCategoryLevel(categoryLevels, Trim(key.substr(6)), value);
+    } else if (name == "levels") {
+        for (const std::string& item : Split(value, ",;")) {
+            std::size_t equals = item.find('=');
+            if (equals == std::string::npos ||
+                !SetCategoryLevel(categoryLevels, Trim(item.substr(0, equals)), Trim(item.substr(equals + 1)))) {
+                valid = false;
+                break;
+            }
+        }
+    } else if (name == "collapse_repeats_ms") {
+        valid = ParseNumber(value, collapseRepeatsMs);
+    } else if (name == "load_shedding") {
+        if (ToLower(value) == "off") {
+            sheddingLevel = LogLevel::L_TRACE;
+        } else if (ToLower(value) == "on") {
+            sheddingLevel = LogSheddingOptions().maxLevel;
+        } else {
+            valid = ParseLevel(value, sheddingLevel);
+        }
+    } else if (name == "load_shedding.interval_ms") {
+        valid = ParseNumber(value, sheddingIntervalMs) && sheddingIntervalMs.value > 0;
+    } else if (name == "startup_buffer") {
+        valid = ParseNumber(value, startupBufferSize);
+    } else if (name == "resolve_interval_ms") {
+        valid = ParseNumber(value, resolveIntervalMs);
+    } else if (name == "max_datagram_size") {
+        std::vector<std::string> parts = Split(value, " \t,");
+        valid = !parts.empty() && parts.size() <= 2 && ParseNumber(parts[0], maxDatagramSize) &&
+                maxDatagramSize.value > 0;
+        if (valid && parts.size() == 2) {
+            std::string policy = ToLower(parts[1]);
+            if (policy == "truncate") {
+                oversizePolicy = LogOversizePolicy::Truncate;
+            } else if (policy == "split") {
+                oversizePolicy = LogOversizePolicy::Split;
+            } else {
+                valid = false;
+            }
+        }
+    } else if (name == "formatting_workers") {
+        valid = ParseNumber(value, formattingWorkers);
+    } else if (name == "flush.max_events") {
+        valid = ParseNumber(value, flushMaxEvents) && flushMaxEvents.value > 0;
+    } else if (name == "flush.max_bytes") {
+        valid = ParseNumber(value, flushMaxBytes) && flushMaxBytes.value > 0;
+    } else if (name == "flush.max_delay_us") {
+        valid = ParseNumber(value, flushMaxDelayMicros);
+    } else if (name == "flush.level") {
+        valid = ParseLevel(value, flushLevel);
+    } else if (name == "lane.low" || name == "lane.normal" || name == "lane.high") {
+        LogSeverityClass severityClass = name == "lane.low" ? LogSeverityClass::Low
+                                       : name == "lane.normal" ? LogSeverityClass::Normal
+                                       : LogSeverityClass::High;
+        LogPriorityLane lane;
+        valid = ParseLane(value, severityClass, lane);
+        if (valid) {
+            lanes[static_cast<std::size_t>(severityClass)] = lane;
+        }
+    } else {
+        error = "unknown key '" + key + "'";
+        return false;
+    }
+
+    if (!valid) {
+        error = "invalid value '" + value + "' for '" + key + "'";
+    }
+    return valid;
+}
+
+bool LogSettings::ReadFile(const std::string& path, std::string& text) {
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    std::ostringstream content;
+    content << file.rdbuf();
+    text = content.str();
+    return true;
+}
+
+std::string LogSettings::GetEnvironmentPath() {
+    const char* path = std::getenv(kEnvironmentPath);
+    return path ? Trim(path) : std::string();
+}
+
+LogFileWatcher::~LogFileWatcher() {
+    Stop();
+}
+
+bool LogFileWatcher::Watch(const std::string& path) {
+    Stop();
+    if (path.empty()) {
+        return false;
+    }
+
+    m_path = path;
+    m_nextPoll = std::chrono::steady_clock::now() + kPollInterval;
+    std::size_t slash = path.find_last_of("/\\");
+    m_name = slash == std::string::npos ? path : path.substr(slash + 1);
+
+#ifdef LTC_PLATFORM_LINUX
+    // Watch the directory: a file replaced by rename is a new inode that a watch on the file would miss
+    std::string directory = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+    m_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_inotify >= 0 && inotify_add_watch(m_inotify, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        close(m_inotify);
+        m_inotify = -1;   // polling instead
+    }
+#endif
+    return true;
+}
+
+void LogFileWatcher::Stop() {
+#ifdef LTC_PLATFORM_LINUX
+    if (m_inotify >= 0) {
+        close(m_inotify);
+    }
+#endif
+    m_inotify = -1;
+    m_path.clear();
+    m_name.clear();
+}
+
+bool LogFileWatcher::HasChanged() {
+    if (m_path.empty()) {
+        return false;
+    }
+
+#ifdef LTC_PLATFORM_LINUX
+    if (m_inotify >= 0) {
+        bool changed = false;
+        alignas(inotify_event) char buffer[4096];
+        ssize_t length;
+        while ((length = read(m_inotify, buffer, sizeof(buffer))) > 0) {
+            for (char* position = buffer; position < buffer + length;) {
+                const inotify_event* event = reinterpret_cast<const inotify_event*>(position);
+                // Mounted ConfigMaps swap a hidden "..data" link instead of touching the file
+                if (event->len > 0 && (m_name == event->name || event->name[0] == '.')) {
+                    changed = true;
+                }
+                position += sizeof(inotify_event) + event->len;
+            }
+        }
+        return changed;
+    }
+#endif
+
+    auto now = std::chrono::steady_clock::now();
+    if (now < m_nextPoll) {
+        return false;
+    }
+    m_nextPoll = now + kPollInterval;
+    return true;
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "Log2ConsoleCommon.h"
+#include "Log2ConsoleUdpClient.h"
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+// A setting that is either given or left at the logger's current value
+template<typename T>
+struct LogSetting {
+    bool present = false;
+    T value = T();
+
+    LogSetting& operator=(const T& newValue) {
+        present = true;
+        value = newValue;
+        return *this;
+    }
+};
+
+// Logger settings read from a configuration file of "key = value" lines and from LTC_* environment
+// variables (the key in upper case with '.' replaced by '_', e.g. LTC_FLUSH_MAX_EVENTS). Values
+// that are not given keep their current setting, except for category levels: the ones set by the
+// previous configuration are replaced as a whole. '#' starts a comment.
+//
+//   destinations = tcp://console-a:4505, console-b          (udp:// and port 4445 by default)
+//   distribution = shard | round_robin | failover
+//   format = xml | text
+//   level = INFO                                            minimum level
+//   level.Orders = DEBUG                                    level of one category, may be lower
+//   levels = Orders=DEBUG, Net=WARN                         the same as a list (LTC_LEVELS)
+//   collapse_repeats_ms = 1000                              0 = off
+//   load_shedding = INFO                                    off or the highest level to shed to
+//   load_shedding.interval_ms = 1000
+//   startup_buffer = 1024
+//   resolve_interval_ms = 30000
+//   max_datagram_size = 1472 split                          truncate or split
+//   formatting_workers = 2
+//   flush.max_events = 64, flush.max_bytes, flush.max_delay_us, flush.level
+//   lane.low = 4096 drop_newest 1                           capacity [overflow [weight]]
+struct LogSettings {
+    LogSetting<std::vector<LogDestination>> destinations;
+    LogSetting<LogDistribution> distribution;
+    LogSetting<bool> xmlFormat;
+    LogSetting<LogLevel> minimumLevel;
+    std::vector<std::pair<std::string, LogLevel>> categoryLevels;
+    LogSetting<unsigned int> collapseRepeatsMs;
+    LogSetting<LogLevel> sheddingLevel;                 // L_TRACE = off
+    LogSetting<unsigned int> sheddingIntervalMs;
+    LogSetting<std::size_t> startupBufferSize;
+    LogSetting<unsigned int> resolveIntervalMs;
+    LogSetting<std::size_t> maxDatagramSize;
+    LogSetting<LogOversizePolicy> oversizePolicy;
+    LogSetting<std::size_t> formattingWorkers;
+    LogSetting<std::size_t> flushMaxEvents;
+    LogSetting<std::size_t> flushMaxBytes;
+    LogSetting<unsigned int> flushMaxDelayMicros;
+    LogSetting<LogLevel> flushLevel;
+    LogSetting<LogPriorityLane> lanes[kLogSeverityClassCount];
+
+    // Parses configuration file text; false if any line is invalid, described in errors as "line N: ..."
+    bool Parse(const std::string& text, std::vector<std::string>& errors);
+
+    // Reads the LTC_* environment variables on top of what was parsed before
+    bool ParseEnvironment(std::vector<std::string>& errors);
+
+    // Sets one key; false with a description if the key is unknown or the value invalid
+    bool Set(const std::string& key, const std::string& value, std::string& error);
+
+    // Reads a whole file; false if it cannot be opened
+    static bool ReadFile(const std::string& path, std::string& text);
+
+    // Path of the configuration file named by LTC_CONFIG, empty if unset
+    static std::string GetEnvironmentPath();
+};
+
+// Reports changes to a file without blocking: on Linux through inotify on its directory, so files
+// replaced by rename (editors, mounted ConfigMaps) are noticed too, elsewhere by polling once a
+// second. Changes are reported generously; readers compare the content to skip duplicates.
+class LogFileWatcher {
+public:
+    LogFileWatcher() = default;
+    ~LogFileWatcher();
+    LogFileWatcher(const LogFileWatcher&) = delete;
+    LogFileWatcher& operator=(const LogFileWatcher&) = delete;
+
+    bool Watch(const std::string& path);
+    void Stop();
+    bool IsWatching() const { return !m_path.empty(); }
+    const std::string& GetPath() const { return m_path; }
+
+    // True if the file may have changed since the last call
+    bool HasChanged();
+
+private:
+    std::string m_path;
+    std::string m_name;
+    int m_inotify = -1;
+    std::chrono::steady_clock::time_point m_nextPoll;
+};
@@ -0,0 +1,523 @@
+#include "Log2ConsoleStats.h"
+#include "Log2ConsoleThread.h"
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <sstream>
+
+namespace {
+    const int kCounterCount = static_cast<int>(StatCounter::Count);
+    const int kHistogramCount = static_cast<int>(StatHistogram::Count);
+    const int kCacheLineSize = 64;
+
+    struct ThreadHistogram {
+        std::atomic<std::uint64_t> count;
+        std::atomic<std::uint64_t> sum;
+        std::atomic<std::uint64_t> max;
+        std::atomic<std::uint64_t> buckets[HistogramSnapshot::kBucketCount];
+    };
+
+    const char* const kUnknownCallsite = "(unknown)";
+    const std::size_t kCallsiteSlots = 512;
+    const std::size_t kCategorySlots = 128;
+
+    // One log call in this many is sampled for its CPU time
+    const std::uint32_t kCpuSampleInterval = 16;
+
+    // Slots are claimed by the owning thread only: counters first, then the key with release
+    // ordering, so a reader that sees the key also sees a consistent slot.
+    struct CallsiteSlot {
+        std::atomic<const char*> file;
+        std::atomic<int> line;
+        std::atomic<std::uint64_t> events;
+        std::atomic<std::uint64_t> bytes;
+    };
+
+    struct CategorySlot {
+        std::atomic<const std::string*> name;
+        std::atomic<std::size_t> hash;
+        std::atomic<std::uint64_t> events;
+        std::atomic<std::uint64_t> bytes;
+    };
+
+    // Events of a thread whose table is full; bytes first, then events with release ordering
+    struct OverflowSlot {
+        std::atomic<std::uint64_t> events;
+        std::atomic<std::uint64_t> bytes;
+    };
+
+    // Per-thread block, written only by its owner; padded so neighbouring blocks never share a line
+    struct ThreadStats {
+        char leadingPad[kCacheLineSize];
+        std::atomic<std::uint64_t> counters[kCounterCount];
+        ThreadHistogram histograms[kHistogramCount];
+        CallsiteSlot callsites[kCallsiteSlots];
+        CategorySlot categories[kCategorySlots];
+        OverflowSlot callsiteOverflow;
+        OverflowSlot categoryOverflow;
+        char trailingPad[kCacheLineSize];
+
+        ThreadStats() {
+            for (auto& counter : counters) {
+                counter.store(0, std::memory_order_relaxed);
+            }
+            for (auto& histogram : histograms) {
+                histogram.count.store(0, std::memory_order_relaxed);
+                histogram.sum.store(0, std::memory_order_relaxed);
+                histogram.max.store(0, std::memory_order_relaxed);
+                for (auto& bucket : histogram.buckets) {
+                    bucket.store(0, std::memory_order_relaxed);
+                }
+            }
+            for (auto& slot : callsites) {
+                slot.file.store(nullptr, std::memory_order_relaxed);
+                slot.line.store(0, std::memory_order_relaxed);
+                slot.events.store(0, std::memory_order_relaxed);
+                slot.bytes.store(0, std::memory_order_relaxed);
+            }
+            for (auto& slot : categories) {
+                slot.name.store(nullptr, std::memory_order_relaxed);
+                slot.hash.store(0, std::memory_order_relaxed);
+                slot.events.store(0, std::memory_order_relaxed);
+                slot.bytes.store(0, std::memory_order_relaxed);
+            }
+            callsiteOverflow.events.store(0, std::memory_order_relaxed);
+            callsiteOverflow.bytes.store(0, std::memory_order_relaxed);
+            categoryOverflow.events.store(0, std::memory_order_relaxed);
+            categoryOverflow.bytes.store(0, std::memory_order_relaxed);
+        }
+
+        ~ThreadStats() {
+            for (auto& slot : categories) {
+                delete slot.name.load(std::memory_order_relaxed);
+            }
+        }
+    };
+
+    // Single-writer increment, no locked read-modify-write needed
+    inline void Add(std::atomic<std::uint64_t>& value, std::uint64_t delta) {
+        value.store(value.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+    }
+
+    inline void AddOverflow(OverflowSlot& slot, std::uint64_t bytes) {
+        Add(slot.bytes, bytes);
+        slot.events.store(slot.events.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    struct Totals {
+        std::uint64_t counters[kCounterCount] = {};
+        HistogramSnapshot histograms[kHistogramCount];
+        std::map<std::string, EmitterStats> callsites;
+        std::map<std::string, EmitterStats> categories;
+
+        Totals() {
+            for (auto& histogram : histograms) {
+                histogram.buckets.assign(HistogramSnapshot::kBucketCount, 0);
+            }
+        }
+
+        void Accumulate(const ThreadStats& stats) {
+            for (int i = 0; i < kCounterCount; i++) {
+                counters[i] += stats.counters[i].load(std::memory_order_relaxed);
+            }
+            for (int h = 0; h < kHistogramCount; h++) {
+                const ThreadHistogram& source = stats.histograms[h];
+                HistogramSnapshot& target = histograms[h];
+                target.count += source.count.load(std::memory_order_relaxed);
+                target.sum += source.sum.load(std::memory_order_relaxed);
+                std::uint64_t max = source.max.load(std::memory_order_relaxed);
+                if (max > target.max) {
+                    target.max = max;
+                }
+                for (int b = 0; b < HistogramSnapshot::kBucketCount; b++) {
+                    target.buckets[b] += source.buckets[b].load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        void AccumulateEmitters(const ThreadStats& stats) {
+            for (const auto& slot : stats.callsites) {
+                const char* file = slot.file.load(std::memory_order_acquire);
+                if (!file) {
+                    continue;
+                }
+                std::string name = std::string(file) + ":" + std::to_string(slot.line.load(std::memory_order_relaxed));
+                Merge(callsites, name, slot.events.load(std::memory_order_relaxed), slot.bytes.load(std::memory_order_relaxed));
+            }
+            for (const auto& slot : stats.categories) {
+                const std::string* name = slot.name.load(std::memory_order_acquire);
+                if (!name) {
+                    continue;
+                }
+                Merge(categories, *name, slot.events.load(std::memory_order_relaxed), slot.bytes.load(std::memory_order_relaxed));
+            }
+            MergeOverflow(callsites, stats.callsiteOverflow);
+            MergeOverflow(categories, stats.categoryOverflow);
+        }
+
+        static void MergeOverflow(std::map<std::string, EmitterStats>& target, const OverflowSlot& slot) {
+            std::uint64_t events = slot.events.load(std::memory_order_acquire);
+            if (events > 0) {
+                Merge(target, "(overflow)", events, slot.bytes.load(std::memory_order_relaxed));
+            }
+        }
+
+        static void Merge(std::map<std::string, EmitterStats>& target, const std::string& name,
+                          std::uint64_t events, std::uint64_t bytes) {
+            EmitterStats& entry = target[name];
+            entry.name = name;
+            entry.events += events;
+            entry.bytes += bytes;
+        }
+    };
+
+    struct Registry {
+        std::mutex mutex;
+        std::vector<ThreadStats*> live;
+        Totals retired;
+        std::atomic<std::uint64_t> queueDepth{0};
+        std::atomic<std::uint64_t> laneDepth[kLogSeverityClassCount] = {};
+        std::atomic<bool> timingEnabled{true};
+        std::atomic<bool> attributionEnabled{true};
+        std::atomic<bool> cpuSamplingEnabled{false};
+    };
+
+    // Intentionally leaked so threads exiting during static destruction can still fold their stats
+    Registry& GetRegistry() {
+        static Registry* registry = new Registry();
+        return *registry;
+    }
+
+    // Trivially destructible, so still readable while and after thread-local destructors run
+    thread_local bool t_statsHolderDestroyed = false;
+    thread_local ThreadStats* t_lateStats = nullptr;
+
+    struct ThreadStatsHolder {
+        ThreadStats* stats;
+
+        ThreadStatsHolder() : stats(new ThreadStats()) {
+            Registry& registry = GetRegistry();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            registry.live.push_back(stats);
+        }
+
+        ~ThreadStatsHolder() {
+            Registry& registry = GetRegistry();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            registry.retired.Accumulate(*stats);
+            registry.retired.AccumulateEmitters(*stats);
+            for (auto it = registry.live.begin(); it != registry.live.end(); ++it) {
+                if (*it == stats) {
+                    registry.live.erase(it);
+                    break;
+                }
+            }
+            delete stats;
+            t_statsHolderDestroyed = true;
+        }
+    };
+
+    ThreadStats& GetThreadStats() {
+        if (t_statsHolderDestroyed) {
+            // Logging after this thread's thread-local destructors ran, e.g. from static
+            // destructors on the main thread: use a block that stays registered for good
+            if (!t_lateStats) {
+                t_lateStats = new ThreadStats();
+                Registry& registry = GetRegistry();
+                std::lock_guard<std::mutex> lock(registry.mutex);
+                registry.live.push_back(t_lateStats);
+            }
+            return *t_lateStats;
+        }
+
+        static thread_local ThreadStatsHolder holder;
+        return *holder.stats;
+    }
+}
+
+const int HistogramSnapshot::kSubBucketBits;
+const int HistogramSnapshot::kBucketCount;
+
+int HistogramSnapshot::BucketIndex(std::uint64_t value) {
+    if (value < (1u << kSubBucketBits)) {
+        return static_cast<int>(value);
+    }
+
+    int msb = 63;
+    while (!(value & (1ULL << msb))) {
+        msb--;
+    }
+
+    int shift = msb - kSubBucketBits;
+    int subBucket = static_cast<int>((value >> shift) & ((1u << kSubBucketBits) - 1));
+    return ((shift + 1) << kSubBucketBits) + subBucket;
+}
+
+std::uint64_t HistogramSnapshot::BucketUpperBound(int index) {
+    if (index < (1 << kSubBucketBits)) {
+        return static_cast<std::uint64_t>(index);
+    }
+
+    int shift = (index >> kSubBucketBits) - 1;
+    std::uint64_t subBucket = static_cast<std::uint64_t>(index & ((1 << kSubBucketBits) - 1));
+    std::uint64_t lower = ((1ULL << kSubBucketBits) | subBucket) << shift;
+    return lower + ((1ULL << shift) - 1);
+}
+
+std::uint64_t HistogramSnapshot::Percentile(double q) const {
+    if (count == 0 || buckets.empty()) {
+        return 0;
+    }
+
+    std::uint64_t rank = static_cast<std::uint64_t>(q * static_cast<double>(count - 1)) + 1;
+    std::uint64_t seen = 0;
+    for (int i = 0; i < kBucketCount; i++) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            std::uint64_t bound = BucketUpperBound(i);
+            return bound < max ? bound : max;
+        }
+    }
+    return max;
+}
+
+std::string LogStatsSnapshot::ToString() const {
+    std::ostringstream oss;
+    oss << "events=" << events
+        << " bytes=" << bytes
+        << " sendErrors=" << sendErrors
+        << " drops=" << drops
+        << " tokenSuppressions=" << tokenSuppressions
+        << " repeatSuppressions=" << repeatSuppressions
+        << " addressChanges=" << addressChanges
+        << " resolveFailures=" << resolveFailures
+        << " truncatedEvents=" << truncatedEvents
+        << " splitEvents=" << splitEvents
+        << " eventChunks=" << eventChunks
+        << " batches=" << batches
+        << " severityFlushes=" << severityFlushes
+        << " shedEvents=" << shedEvents
+        << " callCpuNs=" << callCpuNanos
+        << " queueDepth=" << queueDepth
+        << " laneDepth=" << laneDepth[0] << "/" << laneDepth[1] << "/" << laneDepth[2]
+        << " laneDrops=" << laneDrops[0] << "/" << laneDrops[1] << "/" << laneDrops[2]
+        << " callP50Ns=" << callLatency.Percentile(0.50)
+        << " callP99Ns=" << callLatency.Percentile(0.99)
+        << " callMaxNs=" << callLatency.max
+        << " formatP50Ns=" << formatTime.Percentile(0.50)
+        << " formatP99Ns=" << formatTime.Percentile(0.99)
+        << " sendP50Ns=" << sendTime.Percentile(0.50)
+        << " sendP99Ns=" << sendTime.Percentile(0.99);
+    return oss.str();
+}
+
+namespace LogStats {
+
+void Increment(StatCounter counter, std::uint64_t delta) {
+    Add(GetThreadStats().counters[static_cast<int>(counter)], delta);
+}
+
+void Record(StatHistogram histogram, std::uint64_t nanos) {
+    ThreadHistogram& target = GetThreadStats().histograms[static_cast<int>(histogram)];
+    Add(target.count, 1);
+    Add(target.sum, nanos);
+    Add(target.buckets[HistogramSnapshot::BucketIndex(nanos)], 1);
+    if (nanos > target.max.load(std::memory_order_relaxed)) {
+        target.max.store(nanos, std::memory_order_relaxed);
+    }
+}
+
+void SetQueueDepth(std::uint64_t depth) {
+    GetRegistry().queueDepth.store(depth, std::memory_order_relaxed);
+}
+
+void SetLaneDepth(LogSeverityClass severityClass, std::uint64_t depth) {
+    GetRegistry().laneDepth[static_cast<int>(severityClass)].store(depth, std::memory_order_relaxed);
+}
+
+void RecordLaneDrop(LogSeverityClass severityClass) {
+    Increment(StatCounter::Drops);
+    Increment(static_cast<StatCounter>(static_cast<int>(StatCounter::LowLaneDrops) + static_cast<int>(severityClass)));
+}
+
+void SetTimingEnabled(bool enabled) {
+    GetRegistry().timingEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool IsTimingEnabled() {
+    return GetRegistry().timingEnabled.load(std::memory_order_relaxed);
+}
+
+void SetCpuSamplingEnabled(bool enabled) {
+    GetRegistry().cpuSamplingEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+std::uint64_t BeginCpuSample() {
+    if (!GetRegistry().cpuSamplingEnabled.load(std::memory_order_relaxed)) {
+        return 0;
+    }
+    static thread_local std::uint32_t calls = 0;
+    if (++calls % kCpuSampleInterval != 0) {
+        return 0;
+    }
+    return LogThread::GetCurrentCpuTime();
+}
+
+void EndCpuSample(std::uint64_t start) {
+    std::uint64_t end = LogThread::GetCurrentCpuTime();
+    if (end > start) {
+        Increment(StatCounter::CallCpuNanos, (end - start) * kCpuSampleInterval);
+    }
+}
+
+LogStatsSnapshot Snapshot() {
+    Registry& registry = GetRegistry();
+    Totals totals;
+    {
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        totals = registry.retired;
+        for (const ThreadStats* stats : registry.live) {
+            totals.Accumulate(*stats);
+        }
+    }
+
+    LogStatsSnapshot snapshot;
+    snapshot.events = totals.counters[static_cast<int>(StatCounter::Events)];
+    snapshot.bytes = totals.counters[static_cast<int>(StatCounter::Bytes)];
+    snapshot.sendErrors = totals.counters[static_cast<int>(StatCounter::SendErrors)];
+    snapshot.drops = totals.counters[static_cast<int>(StatCounter::Drops)];
+    snapshot.tokenSuppressions = totals.counters[static_cast<int>(StatCounter::TokenSuppressions)];
+    snapshot.repeatSuppressions = totals.counters[static_cast<int>(StatCounter::RepeatSuppressions)];
+    snapshot.addressChanges = totals.counters[static_cast<int>(StatCounter::AddressChanges)];
+    snapshot.resolveFailures = totals.counters[static_cast<int>(StatCounter::ResolveFailures)];
+    snapshot.truncatedEvents = totals.counters[static_cast<int>(StatCounter::TruncatedEvents)];
+    snapshot.splitEvents = totals.counters[static_cast<int>(StatCounter::SplitEvents)];
+    snapshot.eventChunks = totals.counters[static_cast<int>(StatCounter::EventChunks)];
+    snapshot.batches = totals.counters[static_cast<int>(StatCounter::Batches)];
+    snapshot.severityFlushes = totals.counters[static_cast<int>(StatCounter::SeverityFlushes)];
+    snapshot.shedEvents = totals.counters[static_cast<int>(StatCounter::ShedEvents)];
+    snapshot.callCpuNanos = totals.counters[static_cast<int>(StatCounter::CallCpuNanos)];
+    snapshot.queueDepth = registry.queueDepth.load(std::memory_order_relaxed);
+    for (std::size_t i = 0; i < kLogSeverityClassCount; i++) {
+        snapshot.laneDepth[i] = registry.laneDepth[i].load(std::memory_order_relaxed);
+        snapshot.laneDrops[i] = totals.counters[static_cast<int>(StatCounter::LowLaneDrops) + i];
+    }
+    snapshot.callLatency = totals.histograms[static_cast<int>(StatHistogram::CallLatency)];
+    snapshot.formatTime = totals.histograms[static_cast<int>(StatHistogram::FormatTime)];
+    snapshot.sendTime = totals.histograms[static_cast<int>(StatHistogram::SendTime)];
+    return snapshot;
+}
+
+} // namespace LogStats
+
+namespace LogStats {
+
+void RecordEmitter(const char* file, int line, LogStringRef category, std::uint64_t bytes) {
+    if (!IsAttributionEnabled()) {
+        return;
+    }
+
+    ThreadStats& stats = GetThreadStats();
+    if (!file) {
+        file = kUnknownCallsite;
+        line = 0;
+    }
+
+    // Callsite table, keyed on the __FILE__ pointer and line
+    std::size_t hash = std::hash<const void*>{}(file) ^ (static_cast<std::size_t>(line) * 0x9e3779b9u);
+    bool recorded = false;
+    for (std::size_t probe = 0; probe < kCallsiteSlots && !recorded; probe++) {
+        CallsiteSlot& slot = stats.callsites[(hash + probe) & (kCallsiteSlots - 1)];
+        const char* slotFile = slot.file.load(std::memory_order_relaxed);
+        if (slotFile == file && slot.line.load(std::memory_order_relaxed) == line) {
+            Add(slot.events, 1);
+            Add(slot.bytes, bytes);
+            recorded = true;
+        } else if (!slotFile) {
+            slot.line.store(line, std::memory_order_relaxed);
+            slot.events.store(1, std::memory_order_relaxed);
+            slot.bytes.store(bytes, std::memory_order_relaxed);
+            slot.file.store(file, std::memory_order_release);
+            recorded = true;
+        }
+    }
+    if (!recorded) {
+        // Table full - account the event so totals still add up
+        AddOverflow(stats.callsiteOverflow, bytes);
+    }
+
+    // Category table, keyed on the category name
+    std::size_t categoryHash = category.Hash();
+    for (std::size_t probe = 0; probe < kCategorySlots; probe++) {
+        CategorySlot& slot = stats.categories[(categoryHash + probe) & (kCategorySlots - 1)];
+        const std::string* name = slot.name.load(std::memory_order_relaxed);
+        if (name && slot.hash.load(std::memory_order_relaxed) == categoryHash && *name == category) {
+            Add(slot.events, 1);
+            Add(slot.bytes, bytes);
+            return;
+        }
+        if (!name) {
+            slot.hash.store(categoryHash, std::memory_order_relaxed);
+            slot.events.store(1, std::memory_order_relaxed);
+            slot.bytes.store(bytes, std::memory_order_relaxed);
+            slot.name.store(new std::string(category.Data(), category.Size()), std::memory_order_release);
+            return;
+        }
+    }
+
+    AddOverflow(stats.categoryOverflow, bytes);
+}
+
+void SetAttributionEnabled(bool enabled) {
+    GetRegistry().attributionEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool IsAttributionEnabled() {
+    return GetRegistry().attributionEnabled.load(std::memory_order_relaxed);
+}
+
+std::vector<EmitterStats> TopEmitters(EmitterKind kind, std::size_t count, bool byBytes) {
+    Registry& registry = GetRegistry();
+    Totals totals;
+    {
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        totals.callsites = registry.retired.callsites;
+        totals.categories = registry.retired.categories;
+        for (const ThreadStats* stats : registry.live) {
+            totals.AccumulateEmitters(*stats);
+        }
+    }
+
+    const std::map<std::string, EmitterStats>& source = kind == EmitterKind::Callsite ? totals.callsites : totals.categories;
+    std::vector<EmitterStats> result;
+    result.reserve(source.size());
+    for (const auto& entry : source) {
+        result.push_back(entry.second);
+    }
+
+    std::sort(result.begin(), result.end(), [byBytes](const EmitterStats& a, const EmitterStats& b) {
+        return byBytes ? a.bytes > b.bytes : a.events > b.events;
+    });
+    if (result.size() > count) {
+        result.resize(count);
+    }
+    return result;
+}
+
+std::string FormatTopEmitters(std::size_t count) {
+    std::ostringstream oss;
+    const char* titles[] = {"callsites", "categories"};
+    const EmitterKind kinds[] = {EmitterKind::Callsite, EmitterKind::Category};
+
+    for (int k = 0; k < 2; k++) {
+        oss << "Top " << count << " " << titles[k] << " by bytes:\n";
+        for (const EmitterStats& emitter : TopEmitters(kinds[k], count)) {
+            oss << "  " << emitter.bytes << " bytes, " << emitter.events << " events  " << emitter.name << "\n";
+        }
+    }
+    return oss.str();
+}
+
+} // namespace LogStats
@@ -0,0 +1,188 @@
+#pragma once
+
+#include "Log2ConsoleCommon.h"
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Monotonic counters kept by the logging pipeline
+enum class StatCounter {
+    Events = 0,           // events handed to the transport successfully
+    Bytes,                // bytes handed to the transport successfully
+    SendErrors,           // failed sendto calls
+    Drops,                // events discarded before reaching the transport
+    TokenSuppressions,    // events suppressed by LogToken
+    RepeatSuppressions,   // events collapsed by repeat collapsing
+    AddressChanges,       // destination address changed on re-resolution
+    ResolveFailures,      // failed destination re-resolutions
+    TruncatedEvents,      // events cut to the maximum datagram size
+    SplitEvents,          // events split into several chunk datagrams
+    EventChunks,          // chunk datagrams produced by splitting
+    Batches,              // batches sent by the formatting workers
+    SeverityFlushes,      // flushes forced by an event at or above the flush level
+    ShedEvents,           // events below a level raised by load shedding
+    CallCpuNanos,         // CPU time of logging threads inside Logger::Log, from sampled calls
+    LowLaneDrops,         // events shed by the priority lanes, per severity class
+    NormalLaneDrops,
+    HighLaneDrops,
+    Count
+};
+
+// Latency distributions kept by the logging pipeline (nanoseconds)
+enum class StatHistogram {
+    CallLatency = 0,      // caller-side duration of Logger::Log
+    FormatTime,           // time spent formatting an event
+    SendTime,             // time spent in the transport send call
+    Count
+};
+
+// Log-linear histogram: each power of two is split into 8 linear sub-buckets (<= 12.5% error)
+struct HistogramSnapshot {
+    static const int kSubBucketBits = 3;
+    static const int kBucketCount = 64 << kSubBucketBits;
+
+    std::uint64_t count = 0;
+    std::uint64_t sum = 0;
+    std::uint64_t max = 0;
+    std::vector<std::uint64_t> buckets;
+
+    static int BucketIndex(std::uint64_t value);
+    static std::uint64_t BucketUpperBound(int index);
+
+    // Approximate value at quantile q (0..1), 0 if empty
+    std::uint64_t Percentile(double q) const;
+    double Mean() const { return count ? static_cast<double>(sum) / static_cast<double>(count) : 0.0; }
+};
+
+struct LogStatsSnapshot {
+    std::uint64_t events = 0;
+    std::uint64_t bytes = 0;
+    std::uint64_t sendErrors = 0;
+    std::uint64_t drops = 0;
+    std::uint64_t tokenSuppressions = 0;
+    std::uint64_t repeatSuppressions = 0;
+    std::uint64_t addressChanges = 0;
+    std::uint64_t resolveFailures = 0;
+    std::uint64_t truncatedEvents = 0;
+    std::uint64_t splitEvents = 0;
+    std::uint64_t eventChunks = 0;
+    std::uint64_t batches = 0;
+    std::uint64_t severityFlushes = 0;
+    std::uint64_t shedEvents = 0;
+    std::uint64_t callCpuNanos = 0;
+    std::uint64_t queueDepth = 0;
+
+    // Per priority lane, indexed by LogSeverityClass; lane drops are included in drops
+    std::uint64_t laneDepth[kLogSeverityClassCount] = {};
+    std::uint64_t laneDrops[kLogSeverityClassCount] = {};
+
+    HistogramSnapshot callLatency;
+    HistogramSnapshot formatTime;
+    HistogramSnapshot sendTime;
+
+    // Single-line "name=value" rendering used by the periodic self-report
+    std::string ToString() const;
+};
+
+// Event and byte totals attributed to one callsite ("file:line") or one category
+struct EmitterStats {
+    std::string name;
+    std::uint64_t events = 0;
+    std::uint64_t bytes = 0;
+};
+
+enum class EmitterKind {
+    Callsite = 0,
+    Category = 1
+};
+
+namespace LogStats {
+    // Counters and histograms live in per-thread, cache-line padded blocks that only their
+    // owning thread writes; Snapshot() sums all live and exited threads.
+    void Increment(StatCounter counter, std::uint64_t delta = 1);
+    void Record(StatHistogram histogram, std::uint64_t nanos);
+
+    // Events waiting for the formatting workers (0 while events are formatted on the logging thread)
+    void SetQueueDepth(std::uint64_t depth);
+    void SetLaneDepth(LogSeverityClass severityClass, std::uint64_t depth);
+
+    // An event shed by a full priority lane
+    void RecordLaneDrop(LogSeverityClass severityClass);
+
+    // Histogram timing can be turned off to save the clock reads; counters are always kept
+    void SetTimingEnabled(bool enabled);
+    bool IsTimingEnabled();
+
+    // While on (load shedding turns it on), every 16th log call of a thread reads the thread's CPU
+    // time around the call and counts 16 times the difference as CallCpuNanos. BeginCpuSample
+    // returns 0 for calls that are not sampled.
+    void SetCpuSamplingEnabled(bool enabled);
+    std::uint64_t BeginCpuSample();
+    void EndCpuSample(std::uint64_t start);
+
+    LogStatsSnapshot Snapshot();
+
+    // Top-talker attribution: per-thread open-addressing tables keyed on callsite and category.
+    // file may be null for events logged without location information.
+    void RecordEmitter(const char* file, int line, LogStringRef category, std::uint64_t bytes);
+    void SetAttributionEnabled(bool enabled);
+    bool IsAttributionEnabled();
+
+    // Emitters sorted by bytes (or events) in descending order, at most count entries
+    std::vector<EmitterStats> TopEmitters(EmitterKind kind, std::size_t count, bool byBytes = true);
+
+    // Multi-line "top N callsites / categories" report
+    std::string FormatTopEmitters(std::size_t count);
+
+    // Records the lifetime of the scope into a histogram (when timing is enabled)
+    class ScopedTimer {
+    public:
+        explicit ScopedTimer(StatHistogram histogram)
+            : m_histogram(histogram)
+            , m_enabled(IsTimingEnabled())
+        {
+            if (m_enabled) {
+                m_start = std::chrono::steady_clock::now();
+            }
+        }
+
+        ~ScopedTimer() {
+            if (m_enabled) {
+                Record(m_histogram, static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - m_start).count()));
+            }
+        }
+
+        ScopedTimer(const ScopedTimer&) = delete;
+        ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+    private:
+        StatHistogram m_histogram;
+        bool m_enabled;
+        std::chrono::steady_clock::time_point m_start;
+    };
+
+    // Caller side of a log call: its latency and its sampled CPU time
+    class CallTimer {
+    public:
+        CallTimer()
+            : m_timer(StatHistogram::CallLatency)
+            , m_cpuStart(BeginCpuSample())
+        {
+        }
+
+        ~CallTimer() {
+            if (m_cpuStart != 0) {
+                EndCpuSample(m_cpuStart);
+            }
+        }
+
+        CallTimer(const CallTimer&) = delete;
+        CallTimer& operator=(const CallTimer&) = delete;
+
+    private:
+        ScopedTimer m_timer;
+        std::uint64_t m_cpuStart;
+    };
+}
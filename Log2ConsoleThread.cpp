@@ -0,0 +1,161 @@
+#include "Log2ConsoleThread.h"
+#include "PlatformUtils.h"
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <x86intrin.h>
+    #define LTC_HAS_PAUSE
+#elif defined(_M_X64) || defined(_M_IX86)
+    #include <intrin.h>
+    #define LTC_HAS_PAUSE
+#endif
+
+#ifdef LTC_PLATFORM_LINUX
+    #include <sched.h>
+    #include <sys/resource.h>
+    #include <time.h>
+#endif
+
+namespace {
+    bool ApplyAffinity(const std::vector<int>& cpus) {
+        if (cpus.empty()) {
+            return true;
+        }
+#ifdef LTC_PLATFORM_WINDOWS
+        // Processor group of the thread only, i.e. the first 64 CPUs
+        DWORD_PTR mask = 0;
+        for (int cpu : cpus) {
+            if (cpu < 0 || cpu >= static_cast<int>(sizeof(DWORD_PTR) * 8)) {
+                return false;
+            }
+            mask |= static_cast<DWORD_PTR>(1) << cpu;
+        }
+        return SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+#else
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : cpus) {
+            if (cpu < 0 || cpu >= CPU_SETSIZE) {
+                return false;
+            }
+            CPU_SET(cpu, &set);
+        }
+        return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#endif
+    }
+
+    bool ApplyPriority(LogThreadPriority priority) {
+        if (priority == LogThreadPriority::Inherit) {
+            return true;
+        }
+#ifdef LTC_PLATFORM_WINDOWS
+        int level = THREAD_PRIORITY_NORMAL;
+        switch (priority) {
+            case LogThreadPriority::Lowest:      level = THREAD_PRIORITY_LOWEST; break;
+            case LogThreadPriority::BelowNormal: level = THREAD_PRIORITY_BELOW_NORMAL; break;
+            case LogThreadPriority::AboveNormal: level = THREAD_PRIORITY_ABOVE_NORMAL; break;
+            case LogThreadPriority::Highest:     level = THREAD_PRIORITY_HIGHEST; break;
+            case LogThreadPriority::RealTime:    level = THREAD_PRIORITY_TIME_CRITICAL; break;
+            default: break;
+        }
+        return SetThreadPriority(GetCurrentThread(), level) != 0;
+#else
+        if (priority == LogThreadPriority::RealTime) {
+            struct sched_param param;
+            param.sched_priority = 1;
+            return pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0;
+        }
+
+        // Back to the time-sharing policy in case the thread was real-time before
+        struct sched_param param;
+        param.sched_priority = 0;
+        if (pthread_setschedparam(pthread_self(), SCHED_OTHER, &param) != 0) {
+            return false;
+        }
+
+        // The nice value is per thread on Linux, addressed by the thread id
+        int nice = 0;
+        switch (priority) {
+            case LogThreadPriority::Lowest:      nice = 19; break;
+            case LogThreadPriority::BelowNormal: nice = 10; break;
+            case LogThreadPriority::AboveNormal: nice = -5; break;
+            case LogThreadPriority::Highest:     nice = -10; break;
+            default: break;
+        }
+        return setpriority(PRIO_PROCESS, static_cast<id_t>(PlatformUtils::GetCurrentThreadId()), nice) == 0;
+#endif
+    }
+}
+
+bool LogThreadOptions::ApplyToCurrentThread() const {
+    // Both are tried, so a refused priority still leaves the affinity in place
+    bool affinity = ApplyAffinity(cpus);
+    bool priorityApplied = ApplyPriority(priority);
+    return affinity && priorityApplied;
+}
+
+namespace LogThread {
+
+void CpuRelax() {
+#ifdef LTC_HAS_PAUSE
+    _mm_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+bool CanApply(const LogThreadOptions& options) {
+    bool applied = false;
+    std::thread probe([&options, &applied]() { applied = options.ApplyToCurrentThread(); });
+    probe.join();
+    return applied;
+}
+
+std::uint64_t GetCpuTime(std::thread& thread) {
+    if (!thread.joinable()) {
+        return 0;
+    }
+#ifdef LTC_PLATFORM_WINDOWS
+    FILETIME creation, exit, kernel, user;
+    if (!GetThreadTimes(thread.native_handle(), &creation, &exit, &kernel, &user)) {
+        return 0;
+    }
+    // 100 ns units
+    auto ticks = [](const FILETIME& time) {
+        return (static_cast<std::uint64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+    };
+    return (ticks(kernel) + ticks(user)) * 100;
+#elif defined(LTC_PLATFORM_LINUX)
+    clockid_t clock;
+    struct timespec time;
+    if (pthread_getcpuclockid(thread.native_handle(), &clock) != 0 || clock_gettime(clock, &time) != 0) {
+        return 0;
+    }
+    return static_cast<std::uint64_t>(time.tv_sec) * 1000000000ull + static_cast<std::uint64_t>(time.tv_nsec);
+#else
+    return 0;
+#endif
+}
+
+std::uint64_t GetCurrentCpuTime() {
+#ifdef LTC_PLATFORM_WINDOWS
+    FILETIME creation, exit, kernel, user;
+    if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user)) {
+        return 0;
+    }
+    auto ticks = [](const FILETIME& time) {
+        return (static_cast<std::uint64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+    };
+    return (ticks(kernel) + ticks(user)) * 100;
+#elif defined(LTC_PLATFORM_LINUX)
+    struct timespec time;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time) != 0) {
+        return 0;
+    }
+    return static_cast<std::uint64_t>(time.tv_sec) * 1000000000ull + static_cast<std::uint64_t>(time.tv_nsec);
+#else
+    return 0;
+#endif
+}
+
+} // namespace LogThread
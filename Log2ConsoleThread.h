@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+// How an idle formatting worker waits for the next event
+enum class LogWaitStrategy {
+    Block = 0,        // sleep on a condition variable that logging threads signal (default)
+    Yield,            // poll, giving up the time slice between polls
+    SpinThenPark,     // poll for spinMicros, then sleep as with Block
+    BusyPoll          // poll without ever giving up the core
+};
+
+// Scheduling priority of the background threads relative to normal threads
+enum class LogThreadPriority {
+    Inherit = 0,      // leave as created (default)
+    Lowest,           // Linux nice 19, Windows THREAD_PRIORITY_LOWEST
+    BelowNormal,      // nice 10, THREAD_PRIORITY_BELOW_NORMAL
+    Normal,           // nice 0, THREAD_PRIORITY_NORMAL
+    AboveNormal,      // nice -5, THREAD_PRIORITY_ABOVE_NORMAL
+    Highest,          // nice -10, THREAD_PRIORITY_HIGHEST
+    RealTime          // SCHED_FIFO priority 1, THREAD_PRIORITY_TIME_CRITICAL
+};
+
+// Placement and waiting behaviour of the logger's background threads. On Linux, raising the
+// priority above Normal or RealTime needs CAP_SYS_NICE (or a matching RLIMIT_NICE / RLIMIT_RTPRIO).
+struct LogThreadOptions {
+    std::vector<int> cpus;                                  // CPUs the threads may run on (empty = any)
+    LogThreadPriority priority = LogThreadPriority::Inherit;
+    LogWaitStrategy waitStrategy = LogWaitStrategy::Block;
+    unsigned int spinMicros = 50;                           // SpinThenPark: polling time before sleeping
+
+    // Applies affinity and priority to the calling thread; false if any part was refused
+    bool ApplyToCurrentThread() const;
+
+    bool operator==(const LogThreadOptions& other) const {
+        return cpus == other.cpus && priority == other.priority && waitStrategy == other.waitStrategy &&
+               spinMicros == other.spinMicros;
+    }
+    bool operator!=(const LogThreadOptions& other) const { return !(*this == other); }
+};
+
+namespace LogThread {
+    // Tells the CPU the caller is polling (pause on x86), freeing resources for a sibling hyperthread
+    void CpuRelax();
+
+    // Whether options can be applied on this system, tried on a short-lived thread
+    bool CanApply(const LogThreadOptions& options);
+
+    // CPU time the running thread has used so far (ns), 0 if the platform cannot tell
+    std::uint64_t GetCpuTime(std::thread& thread);
+
+    // The same for the calling thread
+    std::uint64_t GetCurrentCpuTime();
+}
@@ -1,42 +1,413 @@
 #include "Log2ConsoleUdpClient.h"
+#include "Log2ConsoleContext.h"
+#include "Log2ConsoleFormatterPool.h"
+#include "Log2ConsoleRcu.h"
+#include "Log2ConsoleStats.h"
 #include "SocketPlatform.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
 #include <cstring>
+#include <limits>
 #include <string>
 
+namespace {
+    // Retry period for destinations that are down, and bound on TCP connect and send calls so a
+    // stalled console fails over instead of blocking logging threads
+    const std::chrono::milliseconds kReconnectInterval(1000);
+    const int kTcpTimeoutMs = 1000;
+
+    // Largest UDP payload over IPv4
+    const std::size_t kMaxDatagramSize = 65507;
+
+    // Messages from this size on are sent straight from the caller's buffer with scatter-gather
+    // I/O; below it one contiguous string is cheaper than the extra fragments
+    const std::size_t kScatterGatherThreshold = 1024;
+
+    // Datagrams handed to the kernel per system call when a batch is sent
+    const std::size_t kMaxBatchDatagrams = 64;
+
+    // Batch buffers that grew beyond this are released after sending instead of kept for reuse
+    const std::size_t kMaxRetainedBatch = 256 * 1024;
+
+    // Where the message sits in a formatted event that exceeded the datagram size limit, so a
+    // datagram destination can cut it when it is sent; offset is npos for events that fit
+    struct MessageSpan {
+        std::size_t offset = std::string::npos;
+        std::size_t size = 0;
+        bool xml = false;
+    };
+
+    // Events a formatting worker collected for one send, back to back in data
+    struct SendBatch {
+        struct Entry {
+            std::size_t offset;
+            std::size_t length;
+            std::uint32_t shardKey;
+            MessageSpan span;
+        };
+        std::string data;
+        std::vector<Entry> entries;
+    };
+
+    // Batch of the formatting worker running on this thread, while it handles a record
+    thread_local SendBatch* t_sendBatch = nullptr;
+
+    // FNV-1a, identical on every platform and process so a category always maps to the same shard
+    std::uint32_t HashCategory(LogStringRef category) {
+        std::uint32_t hash = 2166136261u;
+        for (unsigned char c : category) {
+            hash ^= c;
+            hash *= 16777619u;
+        }
+        return hash;
+    }
+
+    // Moves a cut position back so it does not fall inside a UTF-8 sequence
+    std::size_t Utf8Boundary(LogStringRef text, std::size_t position) {
+        while (position > 0 && position < text.Size() && (static_cast<unsigned char>(text[position]) & 0xC0) == 0x80) {
+            position--;
+        }
+        return position;
+    }
+
+    // Gathers the fragments into one datagram (address given) or stream write; bytes sent or -1
+    int SendVector(socket_t socket, const LogFragment* fragments, std::size_t count,
+                   const struct sockaddr* address, socklen_t addressLength, int flags) {
+#ifdef LTC_PLATFORM_WINDOWS
+        WSABUF buffers[LogEventFragments::kMaxFragments];
+        for (std::size_t i = 0; i < count; i++) {
+            buffers[i].buf = const_cast<CHAR*>(fragments[i].data);
+            buffers[i].len = static_cast<ULONG>(fragments[i].length);
+        }
+        DWORD sent = 0;
+        int result = address
+            ? WSASendTo(socket, buffers, static_cast<DWORD>(count), &sent, static_cast<DWORD>(flags), address, addressLength, nullptr, nullptr)
+            : WSASend(socket, buffers, static_cast<DWORD>(count), &sent, static_cast<DWORD>(flags), nullptr, nullptr);
+        return result == 0 ? static_cast<int>(sent) : SOCKET_ERROR_VALUE;
+#else
+        struct iovec vectors[LogEventFragments::kMaxFragments];
+        for (std::size_t i = 0; i < count; i++) {
+            vectors[i].iov_base = const_cast<char*>(fragments[i].data);
+            vectors[i].iov_len = fragments[i].length;
+        }
+        struct msghdr header{};
+        header.msg_name = const_cast<struct sockaddr*>(address);
+        header.msg_namelen = address ? addressLength : 0;
+        header.msg_iov = vectors;
+        header.msg_iovlen = count;
+        return static_cast<int>(sendmsg(socket, &header, flags));
+#endif
+    }
+
+    // Sends each message as a datagram of its own, in one system call where the platform has one;
+    // the number sent, or -1 if the first one failed
+    int SendDatagrams(socket_t socket, const LogFragment* messages, std::size_t count,
+                      const struct sockaddr* address, socklen_t addressLength) {
+#ifdef LTC_PLATFORM_LINUX
+        struct mmsghdr headers[kMaxBatchDatagrams];
+        struct iovec vectors[kMaxBatchDatagrams];
+        count = std::min(count, kMaxBatchDatagrams);
+        for (std::size_t i = 0; i < count; i++) {
+            vectors[i].iov_base = const_cast<char*>(messages[i].data);
+            vectors[i].iov_len = messages[i].length;
+            headers[i] = mmsghdr();
+            headers[i].msg_hdr.msg_name = const_cast<struct sockaddr*>(address);
+            headers[i].msg_hdr.msg_namelen = addressLength;
+            headers[i].msg_hdr.msg_iov = &vectors[i];
+            headers[i].msg_hdr.msg_iovlen = 1;
+        }
+        return sendmmsg(socket, headers, static_cast<unsigned int>(count), 0);
+#else
+        int sent = 0;
+        for (std::size_t i = 0; i < count; i++) {
+            if (SendVector(socket, &messages[i], 1, address, addressLength, 0) == SOCKET_ERROR_VALUE) {
+                return sent > 0 ? sent : SOCKET_ERROR_VALUE;
+            }
+            sent++;
+        }
+        return sent;
+#endif
+    }
+
+    std::size_t DecimalDigits(std::size_t value) {
+        std::size_t digits = 1;
+        while (value >= 10) {
+            value /= 10;
+            digits++;
+        }
+        return digits;
+    }
+
+    bool IsMulticast(const struct sockaddr_storage& address) {
+        if (address.ss_family == AF_INET6) {
+            return IN6_IS_ADDR_MULTICAST(&reinterpret_cast<const struct sockaddr_in6&>(address).sin6_addr) != 0;
+        }
+        std::uint32_t ip = ntohl(reinterpret_cast<const struct sockaddr_in&>(address).sin_addr.s_addr);
+        return (ip & 0xF0000000u) == 0xE0000000u;
+    }
+
+    // Interface index from a name ("eth0") or a number; 0 if unknown or out of range
+    unsigned int InterfaceIndex(const std::string& name) {
+        if (!name.empty() && name.find_first_not_of("0123456789") == std::string::npos) {
+            errno = 0;
+            unsigned long long index = std::strtoull(name.c_str(), nullptr, 10);
+            if (errno == ERANGE || index > std::numeric_limits<unsigned int>::max()) {
+                return 0;
+            }
+            return static_cast<unsigned int>(index);
+        }
+        return if_nametoindex(name.c_str());
+    }
+
+    bool ApplyMulticastOptions(socket_t socket, int family, const LogDestination& target) {
+        int ttl = target.multicastTtl;
+        int loopback = target.multicastLoopback ? 1 : 0;
+
+        if (family == AF_INET6) {
+            if (setsockopt(socket, IPPROTO_IPV6, IPV6_MULTICAST_HOPS, (const char*)&ttl, sizeof(ttl)) != 0 ||
+                setsockopt(socket, IPPROTO_IPV6, IPV6_MULTICAST_LOOP, (const char*)&loopback, sizeof(loopback)) != 0) {
+                return false;
+            }
+            if (!target.multicastInterface.empty()) {
+                unsigned int index = InterfaceIndex(target.multicastInterface);
+                if (index == 0 ||
+                    setsockopt(socket, IPPROTO_IPV6, IPV6_MULTICAST_IF, (const char*)&index, sizeof(index)) != 0) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        if (setsockopt(socket, IPPROTO_IP, IP_MULTICAST_TTL, (const char*)&ttl, sizeof(ttl)) != 0 ||
+            setsockopt(socket, IPPROTO_IP, IP_MULTICAST_LOOP, (const char*)&loopback, sizeof(loopback)) != 0) {
+            return false;
+        }
+        if (target.multicastInterface.empty()) {
+            return true;
+        }
+
+        // IPv4 selects the interface by one of its addresses, or by index
+        struct in_addr interfaceAddress{};
+        if (inet_pton(AF_INET, target.multicastInterface.c_str(), &interfaceAddress) != 1) {
+            unsigned int index = InterfaceIndex(target.multicastInterface);
+            if (index == 0) {
+                return false;
+            }
+#ifdef LTC_PLATFORM_WINDOWS
+            // Winsock takes an index in the form 0.0.0.index
+            interfaceAddress.s_addr = htonl(index);
+#else
+            struct ip_mreqn request{};
+            request.imr_ifindex = static_cast<int>(index);
+            return setsockopt(socket, IPPROTO_IP, IP_MULTICAST_IF, &request, sizeof(request)) == 0;
+#endif
+        }
+        return setsockopt(socket, IPPROTO_IP, IP_MULTICAST_IF, (const char*)&interfaceAddress, sizeof(interfaceAddress)) == 0;
+    }
+}
+
+std::string DestinationStats::ToString() const {
+    std::ostringstream oss;
+    oss << name
+        << " up=" << (up ? 1 : 0)
+        << " events=" << events
+        << " bytes=" << bytes
+        << " sendErrors=" << sendErrors
+        << " redirects=" << redirects
+        << " reconnects=" << reconnects;
+    return oss.str();
+}
+
 class Log2ConsoleUdpClient::Impl {
 public:
-    Impl(const std::string& serverHost, int serverPort, bool useXmlFormat)
-        : m_serverHost(serverHost)
-        , m_serverPort(serverPort)
-        , m_socket(INVALID_SOCKET_VALUE)
+    Impl(const std::vector<LogDestination>& destinations, LogDistribution distribution, bool useXmlFormat)
+        : m_distribution(distribution)
         , m_initialized(false)
         , m_useXmlFormat(useXmlFormat)
     {
         SocketPlatform::Initialize();
+
+        for (const LogDestination& target : destinations) {
+            m_endpoints.emplace_back(new Endpoint(target));
+        }
+        m_sharded = distribution == LogDistribution::ShardByCategory && m_endpoints.size() > 1;
+        m_hasDatagramEndpoint = std::any_of(m_endpoints.begin(), m_endpoints.end(),
+                                            [](const std::unique_ptr<Endpoint>& endpoint) { return !endpoint->IsTcp(); });
     }
 
     ~Impl() {
+        // Queued events are formatted first, they may still reach the transport or early buffer
+        delete m_formatterPool.exchange(nullptr);
+
+        // Events that never got a transport are lost
+        if (!m_earlyBuffer.empty()) {
+            LogStats::Increment(StatCounter::Drops, m_earlyBuffer.size());
+        }
         Cleanup();
         SocketPlatform::Cleanup();
     }
 
-    std::string m_serverHost;
-    int m_serverPort;
-    socket_t m_socket;
-    bool m_initialized;
-    bool m_useXmlFormat;
-    
-    struct sockaddr_in m_serverAddr;
-    std::mutex m_sendMutex;
+    // Resolved address, replaced as a whole on re-resolution while senders keep using the
+    // old one inside an LogRcu read section
+    struct Destination {
+        struct sockaddr_storage address;
+        socklen_t length;
+        socket_t socket;     // UDP: the endpoint's datagram socket for this address family
+    };
+
+    // One destination with its own socket, address and counters
+    struct Endpoint {
+        explicit Endpoint(const LogDestination& destination) : target(destination) {}
+
+        LogDestination target;
+        socket_t socket = INVALID_SOCKET_VALUE;                  // TCP connection
+        socket_t datagramSockets[2] = {INVALID_SOCKET_VALUE, INVALID_SOCKET_VALUE};   // UDP, IPv4 / IPv6
+        std::atomic<const Destination*> destination{nullptr};
+        std::atomic<bool> up{false};
+
+        // TCP only: keeps events whole on the stream and guards replacing the socket
+        std::mutex sendMutex;
+
+        std::atomic<std::uint64_t> events{0};
+        std::atomic<std::uint64_t> bytes{0};
+        std::atomic<std::uint64_t> sendErrors{0};
+        std::atomic<std::uint64_t> redirects{0};
+        std::atomic<std::uint64_t> reconnects{0};
+
+        bool IsTcp() const { return target.transport == LogTransport::Tcp; }
+    };
+
+    std::vector<std::unique_ptr<Endpoint>> m_endpoints;
+    LogDistribution m_distribution;
+    bool m_sharded = false;
+    bool m_hasDatagramEndpoint = false;
+
+    // Datagram size limit and what happens to events above it
+    std::atomic<std::size_t> m_maxDatagramSize{kMaxDatagramSize};
+    std::atomic<LogOversizePolicy> m_oversizePolicy{LogOversizePolicy::Truncate};
+    std::atomic<bool> m_initialized;
+    std::atomic<bool> m_useXmlFormat;
+    std::mutex m_initMutex;
+
+    // Background re-resolution (every m_resolveInterval, 0 = off) and reconnection of
+    // destinations that are down; a new generation restarts the wait
+    std::thread m_resolverThread;
+    std::mutex m_resolverMutex;
+    std::condition_variable m_resolverCondition;
+    bool m_resolverStop = false;
+    unsigned long m_resolverGeneration = 0;
+    std::chrono::milliseconds m_resolveInterval{0};
+    LogThreadOptions m_resolverOptions;
+
+    // Formatted events waiting for Initialize(); m_initialized only flips under m_earlyMutex
+    struct PendingEvent {
+        std::uint32_t shardKey;
+        std::string message;
+        MessageSpan span;
+    };
+    std::mutex m_earlyMutex;
+    std::vector<PendingEvent> m_earlyBuffer;
+    std::atomic<std::size_t> m_earlyCapacity{0};
+
+    // Formatting workers (nullptr = events are formatted on the logging thread), replaced under
+    // m_formatterMutex and used by Write() inside an LogRcu read section
+    std::atomic<LogFormatterPool*> m_formatterPool{nullptr};
+    std::mutex m_formatterMutex;
+    LogThreadOptions m_threadOptions;
+    LogFlushPolicy m_flushPolicy;
+    LogPriorityLanes m_priorityLanes;
 
     bool Initialize();
     void Cleanup();
-    bool SendMessage(const std::string& message);
+    void Flush();
+
+    // Starts a pool with the current thread options, flush policy and priority lanes (workers == 0:
+    // none) and retires the old one
+    void ReplaceFormatterPoolLocked(std::size_t workers);
+    bool SendMessage(const std::string& message, std::uint32_t shardKey, const MessageSpan& span);
+    bool SendFragments(const LogFragment* fragments, std::size_t count, std::size_t size, std::uint32_t shardKey,
+                       const MessageSpan& span);
+
+    // Formats and delivers one event (file == nullptr: without location), or queues it for the
+    // formatting workers
+    void Write(LogLevel level, LogStringRef category, LogStringRef message,
+               const char* file, const char* function, int line,
+               const std::vector<LogProperty>& properties, LogFieldList fields);
+
+    // Formatting and delivery proper, on the logging thread or a formatting worker; emitterFile
+    // is the caller's file pointer for attribution
+    void Emit(const LogTimestamp& timestamp, const LogEventOrigin& origin, bool useXml, LogLevel level,
+              LogStringRef category, LogStringRef message, const char* file, const char* function, int line,
+              const std::vector<LogProperty>& properties, LogFieldList fields, const std::string& context,
+              const char* emitterFile);
+
+    // Formats a record on a formatting worker into the worker's batch; bytes added to it
+    std::size_t EmitRecord(LogRecord& record, SendBatch& batch);
+
+    // Sends a worker's batch: runs of events for the same destination go out together, as one
+    // system call for datagrams and one stream write for TCP
+    void SendBatched(SendBatch& batch);
+    void SendDatagramRun(Endpoint& endpoint, const SendBatch& batch, std::size_t first, std::size_t last);
+    bool SendStreamRun(Endpoint& endpoint, const SendBatch& batch, std::size_t first, std::size_t last);
+
+    // Resolves and connects (TCP) the endpoint; true if it is up afterwards
+    bool OpenEndpoint(Endpoint& endpoint, bool reconnect);
+    void CloseEndpoint(Endpoint& endpoint);
+    void MarkDown(Endpoint& endpoint);
+
+    bool Resolve(const LogDestination& target, Destination& destination) const;
+    void PublishDestination(Endpoint& endpoint, const Destination& resolved);
+    socket_t Connect(const Destination& destination) const;
+
+    // Datagram socket of the endpoint for the destination's family, created on first use
+    socket_t DatagramSocket(Endpoint& endpoint, const Destination& destination);
+    void StartResolverLocked();
+    void StopResolver();
+    void ResolverLoop();
+
+    // Endpoint for the event, skipping destinations that are down; nullptr if none is up
+    Endpoint* SelectEndpoint(std::uint32_t shardKey);
+    bool SendDatagram(Endpoint& endpoint, const LogFragment* fragments, std::size_t count);
+
+    // Sends an event larger than the datagram size limit to a datagram destination, truncated or
+    // split; false if it was dropped or a part could not be sent
+    bool SendOversized(Endpoint& endpoint, const LogFragment* fragments, std::size_t count, const MessageSpan& span,
+                       std::size_t limit);
+    bool SendStream(Endpoint& endpoint, const LogFragment* fragments, std::size_t count);
+
+    // Shard key of the category, only computed when it can still matter
+    std::uint32_t ShardKey(LogStringRef category) const {
+        return (m_sharded || !m_initialized.load(std::memory_order_relaxed)) ? HashCategory(category) : 0;
+    }
+
+    // Sends the event, adds it to the batch of the formatting worker, or buffers it while the
+    // transport is not up yet (taking over its content, the caller's buffer is left empty then)
+    void Dispatch(std::string& message, std::uint32_t shardKey, const MessageSpan& span = MessageSpan());
+
+    // Dispatches a formatted event; one that exceeds the datagram size limit carries where its
+    // message is, so datagram destinations can cut it (stream destinations take it whole)
+    void Deliver(std::string& formatted, LogStringRef category, LogStringRef message, bool xml);
+    void DeliverFragments(const LogEventFragments& event, LogStringRef category, LogStringRef message, bool xml);
 };
 
 Log2ConsoleUdpClient::Log2ConsoleUdpClient(const std::string& serverHost, int serverPort, bool useXmlFormat)
-    : m_pImpl(std::make_unique<Impl>(serverHost, serverPort, useXmlFormat))
+    : m_pImpl(std::make_unique<Impl>(std::vector<LogDestination>{LogDestination(serverHost, serverPort)},
+                                     LogDistribution::Failover, useXmlFormat))
+{
+}
+
+Log2ConsoleUdpClient::Log2ConsoleUdpClient(const std::vector<LogDestination>& destinations, LogDistribution distribution,
+                                           bool useXmlFormat)
+    : m_pImpl(std::make_unique<Impl>(destinations, distribution, useXmlFormat))
 {
 }
 
@@ -57,93 +428,1063 @@ bool Log2ConsoleUdpClient::IsInitialized() const {
     return m_pImpl->m_initialized;
 }
 
-void Log2ConsoleUdpClient::Log(LogLevel level, const std::string& category, const std::string& message) {
-    if (!m_pImpl->m_initialized) {
-        return;
+void Log2ConsoleUdpClient::SetEarlyBufferCapacity(std::size_t maxEvents) {
+    m_pImpl->m_earlyCapacity.store(maxEvents, std::memory_order_relaxed);
+}
+
+void Log2ConsoleUdpClient::TransferEarlyBuffer(Log2ConsoleUdpClient& target) {
+    std::vector<Impl::PendingEvent> pending;
+    {
+        std::lock_guard<std::mutex> lock(m_pImpl->m_earlyMutex);
+        pending.swap(m_pImpl->m_earlyBuffer);
     }
 
-    std::string formattedMessage = m_pImpl->m_useXmlFormat
-        ? Log2ConsoleFormatter::FormatLog4jXml(level, category, message)
-        : Log2ConsoleFormatter::FormatPlainText(level, category, message);
+    for (Impl::PendingEvent& event : pending) {
+        target.m_pImpl->Dispatch(event.message, event.shardKey, event.span);
+    }
+}
 
-    m_pImpl->SendMessage(formattedMessage);
+void Log2ConsoleUdpClient::Log(LogLevel level, LogStringRef category, LogStringRef message,
+                               const std::vector<LogProperty>& properties, LogFieldList fields) {
+    m_pImpl->Write(level, category, message, nullptr, nullptr, 0, properties, fields);
 }
 
-void Log2ConsoleUdpClient::Log(LogLevel level, const std::string& category, const std::string& message, 
-                               const char* file, const char* function, int line) {
-    if (!m_pImpl->m_initialized) {
-        return;
+void Log2ConsoleUdpClient::Log(LogLevel level, LogStringRef category, LogStringRef message,
+                               const char* file, const char* function, int line,
+                               const std::vector<LogProperty>& properties, LogFieldList fields) {
+    m_pImpl->Write(level, category, message, file, function, line, properties, fields);
+}
+
+void Log2ConsoleUdpClient::SetFormattingWorkers(std::size_t workers) {
+    std::lock_guard<std::mutex> lock(m_pImpl->m_formatterMutex);
+
+    LogFormatterPool* current = m_pImpl->m_formatterPool.load();
+    if ((current ? current->GetWorkerCount() : 0) != workers) {
+        m_pImpl->ReplaceFormatterPoolLocked(workers);
+    }
+}
+
+std::size_t Log2ConsoleUdpClient::GetFormattingWorkers() const {
+    std::lock_guard<std::mutex> lock(m_pImpl->m_formatterMutex);
+    LogFormatterPool* pool = m_pImpl->m_formatterPool.load();
+    return pool ? pool->GetWorkerCount() : 0;
+}
+
+std::uint64_t Log2ConsoleUdpClient::GetFormattingCpuTime() const {
+    std::lock_guard<std::mutex> lock(m_pImpl->m_formatterMutex);
+    LogFormatterPool* pool = m_pImpl->m_formatterPool.load();
+    return pool ? pool->GetCpuTime() : 0;
+}
+
+void Log2ConsoleUdpClient::SetThreadOptions(const LogThreadOptions& options) {
+    {
+        std::lock_guard<std::mutex> lock(m_pImpl->m_resolverMutex);
+        m_pImpl->m_resolverOptions = options;
+        m_pImpl->m_resolverGeneration++;
+        m_pImpl->m_resolverCondition.notify_all();
+    }
+
+    // Workers take their options when they start, so a running pool is replaced
+    std::lock_guard<std::mutex> lock(m_pImpl->m_formatterMutex);
+    m_pImpl->m_threadOptions = options;
+    LogFormatterPool* current = m_pImpl->m_formatterPool.load();
+    if (current && current->GetThreadOptions() != options) {
+        m_pImpl->ReplaceFormatterPoolLocked(current->GetWorkerCount());
+    }
+}
+
+void Log2ConsoleUdpClient::SetFlushPolicy(const LogFlushPolicy& policy) {
+    std::lock_guard<std::mutex> lock(m_pImpl->m_formatterMutex);
+    m_pImpl->m_flushPolicy = policy;
+    LogFormatterPool* current = m_pImpl->m_formatterPool.load();
+    if (current && current->GetFlushPolicy() != policy) {
+        m_pImpl->ReplaceFormatterPoolLocked(current->GetWorkerCount());
     }
+}
 
-    std::string formattedMessage = m_pImpl->m_useXmlFormat
-        ? Log2ConsoleFormatter::FormatLog4jXml(level, category, message, file, function, line)
-        : Log2ConsoleFormatter::FormatPlainText(level, category, message);
+void Log2ConsoleUdpClient::SetPriorityLanes(const LogPriorityLanes& lanes) {
+    std::lock_guard<std::mutex> lock(m_pImpl->m_formatterMutex);
+    m_pImpl->m_priorityLanes = lanes;
+    LogFormatterPool* current = m_pImpl->m_formatterPool.load();
+    if (current && current->GetPriorityLanes() != lanes) {
+        m_pImpl->ReplaceFormatterPoolLocked(current->GetWorkerCount());
+    }
+}
 
-    m_pImpl->SendMessage(formattedMessage);
+void Log2ConsoleUdpClient::Flush() {
+    m_pImpl->Flush();
 }
 
 void Log2ConsoleUdpClient::SetXmlFormat(bool useXml) {
     m_pImpl->m_useXmlFormat = useXml;
 }
 
+bool Log2ConsoleUdpClient::IsXmlFormat() const {
+    return m_pImpl->m_useXmlFormat;
+}
+
+void Log2ConsoleUdpClient::SetResolveInterval(unsigned int intervalMs) {
+    std::lock_guard<std::mutex> lock(m_pImpl->m_resolverMutex);
+
+    m_pImpl->m_resolveInterval = std::chrono::milliseconds(intervalMs);
+    m_pImpl->m_resolverGeneration++;
+    m_pImpl->m_resolverCondition.notify_all();
+
+    if (intervalMs > 0 && m_pImpl->m_initialized) {
+        m_pImpl->StartResolverLocked();
+    }
+}
+
+void Log2ConsoleUdpClient::SetMaxDatagramSize(std::size_t bytes, LogOversizePolicy policy) {
+    m_pImpl->m_oversizePolicy.store(policy, std::memory_order_relaxed);
+    m_pImpl->m_maxDatagramSize.store(bytes, std::memory_order_relaxed);
+}
+
+std::vector<DestinationStats> Log2ConsoleUdpClient::GetDestinationStats() const {
+    std::vector<DestinationStats> result;
+    for (const auto& endpoint : m_pImpl->m_endpoints) {
+        DestinationStats stats;
+        const std::string& host = endpoint->target.host;
+        stats.name = (endpoint->IsTcp() ? "tcp://" : "udp://") +
+                     (host.find(':') != std::string::npos ? "[" + host + "]" : host) + ":" +
+                     std::to_string(endpoint->target.port);
+        stats.up = endpoint->up.load(std::memory_order_relaxed);
+        stats.events = endpoint->events.load(std::memory_order_relaxed);
+        stats.bytes = endpoint->bytes.load(std::memory_order_relaxed);
+        stats.sendErrors = endpoint->sendErrors.load(std::memory_order_relaxed);
+        stats.redirects = endpoint->redirects.load(std::memory_order_relaxed);
+        stats.reconnects = endpoint->reconnects.load(std::memory_order_relaxed);
+        result.push_back(stats);
+    }
+    return result;
+}
+
+std::size_t Log2ConsoleUdpClient::GetDestinationCount() const {
+    return m_pImpl->m_endpoints.size();
+}
+
 // Implementation methods
 bool Log2ConsoleUdpClient::Impl::Initialize() {
+    std::lock_guard<std::mutex> initLock(m_initMutex);
+
     if (m_initialized) {
         return true;
     }
 
-    // Create UDP socket
-    m_socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
-    if (m_socket == INVALID_SOCKET_VALUE) {
+    // Bring up what is reachable now; the rest is retried by the background thread
+    bool anyUp = false;
+    for (auto& endpoint : m_endpoints) {
+        if (OpenEndpoint(*endpoint, false)) {
+            anyUp = true;
+        }
+    }
+    if (!anyUp) {
+        for (auto& endpoint : m_endpoints) {
+            CloseEndpoint(*endpoint);
+        }
+        return false;
+    }
+
+    // Go live and take what was buffered in one step, so no event is left behind
+    std::vector<PendingEvent> pending;
+    {
+        std::lock_guard<std::mutex> lock(m_earlyMutex);
+        m_initialized.store(true, std::memory_order_release);
+        pending.swap(m_earlyBuffer);
+    }
+
+    for (const PendingEvent& event : pending) {
+        SendMessage(event.message, event.shardKey, event.span);
+    }
+
+    {
+        // TCP connections can drop at any time, so they always get the background thread
+        std::lock_guard<std::mutex> lock(m_resolverMutex);
+        bool needsThread = m_resolveInterval.count() > 0;
+        for (const auto& endpoint : m_endpoints) {
+            needsThread = needsThread || endpoint->IsTcp() || !endpoint->up;
+        }
+        if (needsThread) {
+            StartResolverLocked();
+        }
+    }
+    return true;
+}
+
+void Log2ConsoleUdpClient::Impl::ReplaceFormatterPoolLocked(std::size_t workers) {
+    LogFormatterPool* current = m_formatterPool.load();
+    LogFormatterPool* pool = nullptr;
+    if (workers > 0) {
+        auto batches = std::make_shared<std::vector<SendBatch>>(workers);
+        pool = new LogFormatterPool(
+            workers, m_threadOptions, m_flushPolicy, m_priorityLanes,
+            [this, batches](std::size_t worker, LogRecord& record) { return EmitRecord(record, (*batches)[worker]); },
+            [this, batches](std::size_t worker) { SendBatched((*batches)[worker]); });
+    }
+    m_formatterPool.store(pool, std::memory_order_release);
+
+    // The old pool takes no new records once no Write() can still see it; what it holds is
+    // formatted before it goes away
+    if (current) {
+        LogRcu::Synchronize();
+        delete current;
+    }
+}
+
+void Log2ConsoleUdpClient::Impl::Flush() {
+    std::lock_guard<std::mutex> lock(m_formatterMutex);
+    LogFormatterPool* pool = m_formatterPool.load();
+    if (pool) {
+        pool->Flush();
+    }
+}
+
+void Log2ConsoleUdpClient::Impl::Cleanup() {
+    // Events queued for formatting still go out before the transport closes
+    Flush();
+    StopResolver();
+
+    m_initialized = false;
+
+    for (auto& endpoint : m_endpoints) {
+        CloseEndpoint(*endpoint);
+    }
+}
+
+bool Log2ConsoleUdpClient::Impl::OpenEndpoint(Endpoint& endpoint, bool reconnect) {
+    Destination resolved;
+    if (!Resolve(endpoint.target, resolved)) {
+        return false;
+    }
+
+    if (!endpoint.IsTcp()) {
+        resolved.socket = DatagramSocket(endpoint, resolved);
+        if (resolved.socket == INVALID_SOCKET_VALUE) {
+            return false;
+        }
+        PublishDestination(endpoint, resolved);
+        endpoint.up.store(true, std::memory_order_release);
+        return true;
+    }
+    PublishDestination(endpoint, resolved);
+
+    // Connect without the send lock; senders keep using the current connection meanwhile
+    socket_t connection = Connect(resolved);
+    if (connection == INVALID_SOCKET_VALUE) {
         return false;
     }
 
-    // Resolve server address
+    {
+        std::lock_guard<std::mutex> lock(endpoint.sendMutex);
+        if (endpoint.socket != INVALID_SOCKET_VALUE) {
+            closesocket_platform(endpoint.socket);
+        }
+        endpoint.socket = connection;
+        endpoint.up.store(true, std::memory_order_release);
+    }
+
+    if (reconnect) {
+        endpoint.reconnects.fetch_add(1, std::memory_order_relaxed);
+    }
+    return true;
+}
+
+void Log2ConsoleUdpClient::Impl::CloseEndpoint(Endpoint& endpoint) {
+    // Datagram senders find no destination from here on; wait for those still using the old one
+    // before its socket is closed and the address freed
+    const Destination* previous = endpoint.destination.exchange(nullptr);
+    if (previous) {
+        LogRcu::Synchronize();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(endpoint.sendMutex);
+        endpoint.up = false;
+        if (endpoint.socket != INVALID_SOCKET_VALUE) {
+            closesocket_platform(endpoint.socket);
+            endpoint.socket = INVALID_SOCKET_VALUE;
+        }
+        for (socket_t& datagramSocket : endpoint.datagramSockets) {
+            if (datagramSocket != INVALID_SOCKET_VALUE) {
+                closesocket_platform(datagramSocket);
+                datagramSocket = INVALID_SOCKET_VALUE;
+            }
+        }
+    }
+
+    delete previous;
+}
+
+void Log2ConsoleUdpClient::Impl::MarkDown(Endpoint& endpoint) {
+    // endpoint.sendMutex is held by the caller
+    endpoint.up = false;
+    closesocket_platform(endpoint.socket);
+    endpoint.socket = INVALID_SOCKET_VALUE;
+
+    // Wake the background thread so it starts reconnecting
+    {
+        std::lock_guard<std::mutex> lock(m_resolverMutex);
+        m_resolverGeneration++;
+    }
+    m_resolverCondition.notify_all();
+}
+
+bool Log2ConsoleUdpClient::Impl::Resolve(const LogDestination& target, Destination& destination) const {
     struct addrinfo hints{};
     struct addrinfo* result = nullptr;
     
-    hints.ai_family = AF_INET;
-    hints.ai_socktype = SOCK_DGRAM;
-    hints.ai_protocol = IPPROTO_UDP;
+    hints.ai_family = AF_UNSPEC;
+    if (target.transport == LogTransport::Tcp) {
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_protocol = IPPROTO_TCP;
+    } else {
+        hints.ai_socktype = SOCK_DGRAM;
+        hints.ai_protocol = IPPROTO_UDP;
+    }
     
-    std::string portStr = std::to_string(m_serverPort);
-    int res = getaddrinfo(m_serverHost.c_str(), portStr.c_str(), &hints, &result);
+    std::string portStr = std::to_string(target.port);
+    int res = getaddrinfo(target.host.c_str(), portStr.c_str(), &hints, &result);
     if (res != 0) {
-        closesocket_platform(m_socket);
-        m_socket = INVALID_SOCKET_VALUE;
+        return false;
+    }
+
+    // Prefer IPv4 when the name has both, otherwise take the first usable address
+    const struct addrinfo* chosen = nullptr;
+    for (const struct addrinfo* entry = result; entry; entry = entry->ai_next) {
+        if (entry->ai_family != AF_INET && entry->ai_family != AF_INET6) {
+            continue;
+        }
+        if (!chosen || (entry->ai_family == AF_INET && chosen->ai_family != AF_INET)) {
+            chosen = entry;
+        }
+    }
+    if (!chosen) {
+        freeaddrinfo(result);
         return false;
     }
 
     // Copy the server address
-    memcpy(&m_serverAddr, result->ai_addr, sizeof(m_serverAddr));
+    memset(&destination, 0, sizeof(destination));
+    memcpy(&destination.address, chosen->ai_addr, chosen->ai_addrlen);
+    destination.length = static_cast<socklen_t>(chosen->ai_addrlen);
+    destination.socket = INVALID_SOCKET_VALUE;
     freeaddrinfo(result);
-
-    m_initialized = true;
     return true;
 }
 
-void Log2ConsoleUdpClient::Impl::Cleanup() {
-    m_initialized = false;
-    
-    if (m_socket != INVALID_SOCKET_VALUE) {
-        closesocket_platform(m_socket);
-        m_socket = INVALID_SOCKET_VALUE;
+void Log2ConsoleUdpClient::Impl::PublishDestination(Endpoint& endpoint, const Destination& resolved) {
+    Destination* destination = new Destination(resolved);
+
+    const Destination* previous = endpoint.destination.exchange(destination);
+    if (previous) {
+        // Free the old address once no sender can still be using it
+        LogRcu::Synchronize();
+        delete previous;
+    }
+}
+
+socket_t Log2ConsoleUdpClient::Impl::Connect(const Destination& destination) const {
+    socket_t connection = socket(destination.address.ss_family, SOCK_STREAM, IPPROTO_TCP);
+    if (connection == INVALID_SOCKET_VALUE) {
+        return INVALID_SOCKET_VALUE;
+    }
+
+    // The send timeout also bounds connect() on Linux
+#ifdef LTC_PLATFORM_WINDOWS
+    DWORD timeout = kTcpTimeoutMs;
+    setsockopt(connection, SOL_SOCKET, SO_SNDTIMEO, (const char*)&timeout, sizeof(timeout));
+#else
+    struct timeval timeout{kTcpTimeoutMs / 1000, (kTcpTimeoutMs % 1000) * 1000};
+    setsockopt(connection, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+#endif
+
+    if (connect(connection, (const struct sockaddr*)&destination.address, destination.length) == SOCKET_ERROR_VALUE) {
+        closesocket_platform(connection);
+        return INVALID_SOCKET_VALUE;
+    }
+    return connection;
+}
+
+socket_t Log2ConsoleUdpClient::Impl::DatagramSocket(Endpoint& endpoint, const Destination& destination) {
+    // Datagram sockets stay open for the life of the client; a re-resolution that switches the
+    // address family moves to the endpoint's other socket
+    int family = destination.address.ss_family;
+    socket_t& datagramSocket = endpoint.datagramSockets[family == AF_INET6 ? 1 : 0];
+    if (datagramSocket == INVALID_SOCKET_VALUE) {
+        datagramSocket = socket(family, SOCK_DGRAM, IPPROTO_UDP);
+        if (datagramSocket == INVALID_SOCKET_VALUE) {
+            return INVALID_SOCKET_VALUE;
+        }
+    }
+
+    // A group address gets the hop limit, loopback and interface; a bad interface fails the endpoint
+    if (IsMulticast(destination.address) && !ApplyMulticastOptions(datagramSocket, family, endpoint.target)) {
+        return INVALID_SOCKET_VALUE;
+    }
+    return datagramSocket;
+}
+
+void Log2ConsoleUdpClient::Impl::StartResolverLocked() {
+    if (m_resolverThread.joinable()) {
+        return;
+    }
+
+    m_resolverStop = false;
+    m_resolverThread = std::thread(&Impl::ResolverLoop, this);
+}
+
+void Log2ConsoleUdpClient::Impl::StopResolver() {
+    {
+        std::lock_guard<std::mutex> lock(m_resolverMutex);
+        m_resolverStop = true;
+    }
+    m_resolverCondition.notify_all();
+
+    if (m_resolverThread.joinable()) {
+        m_resolverThread.join();
+    }
+}
+
+void Log2ConsoleUdpClient::Impl::ResolverLoop() {
+    std::unique_lock<std::mutex> lock(m_resolverMutex);
+
+    std::chrono::milliseconds scheduledInterval = m_resolveInterval;
+    auto nextResolve = std::chrono::steady_clock::now() + scheduledInterval;
+    LogThreadOptions appliedOptions;
+
+    while (!m_resolverStop) {
+        if (m_resolverOptions != appliedOptions) {
+            m_resolverOptions.ApplyToCurrentThread();
+            appliedOptions = m_resolverOptions;
+        }
+
+        // Restart the wait whenever the interval changes or a destination goes down
+        unsigned long generation = m_resolverGeneration;
+        auto changed = [this, generation]() { return m_resolverStop || m_resolverGeneration != generation; };
+
+        auto now = std::chrono::steady_clock::now();
+        if (m_resolveInterval != scheduledInterval) {
+            scheduledInterval = m_resolveInterval;
+            nextResolve = now + scheduledInterval;
+        }
+
+        bool anyDown = std::any_of(m_endpoints.begin(), m_endpoints.end(),
+                                   [](const std::unique_ptr<Endpoint>& endpoint) { return !endpoint->up; });
+
+        if (scheduledInterval.count() == 0 && !anyDown) {
+            m_resolverCondition.wait(lock, changed);
+            continue;
+        }
+
+        auto wakeup = scheduledInterval.count() > 0 ? nextResolve : now + kReconnectInterval;
+        if (anyDown) {
+            wakeup = std::min(wakeup, now + kReconnectInterval);
+        }
+        if (m_resolverCondition.wait_until(lock, wakeup, changed)) {
+            continue;
+        }
+
+        now = std::chrono::steady_clock::now();
+        bool resolveDue = scheduledInterval.count() > 0 && now >= nextResolve;
+        if (resolveDue) {
+            nextResolve = now + scheduledInterval;
+        }
+
+        // Resolve and connect without the lock so changing the interval never waits for it
+        lock.unlock();
+
+        for (auto& endpoint : m_endpoints) {
+            if (!endpoint->up) {
+                OpenEndpoint(*endpoint, true);
+                continue;
+            }
+            if (!resolveDue) {
+                continue;
+            }
+
+            Destination resolved;
+            if (!Resolve(endpoint->target, resolved)) {
+                LogStats::Increment(StatCounter::ResolveFailures);
+                continue;
+            }
+
+            const Destination* current = endpoint->destination.load();
+            if (!current || current->length != resolved.length ||
+                memcmp(&current->address, &resolved.address, resolved.length) != 0) {
+                LogStats::Increment(StatCounter::AddressChanges);
+                if (endpoint->IsTcp()) {
+                    // An open stream stays with the old address; move it over (the old
+                    // connection is kept if the new address does not accept yet)
+                    OpenEndpoint(*endpoint, true);
+                } else {
+                    resolved.socket = DatagramSocket(*endpoint, resolved);
+                    if (resolved.socket == INVALID_SOCKET_VALUE) {
+                        LogStats::Increment(StatCounter::ResolveFailures);
+                        continue;
+                    }
+                    PublishDestination(*endpoint, resolved);
+                }
+            }
+        }
+
+        lock.lock();
+    }
+}
+
+Log2ConsoleUdpClient::Impl::Endpoint* Log2ConsoleUdpClient::Impl::SelectEndpoint(std::uint32_t shardKey) {
+    std::size_t count = m_endpoints.size();
+    if (count == 0) {
+        return nullptr;
+    }
+
+    std::size_t first = 0;
+    if (count > 1) {
+        switch (m_distribution) {
+        case LogDistribution::ShardByCategory:
+            first = shardKey % count;
+            break;
+        case LogDistribution::RoundRobin: {
+            // Per-thread rotation, no shared counter on the send path
+            static thread_local std::size_t t_nextEndpoint = 0;
+            first = t_nextEndpoint++ % count;
+            break;
+        }
+        case LogDistribution::Failover:
+            break;
+        }
+    }
+
+    // Skip destinations that are down; with sharding their categories all move to the same next one
+    for (std::size_t i = 0; i < count; i++) {
+        Endpoint& endpoint = *m_endpoints[(first + i) % count];
+        if (endpoint.up.load(std::memory_order_acquire)) {
+            if (i > 0) {
+                m_endpoints[first]->redirects.fetch_add(1, std::memory_order_relaxed);
+            }
+            return &endpoint;
+        }
+    }
+    return nullptr;
+}
+
+void Log2ConsoleUdpClient::Impl::Dispatch(std::string& message, std::uint32_t shardKey, const MessageSpan& span) {
+    if (!m_initialized.load(std::memory_order_acquire)) {
+        std::lock_guard<std::mutex> lock(m_earlyMutex);
+        if (!m_initialized.load(std::memory_order_relaxed)) {
+            if (m_earlyBuffer.size() < m_earlyCapacity.load(std::memory_order_relaxed)) {
+                m_earlyBuffer.push_back(PendingEvent{shardKey, std::move(message), span});
+            } else {
+                LogStats::Increment(StatCounter::Drops);
+            }
+            return;
+        }
+    }
+
+    if (t_sendBatch) {
+        t_sendBatch->entries.push_back(SendBatch::Entry{t_sendBatch->data.size(), message.size(), shardKey, span});
+        t_sendBatch->data += message;
+        return;
     }
+    SendMessage(message, shardKey, span);
 }
 
-bool Log2ConsoleUdpClient::Impl::SendMessage(const std::string& message) {
-    if (!m_initialized || m_socket == INVALID_SOCKET_VALUE) {
+void Log2ConsoleUdpClient::Impl::Write(LogLevel level, LogStringRef category, LogStringRef message,
+                                        const char* file, const char* function, int line,
+                                        const std::vector<LogProperty>& properties, LogFieldList fields) {
+    if (!m_initialized && m_earlyCapacity.load(std::memory_order_relaxed) == 0) {
+        LogStats::Increment(StatCounter::Drops);
+        return;
+    }
+
+    LogTimestamp timestamp = Log2ConsoleClock::Now();
+    bool useXml = m_useXmlFormat;
+    LogEventOrigin origin;
+    if (useXml) {
+        origin = Log2ConsoleFormatter::CaptureOrigin();
+    }
+
+    // A severe event is waited for after leaving the read section; its ticket keeps the pool alive
+    LogFormatterPool* flushPool = nullptr;
+    LogFormatterPool::Ticket ticket;
+    {
+        LogRcu::ReadGuard guard;
+        LogFormatterPool* pool = m_formatterPool.load(std::memory_order_acquire);
+        if (pool) {
+            bool severe = level >= pool->GetFlushPolicy().flushLevel;
+
+            // Only copied here; thread and sequence number were taken above, so the event renders
+            // as if it had been formatted on this thread
+            bool queued = pool->Submit(level, [&](LogRecord& record) {
+                record.timestamp = timestamp;
+                record.origin = origin;
+                record.level = level;
+                record.xml = useXml;
+                record.hasLocation = file != nullptr;
+                record.line = line;
+                record.sourceFile = file;
+                record.category.assign(category.Data(), category.Size());
+                record.message.assign(message.Data(), message.Size());
+                record.file.assign(file ? file : "");
+                record.function.assign(function ? function : "");
+                record.properties = properties;
+                record.context.clear();
+                if (useXml) {
+                    Log2ConsoleFormatter::AppendFieldsXml(record.context, fields);
+                    record.context += LogContext::XmlFragment();
+                } else {
+                    Log2ConsoleFormatter::AppendFieldsPlainText(record.context, std::vector<LogProperty>(), fields);
+                    record.context += LogContext::PlainFragment();
+                }
+            }, severe ? &ticket : nullptr);
+
+            if (!queued || !severe) {
+                return;
+            }
+            flushPool = pool;
+        }
+    }
+
+    // The caller waits until the event and what its thread queued before it were sent
+    if (flushPool) {
+        LogStats::Increment(StatCounter::SeverityFlushes);
+        flushPool->FlushThrough(ticket);
+        return;
+    }
+
+    Emit(timestamp, origin, useXml, level, category, message, file, function, line, properties, fields,
+         useXml ? LogContext::XmlFragment() : LogContext::PlainFragment(), file);
+}
+
+std::size_t Log2ConsoleUdpClient::Impl::EmitRecord(LogRecord& record, SendBatch& batch) {
+    std::size_t before = batch.data.size();
+    t_sendBatch = &batch;
+    Emit(record.timestamp, record.origin, record.xml, record.level, record.category, record.message,
+         record.hasLocation ? record.file.c_str() : nullptr, record.function.c_str(), record.line,
+         record.properties, LogFieldList(), record.context, record.sourceFile);
+    t_sendBatch = nullptr;
+    return batch.data.size() - before;
+}
+
+void Log2ConsoleUdpClient::Impl::SendBatched(SendBatch& batch) {
+    std::size_t count = batch.entries.size();
+    if (count > 0) {
+        LogStats::Increment(StatCounter::Batches);
+    }
+
+    std::size_t first = 0;
+    while (first < count && m_initialized) {
+        Endpoint* endpoint = SelectEndpoint(batch.entries[first].shardKey);
+        if (!endpoint) {
+            break;
+        }
+
+        // With sharding a run ends where the category maps to another destination
+        std::size_t last = first + 1;
+        while (last < count && (!m_sharded || batch.entries[last].shardKey % m_endpoints.size() ==
+                                              batch.entries[first].shardKey % m_endpoints.size())) {
+            last++;
+        }
+
+        if (endpoint->IsTcp()) {
+            if (!SendStreamRun(*endpoint, batch, first, last)) {
+                // The standby gets the run event by event, as unbatched sends would
+                endpoint->sendErrors.fetch_add(1, std::memory_order_relaxed);
+                LogStats::Increment(StatCounter::SendErrors);
+                for (std::size_t i = first; i < last; i++) {
+                    const SendBatch::Entry& entry = batch.entries[i];
+                    LogFragment fragment{batch.data.data() + entry.offset, entry.length};
+                    SendFragments(&fragment, 1, entry.length, entry.shardKey, entry.span);
+                }
+            }
+        } else {
+            SendDatagramRun(*endpoint, batch, first, last);
+        }
+        first = last;
+    }
+
+    // Not initialized (any more), or no destination is up
+    if (first < count) {
+        LogStats::Increment(StatCounter::Drops, count - first);
+    }
+
+    batch.entries.clear();
+    batch.data.clear();
+    if (batch.data.capacity() > kMaxRetainedBatch) {
+        std::string().swap(batch.data);
+    }
+}
+
+void Log2ConsoleUdpClient::Impl::SendDatagramRun(Endpoint& endpoint, const SendBatch& batch, std::size_t first,
+                                                 std::size_t last) {
+    LogRcu::ReadGuard guard;
+    const Destination* destination = endpoint.destination.load();
+    if (!destination) {
+        // The endpoint is being closed
+        LogStats::Increment(StatCounter::Drops, last - first);
+        return;
+    }
+
+    std::size_t limit = m_maxDatagramSize.load(std::memory_order_relaxed);
+    LogFragment datagrams[kMaxBatchDatagrams];
+    std::size_t index = first;
+    while (index < last) {
+        const SendBatch::Entry& next = batch.entries[index];
+        if (next.length > limit) {
+            LogFragment event{batch.data.data() + next.offset, next.length};
+            SendOversized(endpoint, &event, 1, next.span, limit);
+            index++;
+            continue;
+        }
+
+        std::size_t count = 0;
+        while (count < kMaxBatchDatagrams && index + count < last && batch.entries[index + count].length <= limit) {
+            const SendBatch::Entry& entry = batch.entries[index + count];
+            datagrams[count++] = LogFragment{batch.data.data() + entry.offset, entry.length};
+        }
+
+        int result;
+        {
+            LogStats::ScopedTimer timer(StatHistogram::SendTime);
+            result = SendDatagrams(destination->socket, datagrams, count,
+                                   (const struct sockaddr*)&destination->address, destination->length);
+        }
+
+        // The datagram that failed is lost, as an unbatched one would be; the rest is tried again
+        if (result <= 0) {
+            endpoint.sendErrors.fetch_add(1, std::memory_order_relaxed);
+            LogStats::Increment(StatCounter::SendErrors);
+            index++;
+            continue;
+        }
+
+        std::size_t sent = static_cast<std::size_t>(result);
+        std::size_t bytes = 0;
+        for (std::size_t i = 0; i < sent; i++) {
+            bytes += datagrams[i].length;
+        }
+        endpoint.events.fetch_add(sent, std::memory_order_relaxed);
+        endpoint.bytes.fetch_add(bytes, std::memory_order_relaxed);
+        LogStats::Increment(StatCounter::Events, sent);
+        LogStats::Increment(StatCounter::Bytes, bytes);
+        index += sent;
+    }
+}
+
+bool Log2ConsoleUdpClient::Impl::SendStreamRun(Endpoint& endpoint, const SendBatch& batch, std::size_t first,
+                                               std::size_t last) {
+    // Entries are back to back in the buffer, so the run is one contiguous write
+    std::size_t begin = batch.entries[first].offset;
+    std::size_t size = batch.entries[last - 1].offset + batch.entries[last - 1].length - begin;
+    LogFragment fragment{batch.data.data() + begin, size};
+
+    bool sent;
+    {
+        LogStats::ScopedTimer timer(StatHistogram::SendTime);
+        sent = SendStream(endpoint, &fragment, 1);
+    }
+    if (sent) {
+        endpoint.events.fetch_add(last - first, std::memory_order_relaxed);
+        endpoint.bytes.fetch_add(size, std::memory_order_relaxed);
+        LogStats::Increment(StatCounter::Events, last - first);
+        LogStats::Increment(StatCounter::Bytes, size);
+    }
+    return sent;
+}
+
+void Log2ConsoleUdpClient::Impl::Emit(const LogTimestamp& timestamp, const LogEventOrigin& origin, bool useXml,
+                                      LogLevel level, LogStringRef category, LogStringRef message,
+                                      const char* file, const char* function, int line,
+                                      const std::vector<LogProperty>& properties, LogFieldList fields,
+                                      const std::string& context, const char* emitterFile) {
+    if (message.Size() >= kScatterGatherThreshold) {
+        LogEventFragments event;
+        {
+            LogStats::ScopedTimer timer(StatHistogram::FormatTime);
+            if (useXml) {
+                Log2ConsoleFormatter::FormatLog4jXmlFragments(timestamp, origin, level, category, message, file, function,
+                                                              line, properties, fields, context, event);
+            } else {
+                Log2ConsoleFormatter::FormatPlainTextFragments(timestamp, level, category, message, properties, fields,
+                                                               context, event);
+            }
+        }
+
+        LogStats::RecordEmitter(emitterFile, line, category, event.Size());
+        DeliverFragments(event, category, message, useXml);
+        return;
+    }
+
+    // Formatted into a pooled buffer that stays with the event until it was sent
+    LogBuffer formatted;
+    {
+        LogStats::ScopedTimer timer(StatHistogram::FormatTime);
+        if (useXml) {
+            Log2ConsoleFormatter::AppendLog4jXml(*formatted, timestamp, origin, level, category, message, file, function,
+                                                 line, properties, fields, context);
+        } else {
+            Log2ConsoleFormatter::AppendPlainText(*formatted, timestamp, level, category, message, properties, fields,
+                                                  context);
+        }
+    }
+
+    LogStats::RecordEmitter(emitterFile, line, category, formatted->size());
+    Deliver(*formatted, category, message, useXml);
+}
+
+void Log2ConsoleUdpClient::Impl::DeliverFragments(const LogEventFragments& event, LogStringRef category,
+                                                  LogStringRef message, bool xml) {
+    // Buffering, batching and cutting need the event as one string
+    if (!m_initialized.load(std::memory_order_acquire) || t_sendBatch ||
+        (m_hasDatagramEndpoint && event.Size() > m_maxDatagramSize.load(std::memory_order_relaxed))) {
+        LogBuffer joined;
+        event.JoinTo(*joined);
+        Deliver(*joined, category, message, xml);
+        return;
+    }
+
+    SendFragments(event.Data(), event.Count(), event.Size(), ShardKey(category), MessageSpan());
+}
+
+void Log2ConsoleUdpClient::Impl::Deliver(std::string& formatted, LogStringRef category, LogStringRef message,
+                                         bool xml) {
+    MessageSpan span;
+    if (m_hasDatagramEndpoint && formatted.size() > m_maxDatagramSize.load(std::memory_order_relaxed)) {
+        // Located in the format the event was rendered in; an event where the message cannot be
+        // found keeps offset npos and is dropped by datagram destinations
+        std::size_t offset = Log2ConsoleFormatter::FindMessage(formatted, category, xml);
+        if (offset != std::string::npos && offset + message.Size() <= formatted.size() &&
+            formatted.compare(offset, message.Size(), message.Data(), message.Size()) == 0) {
+            span.offset = offset;
+            span.size = message.Size();
+            span.xml = xml;
+        }
+    }
+
+    Dispatch(formatted, ShardKey(category), span);
+}
+
+bool Log2ConsoleUdpClient::Impl::SendOversized(Endpoint& endpoint, const LogFragment* fragments, std::size_t count,
+                                               const MessageSpan& span, std::size_t limit) {
+    // Oversized events reach the send as one fragment (see DeliverFragments)
+    if (count != 1 || span.offset == std::string::npos || span.offset + span.size > fragments[0].length) {
+        LogStats::Increment(StatCounter::Drops);
         return false;
     }
 
-    std::lock_guard<std::mutex> lock(m_sendMutex);
-    
-    int result = sendto(m_socket, 
-                       message.c_str(), 
-                       static_cast<int>(message.length()), 
-                       0, 
-                       (struct sockaddr*)&m_serverAddr, 
-                       sizeof(m_serverAddr));
-    
-    return result != SOCKET_ERROR_VALUE;
-}
\ No newline at end of file
+    // The message is the only part that is cut; everything around it is kept byte for byte, so
+    // the event is not formatted again
+    const char* prefix = fragments[0].data;
+    LogStringRef message(prefix + span.offset, span.size);
+    const char* suffix = prefix + span.offset + span.size;
+    std::size_t suffixSize = fragments[0].length - span.offset - span.size;
+    std::size_t overhead = fragments[0].length - span.size;
+
+    bool complete = true;
+    auto send = [&](const std::string& datagram) {
+        LogFragment fragment{datagram.data(), datagram.size()};
+        bool sent;
+        {
+            LogStats::ScopedTimer timer(StatHistogram::SendTime);
+            sent = SendDatagram(endpoint, &fragment, 1);
+        }
+        if (sent) {
+            endpoint.events.fetch_add(1, std::memory_order_relaxed);
+            endpoint.bytes.fetch_add(datagram.size(), std::memory_order_relaxed);
+            LogStats::Increment(StatCounter::Events);
+            LogStats::Increment(StatCounter::Bytes, datagram.size());
+        }
+        complete = complete && sent;
+    };
+
+    if (m_oversizePolicy.load(std::memory_order_relaxed) == LogOversizePolicy::Truncate) {
+        // Room for the longest marker; the one written counts the bytes actually removed and is
+        // never longer
+        char marker[64];
+        std::size_t markerSize = static_cast<std::size_t>(
+            std::snprintf(marker, sizeof(marker), "... [truncated %zu bytes]", message.Size()));
+        if (overhead + markerSize > limit) {
+            LogStats::Increment(StatCounter::Drops);
+            return false;
+        }
+
+        std::size_t keep = Utf8Boundary(message, limit - overhead - markerSize);
+        markerSize = static_cast<std::size_t>(
+            std::snprintf(marker, sizeof(marker), "... [truncated %zu bytes]", message.Size() - keep));
+
+        LogBuffer datagram;
+        datagram->reserve(overhead + keep + markerSize);
+        datagram->append(prefix, span.offset + keep);
+        datagram->append(marker, markerSize);
+        datagram->append(suffix, suffixSize);
+        LogStats::Increment(StatCounter::TruncatedEvents);
+        send(*datagram);
+        return complete;
+    }
+
+    // XML chunks after the first get sequence numbers of their own, so receivers do not take them
+    // for duplicates; the number is replaced in place within the suffix
+    std::size_t numberStart = std::string::npos;
+    std::size_t numberEnd = std::string::npos;
+    if (span.xml) {
+        static const char kSequenceStart[] = "<nlog:eventSequenceNumber>";
+        std::string tail(suffix, suffixSize);
+        numberStart = tail.rfind(kSequenceStart);
+        if (numberStart != std::string::npos) {
+            numberStart += sizeof(kSequenceStart) - 1;
+            numberEnd = tail.find('<', numberStart);
+        }
+    }
+    std::size_t sequenceSlack = numberEnd == std::string::npos ? 0 : 20 - (numberEnd - numberStart);
+
+    // Each chunk carries a "[i/n] " label; size it for the largest possible chunk count
+    std::size_t labelSize = 4 + 2 * DecimalDigits(message.Size());
+    if (overhead + sequenceSlack + labelSize + 4 > limit) {
+        LogStats::Increment(StatCounter::Drops);
+        return false;
+    }
+    std::size_t capacity = limit - overhead - sequenceSlack - labelSize;
+
+    std::vector<std::size_t> cuts;
+    for (std::size_t position = 0; position < message.Size();) {
+        std::size_t end = std::min(message.Size(), position + capacity);
+        std::size_t boundary = Utf8Boundary(message, end);
+        position = boundary > position ? boundary : end;
+        cuts.push_back(position);
+    }
+
+    std::size_t start = 0;
+    for (std::size_t i = 0; i < cuts.size(); i++) {
+        char label[48];
+        std::size_t labelLength = static_cast<std::size_t>(
+            std::snprintf(label, sizeof(label), "[%zu/%zu] ", i + 1, cuts.size()));
+
+        LogBuffer chunk;
+        chunk->reserve(span.offset + labelLength + (cuts[i] - start) + suffixSize + sequenceSlack);
+        chunk->append(prefix, span.offset);
+        chunk->append(label, labelLength);
+        chunk->append(message.Data() + start, cuts[i] - start);
+        if (i == 0 || numberEnd == std::string::npos) {
+            chunk->append(suffix, suffixSize);
+        } else {
+            chunk->append(suffix, numberStart);
+            Log2ConsoleFormatter::AppendDecimal(
+                *chunk, static_cast<unsigned long long>(Log2ConsoleFormatter::CaptureOrigin().sequenceNumber));
+            chunk->append(suffix + numberEnd, suffixSize - numberEnd);
+        }
+        send(*chunk);
+        start = cuts[i];
+    }
+
+    LogStats::Increment(StatCounter::SplitEvents);
+    LogStats::Increment(StatCounter::EventChunks, cuts.size());
+    return complete;
+}
+
+bool Log2ConsoleUdpClient::Impl::SendMessage(const std::string& message, std::uint32_t shardKey,
+                                             const MessageSpan& span) {
+    LogFragment fragment{message.data(), message.size()};
+    return SendFragments(&fragment, 1, message.size(), shardKey, span);
+}
+
+bool Log2ConsoleUdpClient::Impl::SendFragments(const LogFragment* fragments, std::size_t count, std::size_t size,
+                                               std::uint32_t shardKey, const MessageSpan& span) {
+    if (!m_initialized) {
+        return false;
+    }
+
+    // A failed TCP send takes its destination down, so the retry goes to the standby
+    for (std::size_t attempt = 0; attempt < m_endpoints.size(); attempt++) {
+        Endpoint* endpoint = SelectEndpoint(shardKey);
+        if (!endpoint) {
+            break;
+        }
+
+        // Cut only for a datagram destination; a stream one takes the event whole
+        std::size_t limit = m_maxDatagramSize.load(std::memory_order_relaxed);
+        if (!endpoint->IsTcp() && size > limit) {
+            return SendOversized(*endpoint, fragments, count, span, limit);
+        }
+
+        bool sent;
+        {
+            LogStats::ScopedTimer timer(StatHistogram::SendTime);
+            sent = endpoint->IsTcp() ? SendStream(*endpoint, fragments, count) : SendDatagram(*endpoint, fragments, count);
+        }
+
+        if (sent) {
+            endpoint->events.fetch_add(1, std::memory_order_relaxed);
+            endpoint->bytes.fetch_add(size, std::memory_order_relaxed);
+            LogStats::Increment(StatCounter::Events);
+            LogStats::Increment(StatCounter::Bytes, size);
+            return true;
+        }
+
+        // A datagram send accounts for its own failure and has no standby to retry on
+        if (!endpoint->IsTcp()) {
+            return false;
+        }
+        endpoint->sendErrors.fetch_add(1, std::memory_order_relaxed);
+        LogStats::Increment(StatCounter::SendErrors);
+    }
+
+    // No destination is up
+    LogStats::Increment(StatCounter::Drops);
+    return false;
+}
+
+bool Log2ConsoleUdpClient::Impl::SendDatagram(Endpoint& endpoint, const LogFragment* fragments, std::size_t count) {
+    // A datagram socket send is thread-safe and sends all fragments as one datagram, so
+    // concurrent callers need no lock; the destination may be swapped meanwhile
+    LogRcu::ReadGuard guard;
+    const Destination* destination = endpoint.destination.load();
+    if (!destination) {
+        // The endpoint is being closed
+        LogStats::Increment(StatCounter::Drops);
+        return false;
+    }
+
+    int result = SendVector(destination->socket, fragments, count,
+                            (const struct sockaddr*)&destination->address, destination->length, 0);
+    if (result == SOCKET_ERROR_VALUE) {
+        endpoint.sendErrors.fetch_add(1, std::memory_order_relaxed);
+        LogStats::Increment(StatCounter::SendErrors);
+        return false;
+    }
+    return true;
+}
+
+bool Log2ConsoleUdpClient::Impl::SendStream(Endpoint& endpoint, const LogFragment* fragments, std::size_t count) {
+    std::lock_guard<std::mutex> lock(endpoint.sendMutex);
+    if (endpoint.socket == INVALID_SOCKET_VALUE) {
+        return false;
+    }
+
+    // Events are self-delimiting (XML elements, CRLF-terminated lines), so they are written back to
+    // back; after a partial write the remaining fragments are sent from where it stopped
+    LogFragment pending[LogEventFragments::kMaxFragments];
+    std::size_t index = 0;
+    std::size_t offset = 0;
+    while (index < count) {
+        std::size_t pendingCount = 0;
+        pending[pendingCount++] = LogFragment{fragments[index].data + offset, fragments[index].length - offset};
+        for (std::size_t i = index + 1; i < count; i++) {
+            pending[pendingCount++] = fragments[i];
+        }
+
+        int result = SendVector(endpoint.socket, pending, pendingCount, nullptr, 0, SEND_FLAGS_PLATFORM);
+        if (result == SOCKET_ERROR_VALUE || result == 0) {
+            // Connection lost, or the console stalled past the send timeout
+            MarkDown(endpoint);
+            return false;
+        }
+
+        std::size_t sent = static_cast<std::size_t>(result);
+        while (index < count && sent >= fragments[index].length - offset) {
+            sent -= fragments[index].length - offset;
+            index++;
+            offset = 0;
+        }
+        offset += sent;
+    }
+    return true;
+}
@@ -1,12 +1,79 @@
 #pragma once
 
 #include "Log2ConsoleCommon.h"
+#include "Log2ConsoleThread.h"
+#include <cstddef>
+#include <cstdint>
 #include <string>
 #include <memory>
+#include <vector>
+
+enum class LogTransport {
+    Udp = 0,    // one datagram per event
+    Tcp         // events written back to back on a stream connection
+};
+
+// Host names resolve to IPv4 when they have both address families (Log2Console receivers listen on
+// IPv4 unless configured otherwise); IPv6 literals and IPv6-only names are used as they are.
+// A multicast group (224.0.0.0/4, ff00::/8) as UDP host reaches every subscribed console with one send.
+struct LogDestination {
+    LogDestination(const std::string& serverHost = "localhost", int serverPort = 4445,
+                   LogTransport serverTransport = LogTransport::Udp)
+        : host(serverHost), port(serverPort), transport(serverTransport) {}
+
+    std::string host;
+    int port;
+    LogTransport transport;
+
+    // Multicast only: hop limit, delivery to consoles on this host, and outgoing interface
+    // (IPv4 address or interface name/index, empty = system default)
+    int multicastTtl = 1;
+    bool multicastLoopback = true;
+    std::string multicastInterface;
+
+    bool operator==(const LogDestination& other) const {
+        return host == other.host && port == other.port && transport == other.transport &&
+               multicastTtl == other.multicastTtl && multicastLoopback == other.multicastLoopback &&
+               multicastInterface == other.multicastInterface;
+    }
+    bool operator!=(const LogDestination& other) const { return !(*this == other); }
+};
+
+// How events are spread over several destinations. Destinations that are down (TCP not
+// connected, host not resolved) are skipped in favour of the next one in the list.
+enum class LogDistribution {
+    ShardByCategory = 0,   // stable hash of the category, so a category stays on one console
+    RoundRobin,            // successive events of a thread rotate over the destinations
+    Failover               // everything goes to the first destination that is up, the rest are standbys
+};
+
+// What happens to an event whose datagram would exceed the maximum size
+enum class LogOversizePolicy {
+    Truncate = 0,   // cut the message and append a "[truncated N bytes]" marker
+    Split           // send the message in several events prefixed "[i/n] "
+};
+
+// Per-destination counters, see Log2ConsoleUdpClient::GetDestinationStats()
+struct DestinationStats {
+    std::string name;                 // "udp://host:port", "tcp://host:port" or "udp://[v6]:port"
+    bool up = false;
+    std::uint64_t events = 0;
+    std::uint64_t bytes = 0;
+    std::uint64_t sendErrors = 0;
+    std::uint64_t redirects = 0;      // events sent elsewhere because this destination was down
+    std::uint64_t reconnects = 0;     // TCP connections re-established after a failure
+
+    // Single-line "name=value" rendering used by the periodic self-report
+    std::string ToString() const;
+};
 
 class Log2ConsoleUdpClient {
 public:
     Log2ConsoleUdpClient(const std::string& serverHost = "localhost", int serverPort = 4445, bool useXmlFormat = true);
+
+    // Several destinations, each event goes to exactly one of them
+    Log2ConsoleUdpClient(const std::vector<LogDestination>& destinations, LogDistribution distribution,
+                         bool useXmlFormat = true);
     ~Log2ConsoleUdpClient();
 
     // Delete copy constructor and copy assignment
@@ -17,14 +84,67 @@ public:
     Log2ConsoleUdpClient(Log2ConsoleUdpClient&&) noexcept;
     Log2ConsoleUdpClient& operator=(Log2ConsoleUdpClient&&) noexcept;
 
+    // Initialize() may run concurrently with Log() calls from other threads. It succeeds once
+    // at least one destination is up; the others are retried in the background.
     bool Initialize();
     void Cleanup();
     bool IsInitialized() const;
 
-    void Log(LogLevel level, const std::string& category, const std::string& message);
-    void Log(LogLevel level, const std::string& category, const std::string& message, 
-             const char* file, const char* function, int line);
+    // Events logged before Initialize() succeeded are formatted and kept in a bounded buffer
+    // (0 = drop them, the default) and sent once the transport is up
+    void SetEarlyBufferCapacity(std::size_t maxEvents);
+
+    // Hands events still waiting for initialization to another client, e.g. on reconfiguration
+    void TransferEarlyBuffer(Log2ConsoleUdpClient& target);
+
+    // Formats into a pooled per-thread buffer that is sent from directly, so a steady-state call
+    // does not allocate (category and message are referenced, not copied)
+    void Log(LogLevel level, LogStringRef category, LogStringRef message,
+             const std::vector<LogProperty>& properties = std::vector<LogProperty>(),
+             LogFieldList fields = LogFieldList());
+    void Log(LogLevel level, LogStringRef category, LogStringRef message,
+             const char* file, const char* function, int line,
+             const std::vector<LogProperty>& properties = std::vector<LogProperty>(),
+             LogFieldList fields = LogFieldList());
     void SetXmlFormat(bool useXml);
+    bool IsXmlFormat() const;
+
+    // Formats events on a pool of worker threads (0 = on the logging thread, the default). A log
+    // call then only copies the event into a per-thread queue of its severity class; a thread's
+    // events of one class are sent in the order it logged them and keep the thread id and sequence
+    // number taken at the call, but errors may overtake earlier debug events, events of different
+    // threads may be sent in a different order than they were logged, and so may events logged
+    // while the worker count changes. A full queue waits or drops as SetPriorityLanes says.
+    void SetFormattingWorkers(std::size_t workers);
+    std::size_t GetFormattingWorkers() const;
+
+    // CPU time the current formatting workers have used so far (ns; starts over when they are replaced)
+    std::uint64_t GetFormattingCpuTime() const;
+
+    // CPU affinity and priority of the formatting workers and the reconnect thread, and how idle
+    // workers wait for events; running workers are replaced to pick them up
+    void SetThreadOptions(const LogThreadOptions& options);
+
+    // When the formatting workers send what they collected; an event at or above the policy's
+    // flush level is sent before its log call returns, with everything its thread queued ahead of it
+    void SetFlushPolicy(const LogFlushPolicy& policy);
+
+    // Capacity, overflow policy and drain weight of the formatting workers' queue per severity class
+    void SetPriorityLanes(const LogPriorityLanes& lanes);
+
+    // Blocks until the events queued for the formatting workers were sent
+    void Flush();
+
+    // Re-resolve the server host name on a background thread every intervalMs (0 = off, the
+    // default); a changed address is swapped in without pausing senders
+    void SetResolveInterval(unsigned int intervalMs);
+
+    // Upper bound for one UDP datagram (default 65507, the IPv4 maximum; TCP destinations are not
+    // limited). Use the path MTU minus IP/UDP headers, e.g. 1472 on Ethernet, to avoid IP fragmentation.
+    void SetMaxDatagramSize(std::size_t bytes, LogOversizePolicy policy = LogOversizePolicy::Truncate);
+
+    std::vector<DestinationStats> GetDestinationStats() const;
+    std::size_t GetDestinationCount() const;
 
 private:
     class Impl;
@@ -1,122 +1,1412 @@
 #include "Logger.h"
+#include <algorithm>
+#include <cctype>
+#include <csignal>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <limits>
 #include <sstream>
 
+namespace {
+    const char* const kStatsCategory = "Log2Console.Stats";
+    const char* const kTopTalkersCategory = "Log2Console.TopTalkers";
+    const char* const kSheddingCategory = "Log2Console.Shedding";
+    const char* const kConfigCategory = "Log2Console.Config";
+
+    const std::chrono::milliseconds kMaintenanceTick(100);
+    const std::chrono::milliseconds kInitRetryMin(100);
+    const std::chrono::milliseconds kInitRetryMax(5000);
+    const std::chrono::milliseconds kConfigRetryInterval(5000);
+    const char* const kDefaultHost = "localhost";
+    const int kDefaultPort = 4445;
+
+    volatile std::sig_atomic_t g_topTalkerDumpRequested = 0;
+
+    extern "C" void TopTalkerSignalHandler(int) {
+        g_topTalkerDumpRequested = 1;
+    }
+}
+
 Logger& Logger::GetInstance() {
     static Logger instance;
-    
-    // Auto-initialize with default settings if not already initialized
-    if (!instance.m_initialized) {
-        instance.Initialize();
-    }
-    
+
+    // Auto-initialize with default settings exactly once; later calls are a plain guard check.
+    // Name resolution happens in the background so the first logging thread never waits for it.
+    static bool autoInitialized = instance.StartDefaultInitialization();
+    (void)autoInitialized;
+
     return instance;
 }
 
+Logger::~Logger() {
+    StopBackgroundInitialization();
+    StopMaintenance();
+    SpanRecorder::Stop();
+    delete m_config.exchange(nullptr);
+}
+
 bool Logger::Initialize(const std::string& serverHost, int serverPort, bool useXmlFormat) {
+    return Initialize(std::vector<LogDestination>{LogDestination(serverHost, serverPort)},
+                      LogDistribution::Failover, useXmlFormat);
+}
+
+bool Logger::Initialize(const std::vector<LogDestination>& destinations, LogDistribution distribution, bool useXmlFormat) {
     std::lock_guard<std::mutex> lock(m_mutex);
-    
-    if (m_initialized) {
-        return true;
+
+    // An explicit call takes over from the default initialization (which never takes m_mutex)
+    StopBackgroundInitialization();
+
+    if (destinations.empty()) {
+        return false;
+    }
+
+    std::unique_ptr<Config> config(new Config(CopyConfigLocked()));
+    config->destinations = destinations;
+    config->distribution = distribution;
+    return PublishDestinationsLocked(std::move(config), useXmlFormat);
+}
+
+bool Logger::PublishDestinationsLocked(std::unique_ptr<Config> config, bool useXmlFormat) {
+    const Config* current = m_config.load();
+    if (current && current->client && HasSameDestinations(*current, *config)) {
+        // Same transport: the other settings of the snapshot still apply, to the running client
+        std::shared_ptr<Log2ConsoleUdpClient> client = current->client;
+        UpdateClient(*current, *config, *client);
+        client->SetXmlFormat(useXmlFormat);
+        config->client = client;
+        PublishConfigLocked(std::move(config));
+        return client->Initialize();
     }
 
-    m_client = std::make_unique<Log2ConsoleUdpClient>(serverHost, serverPort, useXmlFormat);
-    
-    if (!m_client->Initialize()) {
-        m_client.reset();
+    auto client = CreateClient(*config, config->destinations, config->distribution, useXmlFormat);
+    if (!client->Initialize()) {
         return false;
     }
 
-    m_initialized = true;
+    // Report what the previous destination collected before it is retired
+    if (current && current->client) {
+        SweepRepeats(*current, true);
+        ReportScopeTimers(*current->client, m_scopeTimerSites);
+        FlushMetrics(*current->client, m_metricSites);
+    }
+
+    std::shared_ptr<Log2ConsoleUdpClient> previous = current ? current->client : nullptr;
+
+    config->client = client;
+    PublishConfigLocked(std::move(config));
+
+    // No log call uses the previous client any more; forward what it buffered before connecting
+    if (previous) {
+        previous->TransferEarlyBuffer(*client);
+    }
     return true;
 }
 
+bool Logger::HasSameDestinations(const Config& current, const Config& config) {
+    // A single destination behaves the same under every distribution
+    return current.destinations == config.destinations &&
+           (config.destinations.size() == 1 || current.distribution == config.distribution);
+}
+
 void Logger::Cleanup() {
     std::lock_guard<std::mutex> lock(m_mutex);
-    
-    if (m_client) {
-        m_client->Cleanup();
-        m_client.reset();
+
+    StopBackgroundInitialization();
+
+    const Config* current = m_config.load();
+    if (!current || !current->client) {
+        return;
     }
-    
-    m_initialized = false;
+
+    SweepRepeats(*current, true);
+    ReportScopeTimers(*current->client, m_scopeTimerSites);
+    FlushMetrics(*current->client, m_metricSites);
+
+    // Keep the remaining settings for a later Initialize(); the client is closed on retirement
+    std::unique_ptr<Config> config(new Config(CopyConfigLocked()));
+    config->client.reset();
+    config->destinations.clear();
+    PublishConfigLocked(std::move(config));
 }
 
 bool Logger::IsInitialized() const {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    return m_initialized;
+    LogRcu::ReadGuard guard;
+    const Config* config = m_config.load();
+    return config && config->client && config->client->IsInitialized();
 }
 
-void Logger::Log(LogLevel level, const std::string& category, const std::string& message) {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    
-    if (!m_initialized || !m_client) {
+void Logger::Log(LogLevel level, LogStringRef category, LogStringRef message) {
+    LogStats::CallTimer timer;
+    LogRcu::ReadGuard guard;
+
+    const Config* config = AcquireConfig(level, category);
+    if (!config) {
         return;
     }
 
-    m_client->Log(level, category, message);
+    Write(guard, *config, level, category, message, nullptr, nullptr, 0);
 }
 
-void Logger::LogWithLocation(LogLevel level, const std::string& category, const std::string& message, 
+void Logger::LogWithLocation(LogLevel level, LogStringRef category, LogStringRef message, 
                              const char* file, const char* function, int line) {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    
-    if (!m_initialized || !m_client) {
+    LogStats::CallTimer timer;
+    LogRcu::ReadGuard guard;
+
+    const Config* config = AcquireConfig(level, category);
+    if (!config) {
         return;
     }
 
     // Use the overloaded UDP client method that handles file/function/line info
-    m_client->Log(level, category, message, file, function, line);
+    Write(guard, *config, level, category, message, file, function, line);
+}
+
+void Logger::LogFields(LogLevel level, LogStringRef category, LogStringRef message, LogFieldList fields) {
+    LogStats::CallTimer timer;
+    LogRcu::ReadGuard guard;
+
+    const Config* config = AcquireConfig(level, category);
+    if (!config) {
+        return;
+    }
+
+    Write(guard, *config, level, category, message, nullptr, nullptr, 0, fields);
+}
+
+void Logger::LogFieldsWithLocation(LogLevel level, LogStringRef category, LogStringRef message, LogFieldList fields,
+                                   const char* file, const char* function, int line) {
+    LogStats::CallTimer timer;
+    LogRcu::ReadGuard guard;
+
+    const Config* config = AcquireConfig(level, category);
+    if (!config) {
+        return;
+    }
+
+    Write(guard, *config, level, category, message, file, function, line, fields);
 }
 
 void Logger::SetXmlFormat(bool useXml) {
     std::lock_guard<std::mutex> lock(m_mutex);
-    
-    if (m_client) {
-        m_client->SetXmlFormat(useXml);
+
+    // The client's format flag is atomic, so the shared transport can be switched in place
+    const Config* config = m_config.load();
+    if (config && config->client) {
+        config->client->SetXmlFormat(useXml);
     }
 }
 
-void Logger::LogToken(const std::string& tokenId, LogLevel level, const std::string& category, const std::string& message) {
+void Logger::SetResolveInterval(unsigned int intervalMs) {
     std::lock_guard<std::mutex> lock(m_mutex);
-    
-    if (!m_initialized || !m_client) {
+
+    std::unique_ptr<Config> config(new Config(CopyConfigLocked()));
+    config->resolveIntervalMs = intervalMs;
+    if (config->client) {
+        config->client->SetResolveInterval(intervalMs);
+    }
+    PublishConfigLocked(std::move(config));
+}
+
+void Logger::SetMaxDatagramSize(std::size_t bytes, LogOversizePolicy policy) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    std::unique_ptr<Config> config(new Config(CopyConfigLocked()));
+    config->maxDatagramSize = bytes;
+    config->oversizePolicy = policy;
+    if (config->client) {
+        config->client->SetMaxDatagramSize(bytes, policy);
+    }
+    PublishConfigLocked(std::move(config));
+}
+
+void Logger::SetFormattingWorkers(std::size_t workers) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    std::unique_ptr<Config> config(new Config(CopyConfigLocked()));
+    config->formattingWorkers = workers;
+    if (config->client) {
+        config->client->SetFormattingWorkers(workers);
+    }
+    PublishConfigLocked(std::move(config));
+}
+
+void Logger::SetFlushPolicy(const LogFlushPolicy& policy) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    std::unique_ptr<Config> config(new Config(CopyConfigLocked()));
+    config->flushPolicy = policy;
+    if (config->client) {
+        config->client->SetFlushPolicy(policy);
+    }
+    PublishConfigLocked(std::move(config));
+}
+
+void Logger::SetPriorityLanes(const LogPriorityLanes& lanes) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    std::unique_ptr<Config> config(new Config(CopyConfigLocked()));
+    config->priorityLanes = lanes;
+    if (config->client) {
+        config->client->SetPriorityLanes(lanes);
+    }
+    PublishConfigLocked(std::move(config));
+}
+
+bool Logger::SetBackendThreadOptions(const LogThreadOptions& options) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    std::unique_ptr<Config> config(new Config(CopyConfigLocked()));
+    config->threadOptions = options;
+    if (config->client) {
+        config->client->SetThreadOptions(options);
+    }
+    PublishConfigLocked(std::move(config));
+
+    // The maintenance thread picks the options up from the snapshot on its next tick
+    return LogThread::CanApply(options);
+}
+
+void Logger::Flush() {
+    std::shared_ptr<Log2ConsoleUdpClient> client;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const Config* current = m_config.load();
+        if (current) {
+            client = current->client;
+        }
+    }
+    if (client) {
+        client->Flush();
+    }
+}
+
+void Logger::SetStartupBufferSize(std::size_t maxEvents) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    std::unique_ptr<Config> config(new Config(CopyConfigLocked()));
+    config->startupBufferSize = maxEvents;
+    if (config->client) {
+        config->client->SetEarlyBufferCapacity(maxEvents);
+    }
+    PublishConfigLocked(std::move(config));
+}
+
+void Logger::SetMinimumLevel(LogLevel level) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    std::unique_ptr<Config> config(new Config(CopyConfigLocked()));
+    SetLevels(*config, level, GetCategoryLevels(*config));
+    PublishConfigLocked(std::move(config));
+}
+
+void Logger::SetCategoryLevel(const std::string& category, LogLevel level) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    std::unique_ptr<Config> config(new Config(CopyConfigLocked()));
+    std::vector<std::pair<std::string, LogLevel>> levels = GetCategoryLevels(*config);
+    auto it = std::find_if(levels.begin(), levels.end(),
+                           [&](const std::pair<std::string, LogLevel>& entry) { return entry.first == category; });
+    if (it != levels.end()) {
+        it->second = level;
+    } else {
+        levels.emplace_back(category, level);
+    }
+    SetLevels(*config, config->minimumLevel, levels);
+    PublishConfigLocked(std::move(config));
+    ReleaseConfigCategoryLocked(category);
+}
+
+void Logger::ClearCategoryLevel(const std::string& category) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    std::unique_ptr<Config> config(new Config(CopyConfigLocked()));
+    std::vector<std::pair<std::string, LogLevel>> levels = GetCategoryLevels(*config);
+    levels.erase(std::remove_if(levels.begin(), levels.end(),
+                                [&](const std::pair<std::string, LogLevel>& entry) { return entry.first == category; }),
+                 levels.end());
+    SetLevels(*config, config->minimumLevel, levels);
+    PublishConfigLocked(std::move(config));
+    ReleaseConfigCategoryLocked(category);
+}
+
+void Logger::ReleaseConfigCategoryLocked(const std::string& category) {
+    m_configCategories.erase(std::remove(m_configCategories.begin(), m_configCategories.end(), category),
+                             m_configCategories.end());
+}
+
+void Logger::SetLoadShedding(const LogSheddingOptions& options) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    std::unique_ptr<Config> config(new Config(CopyConfigLocked()));
+    ApplySheddingLocked(*config, options);
+    PublishConfigLocked(std::move(config));
+}
+
+void Logger::ApplySheddingLocked(Config& config, const LogSheddingOptions& options) {
+    if (!options.enabled) {
+        config.shedLevels = nullptr;
+    }
+    CommitSheddingLocked(options);
+}
+
+void Logger::CommitSheddingLocked(const LogSheddingOptions& options) {
+    m_sheddingOptions = options;
+    m_nextSheddingCheck = std::chrono::steady_clock::now();
+    LogStats::SetCpuSamplingEnabled(options.enabled);
+    if (options.enabled) {
+        StartMaintenanceLocked();
         return;
     }
 
-    // Calculate hash of the message
-    std::size_t messageHash = std::hash<std::string>{}(message);
-    
-    // Check if we've seen this message for this token before
-    auto it = m_tokenHashes.find(tokenId);
-    if (it != m_tokenHashes.end() && it->second == messageHash) {
-        // Same message, don't log
+    // Disabling restores all levels at once (the snapshot drops its shed levels)
+    m_shedder.Reset();
+}
+
+bool Logger::LoadConfiguration(const std::string& path, bool watch) {
+    std::string text;
+    bool readable = LogSettings::ReadFile(path, text);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (watch) {
+        m_configWatcher.Watch(path);
+        StartMaintenanceLocked();
+    } else if (m_configWatcher.GetPath() == path) {
+        m_configWatcher.Stop();
+    }
+    if (!readable) {
+        ReportConfigurationLocked(path, std::vector<std::string>{"cannot read the file"});
+        return false;
+    }
+    return LoadConfigurationLocked(path, text);
+}
+
+bool Logger::LoadConfigurationLocked(const std::string& path, const std::string& text) {
+    std::vector<std::string> errors;
+    m_configRetryPending = false;
+
+    // The environment overrides the file
+    LogSettings settings;
+    bool valid = settings.Parse(text, errors);
+    valid = settings.ParseEnvironment(errors) && valid;
+    if (!valid) {
+        // The same text fails the same way, it is not read again until it changes
+        m_configText = text;
+    } else {
+        // Nothing outside the snapshot changes before it is published
+        const Config* current = m_config.load();
+        std::unique_ptr<Config> config(new Config(CopyConfigLocked()));
+        SettingsCommit commit;
+        ApplySettingsLocked(*config, settings, commit);
+
+        if (config->client && current && HasSameDestinations(*current, *config)) {
+            // Same transport: only what changed is applied to it
+            UpdateClient(*current, *config, *config->client);
+            if (settings.xmlFormat.present) {
+                config->client->SetXmlFormat(settings.xmlFormat.value);
+            }
+            PublishConfigLocked(std::move(config));
+        } else if (config->destinations.empty()) {
+            // Not initialized (after Cleanup): the settings wait for the next Initialize()
+            PublishConfigLocked(std::move(config));
+        } else {
+            bool useXmlFormat = settings.xmlFormat.present ? settings.xmlFormat.value
+                              : current && current->client ? current->client->IsXmlFormat() : true;
+
+            // The default client's retries pause while new destinations are set up and resume if
+            // that fails, so the client that stays published still connects eventually
+            bool retrying = m_initThread.joinable();
+            StopBackgroundInitialization();
+            valid = PublishDestinationsLocked(std::move(config), useXmlFormat);
+            if (!valid) {
+                errors.push_back("cannot initialize the destinations");
+                if (retrying && current && current->client && !current->client->IsInitialized()) {
+                    StartBackgroundInitializationLocked(current->client);
+                }
+
+                // A destination that is briefly down must not keep the file out for good
+                if (m_configWatcher.GetPath() == path) {
+                    m_configRetryPending = true;
+                    m_nextConfigRetry = std::chrono::steady_clock::now() + kConfigRetryInterval;
+                }
+            }
+        }
+        if (valid) {
+            m_configText = text;
+            CommitSettingsLocked(commit);
+            if (settings.collapseRepeatsMs.present) {
+                RestartRepeatCollapsingLocked();
+            }
+        }
+    }
+    ReportConfigurationLocked(path, errors);
+    return valid;
+}
+
+void Logger::ApplySettingsLocked(Config& config, const LogSettings& settings, SettingsCommit& commit) {
+    // The configuration owns the category levels it set before: the ones it leaves out now are
+    // removed, while levels set through SetCategoryLevel() stay unless it names their category
+    auto owned = [&](const std::pair<std::string, LogLevel>& entry) {
+        return std::find(m_configCategories.begin(), m_configCategories.end(), entry.first) != m_configCategories.end() ||
+               std::any_of(settings.categoryLevels.begin(), settings.categoryLevels.end(),
+                           [&](const std::pair<std::string, LogLevel>& level) { return level.first == entry.first; });
+    };
+    std::vector<std::pair<std::string, LogLevel>> levels = GetCategoryLevels(config);
+    levels.erase(std::remove_if(levels.begin(), levels.end(), owned), levels.end());
+    levels.insert(levels.end(), settings.categoryLevels.begin(), settings.categoryLevels.end());
+    SetLevels(config, settings.minimumLevel.present ? settings.minimumLevel.value : config.minimumLevel, levels);
+
+    commit.configCategories.clear();
+    for (const auto& level : settings.categoryLevels) {
+        commit.configCategories.push_back(level.first);
+    }
+
+    if (settings.destinations.present) {
+        config.destinations = settings.destinations.value;
+    }
+    if (settings.distribution.present) {
+        config.distribution = settings.distribution.value;
+    }
+    if (settings.collapseRepeatsMs.present) {
+        config.collapseRepeats = settings.collapseRepeatsMs.value > 0;
+        if (config.collapseRepeats) {
+            config.collapseWindow = std::chrono::milliseconds(settings.collapseRepeatsMs.value);
+        }
+    }
+    if (settings.startupBufferSize.present) {
+        config.startupBufferSize = settings.startupBufferSize.value;
+    }
+    if (settings.resolveIntervalMs.present) {
+        config.resolveIntervalMs = settings.resolveIntervalMs.value;
+    }
+    if (settings.maxDatagramSize.present) {
+        config.maxDatagramSize = settings.maxDatagramSize.value;
+    }
+    if (settings.oversizePolicy.present) {
+        config.oversizePolicy = settings.oversizePolicy.value;
+    }
+    if (settings.formattingWorkers.present) {
+        config.formattingWorkers = settings.formattingWorkers.value;
+    }
+    if (settings.flushMaxEvents.present) {
+        config.flushPolicy.maxEvents = settings.flushMaxEvents.value;
+    }
+    if (settings.flushMaxBytes.present) {
+        config.flushPolicy.maxBytes = settings.flushMaxBytes.value;
+    }
+    if (settings.flushMaxDelayMicros.present) {
+        config.flushPolicy.maxDelayMicros = settings.flushMaxDelayMicros.value;
+    }
+    if (settings.flushLevel.present) {
+        config.flushPolicy.flushLevel = settings.flushLevel.value;
+    }
+    for (std::size_t i = 0; i < kLogSeverityClassCount; i++) {
+        if (settings.lanes[i].present) {
+            config.priorityLanes.lanes[i] = settings.lanes[i].value;
+        }
+    }
+
+    if (settings.sheddingLevel.present || settings.sheddingIntervalMs.present) {
+        LogSheddingOptions options = m_sheddingOptions;
+        if (settings.sheddingLevel.present) {
+            options.enabled = settings.sheddingLevel.value > LogLevel::L_TRACE;
+            if (options.enabled) {
+                options.maxLevel = settings.sheddingLevel.value;
+            }
+        }
+        if (settings.sheddingIntervalMs.present) {
+            options.intervalMs = settings.sheddingIntervalMs.value;
+        }
+        if (!options.enabled) {
+            config.shedLevels = nullptr;
+        }
+        commit.shedding = true;
+        commit.sheddingOptions = options;
+    }
+}
+
+void Logger::CommitSettingsLocked(const SettingsCommit& commit) {
+    m_configCategories = commit.configCategories;
+    if (commit.shedding) {
+        CommitSheddingLocked(commit.sheddingOptions);
+    }
+}
+
+void Logger::ReportConfigurationLocked(const std::string& path, const std::vector<std::string>& errors) {
+    const Config* config = m_config.load();
+    std::shared_ptr<Log2ConsoleUdpClient> client = config ? config->client : nullptr;
+
+    if (errors.empty()) {
+        if (client) {
+            client->Log(LogLevel::L_INFO, kConfigCategory, "Configuration applied from " + path,
+                        {{"path", path}});
+        }
         return;
     }
-    
-    // New or different message, update hash and log
-    m_tokenHashes[tokenId] = messageHash;
-    m_client->Log(level, category, message);
+
+    for (const std::string& error : errors) {
+        std::string message = "Configuration rejected, " + path + ": " + error;
+        if (client) {
+            client->Log(LogLevel::L_WARN, kConfigCategory, message, {{"path", path}});
+        } else {
+            std::cerr << message << std::endl;
+        }
+    }
+}
+
+bool Logger::SetClockSource(ClockSource source) {
+    if (!Log2ConsoleClock::SetSource(source)) {
+        return false;
+    }
+
+    // The maintenance thread keeps the TSC anchored to the system clock
+    if (source == ClockSource::Tsc) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        StartMaintenanceLocked();
+    }
+    return true;
+}
+
+void Logger::LogToken(const std::string& tokenId, LogLevel level, LogStringRef category, LogStringRef message) {
+    LogStats::CallTimer timer;
+    LogRcu::ReadGuard guard;
+
+    const Config* config = AcquireConfig(level, category);
+    if (!config) {
+        return;
+    }
+
+    // Only log when the message for this token changed
+    if (IsTokenRepeat(tokenId, message)) {
+        return;
+    }
+    Write(guard, *config, level, category, message, nullptr, nullptr, 0);
 }
 
-void Logger::LogTokenWithLocation(const std::string& tokenId, LogLevel level, const std::string& category, const std::string& message,
+void Logger::LogTokenWithLocation(const std::string& tokenId, LogLevel level, LogStringRef category, LogStringRef message,
                                  const char* file, const char* function, int line) {
+    LogStats::CallTimer timer;
+    LogRcu::ReadGuard guard;
+
+    const Config* config = AcquireConfig(level, category);
+    if (!config) {
+        return;
+    }
+
+    // Only log when the message for this token changed
+    if (IsTokenRepeat(tokenId, message)) {
+        return;
+    }
+    Write(guard, *config, level, category, message, file, function, line);
+}
+
+void Logger::SetRepeatCollapsing(bool enabled, unsigned int windowMs) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    std::unique_ptr<Config> config(new Config(CopyConfigLocked()));
+    config->collapseRepeats = enabled;
+    config->collapseWindow = std::chrono::milliseconds(windowMs);
+    PublishConfigLocked(std::move(config));
+    RestartRepeatCollapsingLocked();
+}
+
+void Logger::RestartRepeatCollapsingLocked() {
+    // Readers of the old snapshot have drained, so nothing is collapsed after this flush
+    const Config* current = m_config.load();
+    if (!current->collapseRepeats && current->client) {
+        SweepRepeats(*current, true);
+    }
+    {
+        std::lock_guard<std::mutex> repeatLock(m_repeatMutex);
+        m_nextRepeatSweep = std::chrono::steady_clock::now() + current->collapseWindow;
+    }
+
+    if (current->collapseRepeats) {
+        StartMaintenanceLocked();
+    }
+}
+
+void Logger::FlushRepeats() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    const Config* config = m_config.load();
+    if (!config || !config->client) {
+        return;
+    }
+
+    SweepRepeats(*config, true);
+}
+
+bool Logger::StartDefaultInitialization() {
     std::lock_guard<std::mutex> lock(m_mutex);
-    
-    if (!m_initialized || !m_client) {
+
+    const Config* current = m_config.load();
+    if (current && current->client) {
+        return true;
+    }
+
+    // Settings from LTC_CONFIG and the environment; with an error in either, none of them apply
+    std::string path = LogSettings::GetEnvironmentPath();
+    std::string text;
+    LogSettings settings;
+    std::vector<std::string> errors;
+    bool valid = true;
+    if (!path.empty()) {
+        if (LogSettings::ReadFile(path, text)) {
+            valid = settings.Parse(text, errors);
+        } else {
+            errors.push_back("cannot read the file");
+            valid = false;
+        }
+    }
+    valid = settings.ParseEnvironment(errors) && valid;
+
+    std::unique_ptr<Config> config(new Config(CopyConfigLocked()));
+    config->destinations = {LogDestination(kDefaultHost, kDefaultPort)};
+    config->distribution = LogDistribution::Failover;
+    bool useXmlFormat = true;
+    SettingsCommit commit;
+    if (valid) {
+        ApplySettingsLocked(*config, settings, commit);
+        if (settings.xmlFormat.present) {
+            useXmlFormat = settings.xmlFormat.value;
+        }
+    }
+
+    // Publish the client right away so events are buffered until it is connected
+    auto client = CreateClient(*config, config->destinations, config->distribution, useXmlFormat);
+    config->client = client;
+    PublishConfigLocked(std::move(config));
+    if (valid) {
+        CommitSettingsLocked(commit);
+    }
+
+    if (!path.empty()) {
+        m_configText = text;
+        m_configWatcher.Watch(path);
+        StartMaintenanceLocked();
+    }
+    if (!path.empty() || !errors.empty()) {
+        ReportConfigurationLocked(path.empty() ? "environment" : path, errors);
+    }
+
+    StartBackgroundInitializationLocked(client);
+    return true;
+}
+
+void Logger::StartBackgroundInitializationLocked(std::shared_ptr<Log2ConsoleUdpClient> client) {
+    {
+        std::lock_guard<std::mutex> initLock(m_initMutex);
+        m_initStop = false;
+    }
+    m_initThread = std::thread(&Logger::InitializeInBackground, this, std::move(client));
+}
+
+void Logger::InitializeInBackground(std::shared_ptr<Log2ConsoleUdpClient> client) {
+    // Retry with exponential backoff, e.g. while the resolver or network is not up yet
+    std::chrono::milliseconds delay = kInitRetryMin;
+    while (!client->Initialize()) {
+        std::unique_lock<std::mutex> lock(m_initMutex);
+        if (m_initCondition.wait_for(lock, delay, [this]() { return m_initStop; })) {
+            return;
+        }
+        delay = std::min(delay * 2, kInitRetryMax);
+    }
+}
+
+void Logger::StopBackgroundInitialization() {
+    {
+        std::lock_guard<std::mutex> lock(m_initMutex);
+        m_initStop = true;
+    }
+    m_initCondition.notify_all();
+
+    if (m_initThread.joinable()) {
+        m_initThread.join();
+    }
+}
+
+const Logger::Config* Logger::AcquireConfig(LogLevel level, LogStringRef category) const {
+    const Config* config = m_config.load();
+
+    if (!config || !config->client) {
+        LogStats::Increment(StatCounter::Drops);
+        return nullptr;
+    }
+
+    if (level < config->lowestLevel) {
+        return nullptr;
+    }
+
+    if (level < config->highestLevel && level < config->categoryLevels->Find(category)) {
+        return nullptr;
+    }
+
+    if (config->shedLevels && level < config->shedLevels->Find(category)) {
+        LogStats::Increment(StatCounter::ShedEvents);
+        return nullptr;
+    }
+
+    return config;
+}
+
+std::shared_ptr<Log2ConsoleUdpClient> Logger::CreateClient(const Config& config,
+                                                           const std::vector<LogDestination>& destinations,
+                                                           LogDistribution distribution, bool useXmlFormat) {
+    auto client = std::make_shared<Log2ConsoleUdpClient>(destinations, distribution, useXmlFormat);
+    client->SetEarlyBufferCapacity(config.startupBufferSize);
+    client->SetResolveInterval(config.resolveIntervalMs);
+    client->SetMaxDatagramSize(config.maxDatagramSize, config.oversizePolicy);
+    client->SetThreadOptions(config.threadOptions);
+    client->SetFlushPolicy(config.flushPolicy);
+    client->SetPriorityLanes(config.priorityLanes);
+    client->SetFormattingWorkers(config.formattingWorkers);
+    return client;
+}
+
+void Logger::UpdateClient(const Config& previous, const Config& config, Log2ConsoleUdpClient& client) {
+    if (config.startupBufferSize != previous.startupBufferSize) {
+        client.SetEarlyBufferCapacity(config.startupBufferSize);
+    }
+    if (config.resolveIntervalMs != previous.resolveIntervalMs) {
+        client.SetResolveInterval(config.resolveIntervalMs);
+    }
+    if (config.maxDatagramSize != previous.maxDatagramSize || config.oversizePolicy != previous.oversizePolicy) {
+        client.SetMaxDatagramSize(config.maxDatagramSize, config.oversizePolicy);
+    }
+    if (config.threadOptions != previous.threadOptions) {
+        client.SetThreadOptions(config.threadOptions);
+    }
+    if (config.flushPolicy != previous.flushPolicy) {
+        client.SetFlushPolicy(config.flushPolicy);
+    }
+    if (config.priorityLanes != previous.priorityLanes) {
+        client.SetPriorityLanes(config.priorityLanes);
+    }
+    if (config.formattingWorkers != previous.formattingWorkers) {
+        client.SetFormattingWorkers(config.formattingWorkers);
+    }
+}
+
+void Logger::SetLevels(Config& config, LogLevel minimumLevel,
+                       const std::vector<std::pair<std::string, LogLevel>>& categoryLevels) {
+    config.minimumLevel = minimumLevel;
+    config.lowestLevel = minimumLevel;
+    config.highestLevel = minimumLevel;
+
+    auto levels = std::make_shared<LogCategoryLevels>(minimumLevel);
+    for (const auto& entry : categoryLevels) {
+        levels->Set(entry.first, entry.second);
+    }
+    for (const auto& entry : levels->GetEntries()) {
+        config.lowestLevel = std::min(config.lowestLevel, entry.second);
+        config.highestLevel = std::max(config.highestLevel, entry.second);
+    }
+    config.categoryLevels = levels->IsEmpty() ? nullptr : levels;
+}
+
+std::vector<std::pair<std::string, LogLevel>> Logger::GetCategoryLevels(const Config& config) {
+    return config.categoryLevels ? config.categoryLevels->GetEntries() : std::vector<std::pair<std::string, LogLevel>>();
+}
+
+Logger::Config Logger::CopyConfigLocked() const {
+    const Config* current = m_config.load();
+    return current ? *current : Config();
+}
+
+void Logger::PublishConfigLocked(std::unique_ptr<Config> config) {
+    const Config* previous = m_config.exchange(config.release());
+
+    // Free the old snapshot (and possibly its transport) once no log call can still use it
+    LogRcu::Synchronize();
+    delete previous;
+}
+
+bool Logger::IsHexSpecifier(LogStringRef specifier, bool& uppercase, bool& prefix) {
+    if (specifier == "x" || specifier == "X") {
+        uppercase = specifier[0] == 'X';
+        prefix = false;
+        return true;
+    }
+    if (specifier.StartsWith("#x") || specifier.StartsWith("#X")) {
+        uppercase = specifier[1] == 'X';
+        prefix = true;
+        return true;
+    }
+    return false;
+}
+
+bool Logger::ParsePrecision(LogStringRef specifier, int& precision) {
+    // ":.N", read like std::stoi did: leading blanks and a sign are accepted, trailing text ignored
+    if (!specifier.StartsWith(":.")) {
+        return false;
+    }
+    std::size_t i = 2;
+    while (i < specifier.Size() && std::isspace(static_cast<unsigned char>(specifier[i]))) {
+        i++;
+    }
+    bool negative = false;
+    if (i < specifier.Size() && (specifier[i] == '+' || specifier[i] == '-')) {
+        negative = specifier[i] == '-';
+        i++;
+    }
+    if (i == specifier.Size() || !std::isdigit(static_cast<unsigned char>(specifier[i]))) {
+        return false;
+    }
+
+    long long value = 0;
+    for (; i < specifier.Size() && std::isdigit(static_cast<unsigned char>(specifier[i])); i++) {
+        value = value * 10 + (specifier[i] - '0');
+        if (value > std::numeric_limits<int>::max()) {
+            return false;
+        }
+    }
+    precision = static_cast<int>(negative ? -value : value);
+    return true;
+}
+
+void Logger::AppendFloating(std::string& out, double value, LogStringRef specifier) {
+    // The conversions std::ostream uses: %g by default, %.Nf for std::fixed with setprecision(N)
+    int precision = 0;
+    bool fixed = ParsePrecision(specifier, precision);
+    if (fixed && precision < 0) {
+        precision = 6;
+    }
+
+    char buffer[64];
+    int length = fixed ? std::snprintf(buffer, sizeof(buffer), "%.*f", precision, value)
+                       : std::snprintf(buffer, sizeof(buffer), "%g", value);
+    if (length < 0) {
         return;
     }
+    if (static_cast<std::size_t>(length) < sizeof(buffer)) {
+        out.append(buffer, static_cast<std::size_t>(length));
+        return;
+    }
+
+    // Huge values or precisions in fixed notation, rendered straight into the output
+    std::size_t size = out.size();
+    out.resize(size + static_cast<std::size_t>(length) + 1);
+    std::snprintf(&out[size], static_cast<std::size_t>(length) + 1, "%.*f", precision, value);
+    out.resize(size + static_cast<std::size_t>(length));
+}
 
+bool Logger::IsTokenRepeat(const std::string& tokenId, LogStringRef message) {
     // Calculate hash of the message
-    std::size_t messageHash = std::hash<std::string>{}(message);
-    
+    std::size_t messageHash = message.Hash();
+
+    std::lock_guard<std::mutex> lock(m_tokenMutex);
+
     // Check if we've seen this message for this token before
     auto it = m_tokenHashes.find(tokenId);
     if (it != m_tokenHashes.end() && it->second == messageHash) {
         // Same message, don't log
-        return;
+        LogStats::Increment(StatCounter::TokenSuppressions);
+        return true;
     }
-    
+
     // New or different message, update hash and log
     m_tokenHashes[tokenId] = messageHash;
-    m_client->Log(level, category, message, file, function, line);
+    return false;
+}
+
+void Logger::Write(LogRcu::ReadGuard& guard, const Config& config, LogLevel level, LogStringRef category,
+                   LogStringRef message, const char* file, const char* function, int line,
+                   LogFieldList fields) {
+    Log2ConsoleUdpClient& client = *config.client;
+    bool collapseRepeats = config.collapseRepeats;
+    std::chrono::milliseconds collapseWindow = config.collapseWindow;
+
+    // The client waits until a severe event was sent. Only the reference taken here keeps it
+    // alive during that wait, outside the read section; the snapshot is not used after this.
+    std::shared_ptr<Log2ConsoleUdpClient> severeClient;
+    if (level >= config.flushPolicy.flushLevel) {
+        severeClient = config.client;
+        guard.Release();
+    }
+
+    // Events with structured fields carry their content in the fields, so they are never collapsed
+    if (!collapseRepeats || fields.size() > 0) {
+        if (file) {
+            client.Log(level, category, message, file, function, line, std::vector<LogProperty>(), fields);
+        } else {
+            client.Log(level, category, message, std::vector<LogProperty>(), fields);
+        }
+        return;
+    }
+
+    // Only the collapse decision is made under the lock; summaries and the event are sent after it
+    std::vector<RepeatSummary> summaries;
+    bool collapsed = false;
+    {
+        std::lock_guard<std::mutex> lock(m_repeatMutex);
+        auto now = std::chrono::steady_clock::now();
+
+        // Periodically report callsites that went quiet while collapsing
+        if (now >= m_nextRepeatSweep) {
+            SweepRepeatsLocked(collapseWindow, now, false, summaries);
+            m_nextRepeatSweep = now + collapseWindow;
+        }
+
+        RepeatKey key{file, line, category.Hash()};
+        std::size_t messageHash = message.Hash();
+
+        auto it = m_repeats.find(key);
+        if (it != m_repeats.end() && it->second.messageHash == messageHash && it->second.message == message &&
+            now - it->second.windowStart < collapseWindow) {
+            // Same message from the same callsite within the window, just count it
+            it->second.count++;
+            it->second.lastSeen = now;
+            LogStats::Increment(StatCounter::RepeatSuppressions);
+            collapsed = true;
+        } else {
+            if (it != m_repeats.end()) {
+                // Message changed or window expired, report what was collapsed so far
+                TakeRepeatSummaryLocked(key, it->second, summaries);
+            }
+
+            RepeatState& state = m_repeats[key];
+            state.messageHash = messageHash;
+            state.level = level;
+            state.category = category.ToString();
+            state.message = message.ToString();
+            state.function = function;
+            state.windowStart = now;
+            state.lastSeen = now;
+            state.count = 0;
+        }
+    }
+
+    SendRepeatSummaries(client, summaries);
+    if (collapsed) {
+        return;
+    }
+    if (file) {
+        client.Log(level, category, message, file, function, line);
+    } else {
+        client.Log(level, category, message);
+    }
+}
+
+void Logger::TakeRepeatSummaryLocked(const RepeatKey& key, RepeatState& state, std::vector<RepeatSummary>& summaries) {
+    if (state.count == 0) {
+        return;
+    }
+
+    auto elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(state.lastSeen - state.windowStart).count();
+    summaries.push_back(RepeatSummary{state.level, state.category, state.message, key.file, state.function,
+                                      key.line, state.count, static_cast<long long>(elapsedMs)});
+    state.count = 0;
+}
+
+void Logger::SweepRepeatsLocked(std::chrono::milliseconds window, std::chrono::steady_clock::time_point now,
+                                bool flushAll, std::vector<RepeatSummary>& summaries) {
+    for (auto it = m_repeats.begin(); it != m_repeats.end();) {
+        if (flushAll || now - it->second.windowStart >= window) {
+            TakeRepeatSummaryLocked(it->first, it->second, summaries);
+            it = m_repeats.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void Logger::SweepRepeats(const Config& config, bool flushAll) {
+    std::vector<RepeatSummary> summaries;
+    {
+        std::lock_guard<std::mutex> lock(m_repeatMutex);
+        SweepRepeatsLocked(config.collapseWindow, std::chrono::steady_clock::now(), flushAll, summaries);
+    }
+    SendRepeatSummaries(*config.client, summaries);
+}
+
+void Logger::SendRepeatSummaries(Log2ConsoleUdpClient& client, const std::vector<RepeatSummary>& summaries) {
+    for (const RepeatSummary& summary : summaries) {
+        std::vector<LogProperty> properties;
+        properties.push_back({"Repeated", "repeated " + std::to_string(summary.count) + " times over " +
+                                          std::to_string(summary.elapsedMs) + " ms"});
+
+        if (summary.file) {
+            client.Log(summary.level, summary.category, summary.message, summary.file, summary.function,
+                       summary.line, properties);
+        } else {
+            client.Log(summary.level, summary.category, summary.message, properties);
+        }
+    }
+}
+
+LogStatsSnapshot Logger::GetStats() const {
+    return LogStats::Snapshot();
+}
+
+std::vector<DestinationStats> Logger::GetDestinationStats() const {
+    LogRcu::ReadGuard guard;
+    const Config* config = m_config.load();
+    if (!config || !config->client) {
+        return std::vector<DestinationStats>();
+    }
+    return config->client->GetDestinationStats();
+}
+
+void Logger::SetStatsReportInterval(unsigned int intervalMs) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_statsReportInterval = std::chrono::milliseconds(intervalMs);
+    m_nextStatsReport = std::chrono::steady_clock::now() + m_statsReportInterval;
+
+    if (intervalMs > 0) {
+        StartMaintenanceLocked();
+    }
+}
+
+std::vector<EmitterStats> Logger::GetTopEmitters(EmitterKind kind, std::size_t count) const {
+    return LogStats::TopEmitters(kind, count);
+}
+
+void Logger::EnableTopTalkerDumpOnSignal(int signalNumber, std::size_t count) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_topTalkerDumpCount = count;
+    std::signal(signalNumber, TopTalkerSignalHandler);
+    StartMaintenanceLocked();
+}
+
+ScopeTimerSite& Logger::RegisterScopeTimer(const std::string& category, const std::string& name,
+                                           const char* file, const char* function, int line) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    ScopeTimerSite* site = new ScopeTimerSite(category, name, file, function, line);
+    m_scopeTimerSites.push_back(site);
+
+    if (m_scopeTimerSites.size() == 1) {
+        m_nextScopeTimerReport = std::chrono::steady_clock::now() + m_scopeTimerInterval;
+    }
+    StartMaintenanceLocked();
+    return *site;
+}
+
+void Logger::SetScopeTimerReportInterval(unsigned int intervalMs) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_scopeTimerInterval = std::chrono::milliseconds(intervalMs);
+    m_nextScopeTimerReport = std::chrono::steady_clock::now() + m_scopeTimerInterval;
+}
+
+MetricSite& Logger::RegisterMetric(const std::string& category, const std::string& name, MetricKind kind) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // Callsites using the same category and name share one metric
+    std::string key = category + '\n' + name;
+    auto it = m_metricsByName.find(key);
+    if (it != m_metricsByName.end()) {
+        return *it->second;
+    }
+
+    MetricSite* site = new MetricSite(category, name, kind, m_metricSites.size());
+    m_metricSites.push_back(site);
+    m_metricsByName[key] = site;
+
+    if (m_metricSites.size() == 1) {
+        m_nextMetricsFlush = std::chrono::steady_clock::now() + m_metricsFlushInterval;
+    }
+    StartMaintenanceLocked();
+    return *site;
+}
+
+void Logger::SetMetricsFlushInterval(unsigned int intervalMs) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_metricsFlushInterval = std::chrono::milliseconds(intervalMs);
+    m_nextMetricsFlush = std::chrono::steady_clock::now() + m_metricsFlushInterval;
+}
+
+bool Logger::StartSpanRecording(const std::string& path) {
+    return SpanRecorder::Start(path);
+}
+
+void Logger::StopSpanRecording() {
+    SpanRecorder::Stop();
+}
+
+void Logger::StartMaintenanceLocked() {
+    if (m_maintenanceThread.joinable()) {
+        return;
+    }
+
+    m_maintenanceStop = false;
+    m_maintenanceThread = std::thread(&Logger::MaintenanceLoop, this);
+}
+
+void Logger::StopMaintenance() {
+    {
+        std::lock_guard<std::mutex> lock(m_maintenanceMutex);
+        m_maintenanceStop = true;
+    }
+    m_maintenanceCondition.notify_all();
+
+    if (m_maintenanceThread.joinable()) {
+        m_maintenanceThread.join();
+    }
+}
+
+void Logger::MaintenanceLoop() {
+    LogThreadOptions appliedOptions;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(m_maintenanceMutex);
+            if (m_maintenanceCondition.wait_for(lock, kMaintenanceTick, [this]() { return m_maintenanceStop; })) {
+                return;
+            }
+        }
+
+        Log2ConsoleClock::Reanchor();
+
+        // A changed configuration file is applied first, it replaces the snapshot
+        PollConfigurationFile();
+
+        // What is due in this pass, taken under m_mutex; the client copy keeps the transport alive
+        // after the snapshot it came from is replaced
+        std::shared_ptr<Log2ConsoleUdpClient> client;
+        LogThreadOptions threadOptions;
+        bool collapseRepeats = false;
+        std::chrono::milliseconds collapseWindow(0);
+        bool reportStats = false;
+        bool updateShedding = false;
+        std::vector<ScopeTimerSite*> scopeTimerSites;
+        std::vector<MetricSite*> metricSites;
+        auto now = std::chrono::steady_clock::now();
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            const Config* config = m_config.load();
+            if (!config) {
+                continue;
+            }
+            threadOptions = config->threadOptions;
+            client = config->client;
+            collapseRepeats = config->collapseRepeats;
+            collapseWindow = config->collapseWindow;
+
+            if (client) {
+                if (m_statsReportInterval.count() > 0 && now >= m_nextStatsReport) {
+                    reportStats = true;
+                    m_nextStatsReport = now + m_statsReportInterval;
+                }
+                if (m_scopeTimerInterval.count() > 0 && now >= m_nextScopeTimerReport) {
+                    scopeTimerSites = m_scopeTimerSites;
+                    m_nextScopeTimerReport = now + m_scopeTimerInterval;
+                }
+                if (m_metricsFlushInterval.count() > 0 && now >= m_nextMetricsFlush) {
+                    metricSites = m_metricSites;
+                    m_nextMetricsFlush = now + m_metricsFlushInterval;
+                }
+                if (m_sheddingOptions.enabled && now >= m_nextSheddingCheck) {
+                    updateShedding = true;
+                    m_nextSheddingCheck = now + std::chrono::milliseconds(m_sheddingOptions.intervalMs);
+                }
+            }
+        }
+
+        if (threadOptions != appliedOptions) {
+            threadOptions.ApplyToCurrentThread();
+            appliedOptions = threadOptions;
+        }
+        if (!client) {
+            continue;
+        }
+
+        if (collapseRepeats) {
+            std::vector<RepeatSummary> summaries;
+            {
+                std::lock_guard<std::mutex> repeatLock(m_repeatMutex);
+                if (now >= m_nextRepeatSweep) {
+                    SweepRepeatsLocked(collapseWindow, now, false, summaries);
+                    m_nextRepeatSweep = now + collapseWindow;
+                }
+            }
+            SendRepeatSummaries(*client, summaries);
+        }
+
+        if (reportStats) {
+            ReportStats(*client);
+        }
+        ReportScopeTimers(*client, scopeTimerSites);
+        FlushMetrics(*client, metricSites);
+
+        if (g_topTalkerDumpRequested) {
+            g_topTalkerDumpRequested = 0;
+            std::string report = LogStats::FormatTopEmitters(m_topTalkerDumpCount);
+            std::cerr << report << std::flush;
+            client->Log(LogLevel::L_INFO, kTopTalkersCategory, report);
+        }
+
+        if (updateShedding) {
+            UpdateShedding(client);
+        }
+    }
+}
+
+void Logger::PollConfigurationFile() {
+    std::string path;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        bool changed = m_configWatcher.HasChanged();
+        if (changed || (m_configRetryPending && std::chrono::steady_clock::now() >= m_nextConfigRetry)) {
+            path = m_configWatcher.GetPath();
+        }
+    }
+
+    // The file is read without the lock; a file being replaced is picked up by its next event
+    std::string text;
+    if (path.empty() || !LogSettings::ReadFile(path, text)) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_configWatcher.GetPath() != path) {
+        return;
+    }
+    if (text != m_configText) {
+        LoadConfigurationLocked(path, text);
+    } else {
+        m_configRetryPending = false;   // changed back to what is applied
+    }
+}
+
+void Logger::UpdateShedding(const std::shared_ptr<Log2ConsoleUdpClient>& client) {
+    // Time spent logging: formatting workers' CPU time plus the sampled CPU time of log calls
+    LogStatsSnapshot stats = LogStats::Snapshot();
+    LogLoadSample sample;
+    sample.time = std::chrono::steady_clock::now();
+    sample.queueDepth = stats.queueDepth;
+    sample.sendErrors = stats.sendErrors;
+    sample.busyNanos = stats.callCpuNanos + client->GetFormattingCpuTime();
+    sample.categories = LogStats::TopEmitters(EmitterKind::Category, std::numeric_limits<std::size_t>::max());
+
+    std::vector<LogSheddingTransition> transitions;
+    std::vector<LogProperty> readings;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_sheddingOptions.enabled) {
+            return;
+        }
+        transitions = m_shedder.Update(m_sheddingOptions, sample);
+        if (transitions.empty()) {
+            return;
+        }
+
+        std::unique_ptr<Config> config(new Config(CopyConfigLocked()));
+        config->shedLevels = m_shedder.GetLevels();
+        PublishConfigLocked(std::move(config));
+
+        std::ostringstream load;
+        load << std::fixed << std::setprecision(2) << m_shedder.GetBusyCores();
+        readings.push_back({"queueDepth", std::to_string(m_shedder.GetQueueDepth())});
+        readings.push_back({"sendErrors", std::to_string(m_shedder.GetSendErrors())});
+        readings.push_back({"busyCores", load.str()});
+    }
+
+    for (const LogSheddingTransition& transition : transitions) {
+        std::string category = transition.category.empty() ? "*" : transition.category;
+        bool raised = transition.to > transition.from;
+
+        std::vector<LogProperty> properties;
+        properties.push_back({"category", category});
+        properties.push_back({"from", Log2ConsoleFormatter::LogLevelToString(transition.from)});
+        properties.push_back({"to", Log2ConsoleFormatter::LogLevelToString(transition.to)});
+        properties.insert(properties.end(), readings.begin(), readings.end());
+
+        std::string message = "Load shedding: minimum level of " + category + (raised ? " raised" : " lowered") +
+                              " from " + properties[1].value + " to " + properties[2].value +
+                              " (queueDepth=" + properties[3].value + " sendErrors=" + properties[4].value +
+                              " busyCores=" + properties[5].value + ")";
+        client->Log(raised ? LogLevel::L_WARN : LogLevel::L_INFO, kSheddingCategory, message, properties);
+    }
+}
+
+void Logger::ReportStats(Log2ConsoleUdpClient& client) {
+    client.Log(LogLevel::L_INFO, kStatsCategory, LogStats::Snapshot().ToString());
+
+    if (client.GetDestinationCount() > 1) {
+        for (const DestinationStats& destination : client.GetDestinationStats()) {
+            client.Log(LogLevel::L_INFO, kStatsCategory, destination.ToString());
+        }
+    }
+}
+
+void Logger::ReportScopeTimers(Log2ConsoleUdpClient& client, const std::vector<ScopeTimerSite*>& sites) {
+    std::lock_guard<std::mutex> lock(m_reportMutex);
+    for (ScopeTimerSite* site : sites) {
+        ScopeTimerSummary summary = site->TakeSummary();
+        if (summary.count == 0) {
+            continue;
+        }
+
+        auto toMicros = [](std::uint64_t nanos) {
+            std::ostringstream oss;
+            oss << std::fixed << std::setprecision(1) << static_cast<double>(nanos) / 1000.0;
+            return oss.str();
+        };
+
+        std::vector<LogProperty> properties;
+        properties.push_back({"count", std::to_string(summary.count)});
+        properties.push_back({"minUs", toMicros(summary.minNanos)});
+        properties.push_back({"p50Us", toMicros(summary.p50Nanos)});
+        properties.push_back({"p99Us", toMicros(summary.p99Nanos)});
+        properties.push_back({"maxUs", toMicros(summary.maxNanos)});
+
+        std::string message = site->GetName() + ": count=" + properties[0].value +
+                              " min=" + properties[1].value + "us p50=" + properties[2].value +
+                              "us p99=" + properties[3].value + "us max=" + properties[4].value + "us";
+
+        client.Log(LogLevel::L_INFO, site->GetCategory(), message,
+                   site->GetFile(), site->GetFunction(), site->GetLine(), properties);
+    }
+}
+
+void Logger::FlushMetrics(Log2ConsoleUdpClient& client, const std::vector<MetricSite*>& sites) {
+    if (sites.empty()) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_reportMutex);
+
+    std::vector<std::int64_t> slotTotals = LogMetrics::SumSlots();
+
+    // One event per category, in order of first registration
+    std::vector<std::string> categories;
+    std::unordered_map<std::string, std::vector<LogProperty>> propertiesByCategory;
+
+    for (MetricSite* site : sites) {
+        std::int64_t value = 0;
+        if (site->GetKind() == MetricKind::Counter) {
+            value = site->TakeCounterDelta(slotTotals);
+            if (value == 0) {
+                continue;
+            }
+        } else if (!site->GetGauge(value)) {
+            continue;
+        }
+
+        auto it = propertiesByCategory.find(site->GetCategory());
+        if (it == propertiesByCategory.end()) {
+            categories.push_back(site->GetCategory());
+            it = propertiesByCategory.emplace(site->GetCategory(), std::vector<LogProperty>()).first;
+        }
+        it->second.push_back({site->GetName(), std::to_string(value)});
+    }
+
+    for (const std::string& category : categories) {
+        const std::vector<LogProperty>& properties = propertiesByCategory[category];
+
+        std::string message;
+        for (const LogProperty& property : properties) {
+            if (!message.empty()) {
+                message += ' ';
+            }
+            message += property.name + "=" + property.value;
+        }
+
+        client.Log(LogLevel::L_INFO, category, message, properties);
+    }
 }
\ No newline at end of file
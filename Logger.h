@@ -1,83 +1,218 @@
 #pragma once
 
 #include "Log2ConsoleUdpClient.h"
+#include "Log2ConsoleBuffer.h"
+#include "Log2ConsoleContext.h"
+#include "Log2ConsoleLoadShedder.h"
+#include "Log2ConsoleMetrics.h"
+#include "Log2ConsoleProfiler.h"
+#include "Log2ConsoleRcu.h"
+#include "Log2ConsoleSettings.h"
+#include "Log2ConsoleStats.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <memory>
 #include <mutex>
+#include <thread>
 #include <unordered_map>
 
 class Logger {
 public:
-    static Logger& GetInstance(); // Auto-initializes with default settings on first call
+    // Auto-initializes with default settings on first call. The connection is set up in the
+    // background; events logged until it is ready are buffered (see SetStartupBufferSize)
+    static Logger& GetInstance();
 
-    // Initialize or reconfigure the logger with server details
+    // Initialize or reconfigure the logger with server details. Reconfiguring swaps in a new
+    // transport without blocking log calls; the old one is closed once in-flight calls finished.
     bool Initialize(const std::string& serverHost = "localhost", int serverPort = 4445, bool useXmlFormat = true);
+
+    // Initialize with several consoles; each event goes to one of them according to distribution.
+    // Active/standby failover works for TCP destinations, whose lost connections are detected.
+    bool Initialize(const std::vector<LogDestination>& destinations,
+                    LogDistribution distribution = LogDistribution::ShardByCategory, bool useXmlFormat = true);
     void Cleanup();
     bool IsInitialized() const;
 
     // Standard log method
-    void Log(LogLevel level, const std::string& category, const std::string& message);
+    void Log(LogLevel level, LogStringRef category, LogStringRef message);
 
     // Extended log method with file, function, and line information
-    void LogWithLocation(LogLevel level, const std::string& category, const std::string& message, 
+    void LogWithLocation(LogLevel level, LogStringRef category, LogStringRef message, 
                         const char* file, const char* function, int line);
 
+    // Structured log methods - typed fields are sent as log4j:data properties next to the message
+    void LogFields(LogLevel level, LogStringRef category, LogStringRef message, LogFieldList fields);
+    void LogFieldsWithLocation(LogLevel level, LogStringRef category, LogStringRef message, LogFieldList fields,
+                               const char* file, const char* function, int line);
+
+    // Mapped diagnostic context - the field is attached to every event logged by the calling
+    // thread until the returned guard goes out of scope
+    template<typename T>
+    static LogContextGuard PushContext(const char* name, const T& value) {
+        return LogContextGuard(LogField(name, value));
+    }
+
     // Printf-style log methods with one parameter
     template<typename T>
-    void Log(LogLevel level, const std::string& category, const std::string& format, T value);
+    void Log(LogLevel level, LogStringRef category, LogStringRef format, T value);
     
     template<typename T>
-    void LogWithLocation(LogLevel level, const std::string& category, const std::string& format, T value,
+    void LogWithLocation(LogLevel level, LogStringRef category, LogStringRef format, T value,
                         const char* file, const char* function, int line);
 
     // Printf-style log methods with two parameters
     template<typename T1, typename T2>
-    void Log(LogLevel level, const std::string& category, const std::string& format, T1 value1, T2 value2);
+    void Log(LogLevel level, LogStringRef category, LogStringRef format, T1 value1, T2 value2);
     
     template<typename T1, typename T2>
-    void LogWithLocation(LogLevel level, const std::string& category, const std::string& format, T1 value1, T2 value2,
+    void LogWithLocation(LogLevel level, LogStringRef category, LogStringRef format, T1 value1, T2 value2,
                         const char* file, const char* function, int line);
 
     // Printf-style log methods with three parameters
     template<typename T1, typename T2, typename T3>
-    void Log(LogLevel level, const std::string& category, const std::string& format, T1 value1, T2 value2, T3 value3);
+    void Log(LogLevel level, LogStringRef category, LogStringRef format, T1 value1, T2 value2, T3 value3);
     
     template<typename T1, typename T2, typename T3>
-    void LogWithLocation(LogLevel level, const std::string& category, const std::string& format, T1 value1, T2 value2, T3 value3,
+    void LogWithLocation(LogLevel level, LogStringRef category, LogStringRef format, T1 value1, T2 value2, T3 value3,
                         const char* file, const char* function, int line);
 
     // Set XML format preference
     void SetXmlFormat(bool useXml);
 
+    // Re-resolve the destination host name every intervalMs (0 = off, default) so a moved console
+    // is followed without a restart; changes and failures are counted in GetStats()
+    void SetResolveInterval(unsigned int intervalMs);
+
+    // Largest UDP datagram to send (default 65507); bigger events are truncated with a marker or split
+    // into "[i/n]" chunk events. 1472 keeps Ethernet paths free of IP fragmentation.
+    void SetMaxDatagramSize(std::size_t bytes, LogOversizePolicy policy = LogOversizePolicy::Truncate);
+
+    // Maximum number of events kept while the transport is not ready yet (default 1024, 0 = drop)
+    void SetStartupBufferSize(std::size_t maxEvents);
+
+    // Format and send events on this many worker threads (0 = on the calling thread, default), so
+    // a log call only queues a copy of the event. Each thread's events keep their order within
+    // a severity class.
+    void SetFormattingWorkers(std::size_t workers);
+
+    // When formatting workers send the events they collected (default: adaptive batches of up to
+    // 64 events or 64 KB, at most 100 us late). Events at or above policy.flushLevel are sent
+    // before the log call returns, together with everything their thread queued before them.
+    void SetFlushPolicy(const LogFlushPolicy& policy);
+
+    // Queues of the formatting workers per severity class (TRACE/DEBUG, INFO/WARN, ERROR/FATAL),
+    // each with its own capacity, overflow policy and drain weight. By default a full debug queue
+    // sheds new events while info and error events wait, and errors are drained 16:4:1 ahead.
+    // Events of one thread keep their order within a class; across classes, errors may overtake.
+    void SetPriorityLanes(const LogPriorityLanes& lanes);
+
+    // Waits until events queued for the formatting workers were sent
+    void Flush();
+
+    // CPU affinity and priority of the logger's background threads (formatting workers, reconnect
+    // and maintenance threads) and the wait strategy of idle formatting workers. Returns false if
+    // this process may not apply them (the parts that are permitted still apply).
+    bool SetBackendThreadOptions(const LogThreadOptions& options);
+
+    // Events below this level are discarded before formatting (default L_TRACE)
+    void SetMinimumLevel(LogLevel level);
+
+    // Minimum level of one category, above or below SetMinimumLevel, e.g. DEBUG for one category
+    // during an incident. Events at or above every category's level are not looked up at all.
+    void SetCategoryLevel(const std::string& category, LogLevel level);
+    void ClearCategoryLevel(const std::string& category);
+
+    // Applies a configuration file (see Log2ConsoleSettings.h) with the LTC_* environment variables
+    // on top as one new snapshot; a file with errors is rejected as a whole. With watch, the file is
+    // applied again whenever it changes. Results are reported to "Log2Console.Config". The first
+    // GetInstance() applies the environment and the file named by LTC_CONFIG by itself.
+    bool LoadConfiguration(const std::string& path, bool watch = true);
+
+    // Load shedding - under pressure (queue depth, send errors, time spent logging) the minimum
+    // level of the busiest categories is raised step by step up to options.maxLevel, and lowered
+    // again once the pressure has subsided. Every change is logged to "Log2Console.Shedding".
+    // Disabling it restores all levels at once.
+    void SetLoadShedding(const LogSheddingOptions& options);
+
+    // Select the clock used for event timestamps (returns false if unsupported on this platform or
+    // CPU). Tsc is re-anchored to the system clock once a second by the maintenance thread.
+    bool SetClockSource(ClockSource source);
+
     // Token-based logging to reduce repetition - only logs when message changes
-    void LogToken(const std::string& tokenId, LogLevel level, const std::string& category, const std::string& message);
-    void LogTokenWithLocation(const std::string& tokenId, LogLevel level, const std::string& category, const std::string& message,
+    void LogToken(const std::string& tokenId, LogLevel level, LogStringRef category, LogStringRef message);
+    void LogTokenWithLocation(const std::string& tokenId, LogLevel level, LogStringRef category, LogStringRef message,
                              const char* file, const char* function, int line);
 
     // Token-based printf-style log methods
     template<typename T>
-    void LogToken(const std::string& tokenId, LogLevel level, const std::string& category, const std::string& format, T value);
+    void LogToken(const std::string& tokenId, LogLevel level, LogStringRef category, LogStringRef format, T value);
     
     template<typename T>
-    void LogTokenWithLocation(const std::string& tokenId, LogLevel level, const std::string& category, const std::string& format, T value,
+    void LogTokenWithLocation(const std::string& tokenId, LogLevel level, LogStringRef category, LogStringRef format, T value,
                              const char* file, const char* function, int line);
 
     template<typename T1, typename T2>
-    void LogToken(const std::string& tokenId, LogLevel level, const std::string& category, const std::string& format, T1 value1, T2 value2);
+    void LogToken(const std::string& tokenId, LogLevel level, LogStringRef category, LogStringRef format, T1 value1, T2 value2);
     
     template<typename T1, typename T2>
-    void LogTokenWithLocation(const std::string& tokenId, LogLevel level, const std::string& category, const std::string& format, T1 value1, T2 value2,
+    void LogTokenWithLocation(const std::string& tokenId, LogLevel level, LogStringRef category, LogStringRef format, T1 value1, T2 value2,
                              const char* file, const char* function, int line);
 
     template<typename T1, typename T2, typename T3>
-    void LogToken(const std::string& tokenId, LogLevel level, const std::string& category, const std::string& format, T1 value1, T2 value2, T3 value3);
+    void LogToken(const std::string& tokenId, LogLevel level, LogStringRef category, LogStringRef format, T1 value1, T2 value2, T3 value3);
     
     template<typename T1, typename T2, typename T3>
-    void LogTokenWithLocation(const std::string& tokenId, LogLevel level, const std::string& category, const std::string& format, T1 value1, T2 value2, T3 value3,
+    void LogTokenWithLocation(const std::string& tokenId, LogLevel level, LogStringRef category, LogStringRef format, T1 value1, T2 value2, T3 value3,
                              const char* file, const char* function, int line);
 
+    // Automatic repeated-message collapsing - consecutive identical events from the same
+    // callsite within the window are suppressed and reported as one "repeated" event
+    void SetRepeatCollapsing(bool enabled, unsigned int windowMs = 1000);
+    void FlushRepeats();
+
+    // Snapshot of the internal counters and latency histograms
+    LogStatsSnapshot GetStats() const;
+
+    // Events, bytes, errors and failovers per destination (empty while not initialized)
+    std::vector<DestinationStats> GetDestinationStats() const;
+
+    // Periodically send the stats snapshot as an event to the "Log2Console.Stats" category (0 = off)
+    void SetStatsReportInterval(unsigned int intervalMs);
+
+    // Top-talker attribution - callsites or categories sorted by emitted bytes
+    std::vector<EmitterStats> GetTopEmitters(EmitterKind kind, std::size_t count) const;
+
+    // Dump the top-talker report to stderr and the "Log2Console.TopTalkers" category when the
+    // signal is received (e.g. SIGUSR2); the dump itself runs on the maintenance thread
+    void EnableTopTalkerDumpOnSignal(int signalNumber, std::size_t count = 20);
+
+    // Scoped timing - one site per LTC_SCOPE_TIMER callsite, reported as one aggregated event
+    // (count, min, p50, p99, max) per interval through the regular output (0 = off)
+    ScopeTimerSite& RegisterScopeTimer(const std::string& category, const std::string& name,
+                                       const char* file, const char* function, int line);
+    void SetScopeTimerReportInterval(unsigned int intervalMs);
+
+    // Log-derived metrics - LTC_COUNTER / LTC_GAUGE aggregate in process and are flushed as one
+    // event per category and interval with the values as log4j:data properties (0 = off)
+    MetricSite& RegisterMetric(const std::string& category, const std::string& name, MetricKind kind);
+    void SetMetricsFlushInterval(unsigned int intervalMs);
+
+    // Stream the begin/end of every scope timer to a Chrome/Perfetto trace-event JSON file
+    bool StartSpanRecording(const std::string& path);
+    void StopSpanRecording();
+
+    // The message text Log would build for a format and its values, without logging it
+    template<typename... Args>
+    static std::string FormatMessage(LogStringRef format, const Args&... args);
+
+    // One value rendered as a "{specifier}" placeholder would render it
+    template<typename T>
+    static std::string FormatValue(const T& value, LogStringRef specifier);
+
 private:
     Logger() = default;
-    ~Logger() = default;
+    ~Logger();
 
     // Delete copy and move constructors/operators
     Logger(const Logger&) = delete;
@@ -85,35 +220,264 @@ private:
     Logger(Logger&&) = delete;
     Logger& operator=(Logger&&) = delete;
 
-    // Helper functions for fmt::format style formatting
-    template<typename T>
-    static std::string FormatValue(T value, const std::string& specifier);
-    
+    // Helper functions for fmt::format style formatting. The message is appended to the caller's
+    // (pooled) buffer; integers, floating point values and strings are rendered without a stream,
+    // any other type through its operator<< as before.
     template<typename... Args>
-    static std::string FormatMessage(const std::string& format, Args... args);
-    
-    template<typename Tuple>
-    static std::string GetFormattedValueByIndex(const Tuple& tuple, int index, const std::string& specifier);
-    
-    template<typename Tuple, std::size_t... Is>
-    static std::string GetFormattedValueByIndexImpl(const Tuple& tuple, int index, const std::string& specifier, std::index_sequence<Is...>);
-    
-    // C++14 compatibility helpers
+    static void AppendMessage(std::string& out, LogStringRef format, const Args&... args);
+
+    // Substitutes the next "{...}" at or after position with value, then the rest with the remaining values
+    static void AppendPlaceholders(std::string&, LogStringRef, std::size_t&) {}
+    template<typename T, typename... Rest>
+    static void AppendPlaceholders(std::string& out, LogStringRef format, std::size_t& position,
+                                   const T& value, const Rest&... rest);
+
+    // Value rendering, dispatched on the kind of the value type
+    enum class ValueKind {
+        Signed,
+        Unsigned,
+        Floating,
+        String,
+        Streamed
+    };
+    template<ValueKind kind>
+    using ValueKindTag = std::integral_constant<ValueKind, kind>;
+    template<typename T>
+    static constexpr ValueKind KindOf();
+
+    template<typename T>
+    static void AppendValue(std::string& out, const T& value, LogStringRef specifier);
+    template<typename T>
+    static void AppendValue(std::string& out, const T& value, LogStringRef specifier, ValueKindTag<ValueKind::Signed>);
     template<typename T>
-    static void FormatHex(std::ostringstream& oss, T value, bool uppercase, bool prefix, std::true_type);
+    static void AppendValue(std::string& out, const T& value, LogStringRef specifier, ValueKindTag<ValueKind::Unsigned>);
     template<typename T>
-    static void FormatHex(std::ostringstream& oss, T value, bool uppercase, bool prefix, std::false_type);
+    static void AppendValue(std::string& out, const T& value, LogStringRef specifier, ValueKindTag<ValueKind::Floating>);
     template<typename T>
-    static void FormatPrecision(std::ostringstream& oss, T value, const std::string& specifier, std::true_type);
+    static void AppendValue(std::string& out, const T& value, LogStringRef specifier, ValueKindTag<ValueKind::String>);
     template<typename T>
-    static void FormatPrecision(std::ostringstream& oss, T value, const std::string& specifier, std::false_type);
+    static void AppendValue(std::string& out, const T& value, LogStringRef specifier, ValueKindTag<ValueKind::Streamed>);
 
-    std::unique_ptr<Log2ConsoleUdpClient> m_client;
-    mutable std::mutex m_mutex;
-    bool m_initialized = false;
+    // Specifier parsing shared by all kinds: {x} {X} {#x} {#X} and {:.N}
+    static bool IsHexSpecifier(LogStringRef specifier, bool& uppercase, bool& prefix);
+    static bool ParsePrecision(LogStringRef specifier, int& precision);
+    static void AppendFloating(std::string& out, double value, LogStringRef specifier);
     
+    // C++14 compatibility helpers for the streamed kind
+    template<typename T>
+    static void FormatHex(std::ostringstream& oss, const T& value, bool uppercase, bool prefix, std::true_type);
+    template<typename T>
+    static void FormatHex(std::ostringstream& oss, const T& value, bool uppercase, bool prefix, std::false_type);
+    template<typename T>
+    static void FormatPrecision(std::ostringstream& oss, const T& value, LogStringRef specifier, std::true_type);
+    template<typename T>
+    static void FormatPrecision(std::ostringstream& oss, const T& value, LogStringRef specifier, std::false_type);
+
+    // Immutable configuration snapshot. Log calls read it with a single atomic load inside a
+    // LogRcu read section and never lock; writers (serialized by m_mutex) publish a modified
+    // copy and free the previous one, and with it possibly the old transport, after readers drained.
+    struct Config {
+        std::shared_ptr<Log2ConsoleUdpClient> client;
+        std::vector<LogDestination> destinations;
+        LogDistribution distribution = LogDistribution::ShardByCategory;
+        LogLevel minimumLevel = LogLevel::L_TRACE;
+
+        // Per-category levels, defaulting to minimumLevel (nullptr: none), and the lowest and
+        // highest level of all categories; only levels in between need a lookup
+        std::shared_ptr<const LogCategoryLevels> categoryLevels;
+        LogLevel lowestLevel = LogLevel::L_TRACE;
+        LogLevel highestLevel = LogLevel::L_TRACE;
+        bool collapseRepeats = false;
+        std::chrono::milliseconds collapseWindow{1000};
+        std::size_t startupBufferSize = 1024;
+        unsigned int resolveIntervalMs = 0;
+        std::size_t maxDatagramSize = 65507;
+        LogOversizePolicy oversizePolicy = LogOversizePolicy::Truncate;
+        std::size_t formattingWorkers = 0;
+        LogThreadOptions threadOptions;
+        LogFlushPolicy flushPolicy;
+        LogPriorityLanes priorityLanes;
+
+        // Levels raised by load shedding (nullptr: none)
+        std::shared_ptr<const LogCategoryLevels> shedLevels;
+    };
+
+    // Client for the given destination with the per-client settings of the snapshot applied
+    static std::shared_ptr<Log2ConsoleUdpClient> CreateClient(const Config& config,
+                                                              const std::vector<LogDestination>& destinations,
+                                                              LogDistribution distribution, bool useXmlFormat);
+
+    // Applies the per-client settings that differ between two snapshots to a running client
+    static void UpdateClient(const Config& previous, const Config& config, Log2ConsoleUdpClient& client);
+
+    // Sets the minimum level and the per-category levels of a snapshot
+    static void SetLevels(Config& config, LogLevel minimumLevel,
+                          const std::vector<std::pair<std::string, LogLevel>>& categoryLevels);
+    static std::vector<std::pair<std::string, LogLevel>> GetCategoryLevels(const Config& config);
+
+    std::atomic<const Config*> m_config{nullptr};
+    mutable std::mutex m_mutex;
+
+    // Snapshot for a log call (read section must be held); nullptr if the event is filtered or dropped
+    const Config* AcquireConfig(LogLevel level, LogStringRef category) const;
+
+    // Copy of the current snapshot and publication of a replacement (m_mutex must be held)
+    Config CopyConfigLocked() const;
+    void PublishConfigLocked(std::unique_ptr<Config> config);
+
+    // Publishes a snapshot whose destinations may have changed, connecting a new client for them
+    // first; the current snapshot stays if that fails. With the same destinations the running
+    // client takes the snapshot's other settings instead.
+    bool PublishDestinationsLocked(std::unique_ptr<Config> config, bool useXmlFormat);
+    static bool HasSameDestinations(const Config& current, const Config& config);
+
+    // What a configuration changes outside the snapshot, committed only once the snapshot is published
+    struct SettingsCommit {
+        std::vector<std::string> configCategories;
+        bool shedding = false;
+        LogSheddingOptions sheddingOptions;
+    };
+
+    // Configuration from file and environment (m_mutex must be held). ApplySettingsLocked changes
+    // the snapshot fields only; the loader publishes them together with new destinations, if any,
+    // and then calls CommitSettingsLocked. A rejected configuration leaves no trace.
+    void ApplySettingsLocked(Config& config, const LogSettings& settings, SettingsCommit& commit);
+    void CommitSettingsLocked(const SettingsCommit& commit);
+    void ApplySheddingLocked(Config& config, const LogSheddingOptions& options);
+    void CommitSheddingLocked(const LogSheddingOptions& options);
+    bool LoadConfigurationLocked(const std::string& path, const std::string& text);
+    void ReportConfigurationLocked(const std::string& path, const std::vector<std::string>& errors);
+
+    LogFileWatcher m_configWatcher;
+    std::string m_configText;   // last text applied or rejected as invalid, skipped when read again
+
+    // A watched file rejected because its destinations could not be set up is tried again
+    bool m_configRetryPending = false;
+    std::chrono::steady_clock::time_point m_nextConfigRetry;
+
+    // Categories whose level the configuration set; SetCategoryLevel() and ClearCategoryLevel() take
+    // a category over (m_mutex must be held)
+    std::vector<std::string> m_configCategories;
+    void ReleaseConfigCategoryLocked(const std::string& category);
+
+    // Default initialization on first use, resolving and connecting off the calling thread
+    bool StartDefaultInitialization();
+    void InitializeInBackground(std::shared_ptr<Log2ConsoleUdpClient> client);
+    void StartBackgroundInitializationLocked(std::shared_ptr<Log2ConsoleUdpClient> client);
+    void StopBackgroundInitialization();   // m_mutex must be held, except in the destructor
+
+    std::thread m_initThread;
+    std::mutex m_initMutex;
+    std::condition_variable m_initCondition;
+    bool m_initStop = false;
+
     // Token-based logging storage
+    std::mutex m_tokenMutex;
     std::unordered_map<std::string, std::size_t> m_tokenHashes;
+
+    // Records the message for the token; true if it is unchanged and must be suppressed
+    bool IsTokenRepeat(const std::string& tokenId, LogStringRef message);
+
+    // Repeat collapsing storage, keyed on callsite and category
+    struct RepeatKey {
+        const char* file;
+        int line;
+        std::size_t categoryHash;
+        bool operator==(const RepeatKey& other) const {
+            return file == other.file && line == other.line && categoryHash == other.categoryHash;
+        }
+    };
+    struct RepeatKeyHash {
+        std::size_t operator()(const RepeatKey& key) const {
+            return std::hash<const void*>{}(key.file) ^ (key.categoryHash + 0x9e3779b9u + (static_cast<std::size_t>(key.line) << 6));
+        }
+    };
+    struct RepeatState {
+        std::size_t messageHash;
+        LogLevel level;
+        std::string category;
+        std::string message;
+        const char* function;
+        std::chrono::steady_clock::time_point windowStart;
+        std::chrono::steady_clock::time_point lastSeen;
+        unsigned long count;
+    };
+    std::mutex m_repeatMutex;
+    std::chrono::steady_clock::time_point m_nextRepeatSweep;
+    std::unordered_map<RepeatKey, RepeatState, RepeatKeyHash> m_repeats;
+
+    // Sends an event to the snapshot's client, applying repeat collapsing if enabled. An event the
+    // client waits for (at or above the flush level) releases the caller's read guard first, so
+    // that wait never holds up a snapshot writer in LogRcu::Synchronize().
+    void Write(LogRcu::ReadGuard& guard, const Config& config, LogLevel level, LogStringRef category,
+               LogStringRef message, const char* file, const char* function, int line,
+               LogFieldList fields = LogFieldList());
+
+    // Collapsed repeats to report, taken under m_repeatMutex and sent after releasing it so that
+    // logging threads never send while holding the lock
+    struct RepeatSummary {
+        LogLevel level;
+        std::string category;
+        std::string message;
+        const char* file;
+        const char* function;
+        int line;
+        unsigned long count;
+        long long elapsedMs;
+    };
+
+    // Repeat state helpers (m_repeatMutex must be held)
+    void TakeRepeatSummaryLocked(const RepeatKey& key, RepeatState& state, std::vector<RepeatSummary>& summaries);
+    void SweepRepeatsLocked(std::chrono::milliseconds window, std::chrono::steady_clock::time_point now,
+                            bool flushAll, std::vector<RepeatSummary>& summaries);
+
+    // Sweeps under m_repeatMutex, then sends the summaries
+    void SweepRepeats(const Config& config, bool flushAll);
+    static void SendRepeatSummaries(Log2ConsoleUdpClient& client, const std::vector<RepeatSummary>& summaries);
+
+    // Follows a published change of the repeat collapsing settings (m_mutex must be held)
+    void RestartRepeatCollapsingLocked();
+
+    // Background maintenance thread for periodic work (stats report, repeat sweeping). It decides
+    // what is due under m_mutex and does the work after releasing it, so setters never wait for it.
+    void StartMaintenanceLocked();
+    void StopMaintenance();
+    void MaintenanceLoop();
+    void PollConfigurationFile();
+    static void ReportStats(Log2ConsoleUdpClient& client);
+
+    // Report sites are copied under m_mutex; m_reportMutex (taken after m_mutex, if at all)
+    // keeps two reports from taking the same summaries
+    void ReportScopeTimers(Log2ConsoleUdpClient& client, const std::vector<ScopeTimerSite*>& sites);
+    void FlushMetrics(Log2ConsoleUdpClient& client, const std::vector<MetricSite*>& sites);
+    std::mutex m_reportMutex;
+
+    // Samples the load, publishes changed shed levels under m_mutex and reports them
+    void UpdateShedding(const std::shared_ptr<Log2ConsoleUdpClient>& client);
+
+    std::thread m_maintenanceThread;
+    std::mutex m_maintenanceMutex;
+    std::condition_variable m_maintenanceCondition;
+    bool m_maintenanceStop = false;
+    std::chrono::milliseconds m_statsReportInterval{0};
+    std::chrono::steady_clock::time_point m_nextStatsReport;
+    std::size_t m_topTalkerDumpCount = 20;
+
+    // Scope timer sites are never deleted so timers still running during shutdown stay valid
+    std::vector<ScopeTimerSite*> m_scopeTimerSites;
+    std::chrono::milliseconds m_scopeTimerInterval{10000};
+    std::chrono::steady_clock::time_point m_nextScopeTimerReport;
+
+    // Metric sites, indexed by their id and looked up by category and name
+    std::vector<MetricSite*> m_metricSites;
+    std::unordered_map<std::string, MetricSite*> m_metricsByName;
+    std::chrono::milliseconds m_metricsFlushInterval{10000};
+    std::chrono::steady_clock::time_point m_nextMetricsFlush;
+
+    // Load shedding state (m_mutex)
+    LogSheddingOptions m_sheddingOptions;
+    LogLoadShedder m_shedder;
+    std::chrono::steady_clock::time_point m_nextSheddingCheck;
 };
 
 // Convenience macros for logging with automatic file/function/line info
@@ -135,6 +499,55 @@ private:
 #define LTC_FATAL(category, message) \
     Logger::GetInstance().LogWithLocation(LogLevel::L_FATAL, category, message, __FILE__, __FUNCTION__, __LINE__)
 
+// Structured logging macros - fields are {"name", value} pairs, e.g.
+// LTC_INFO_KV("Orders", "Order filled", {"orderId", id}, {"latencyUs", us});
+#define LTC_TRACE_KV(category, message, ...) \
+    Logger::GetInstance().LogFieldsWithLocation(LogLevel::L_TRACE, category, message, {__VA_ARGS__}, __FILE__, __FUNCTION__, __LINE__)
+
+#define LTC_DEBUG_KV(category, message, ...) \
+    Logger::GetInstance().LogFieldsWithLocation(LogLevel::L_DEBUG, category, message, {__VA_ARGS__}, __FILE__, __FUNCTION__, __LINE__)
+
+#define LTC_INFO_KV(category, message, ...) \
+    Logger::GetInstance().LogFieldsWithLocation(LogLevel::L_INFO, category, message, {__VA_ARGS__}, __FILE__, __FUNCTION__, __LINE__)
+
+#define LTC_WARN_KV(category, message, ...) \
+    Logger::GetInstance().LogFieldsWithLocation(LogLevel::L_WARN, category, message, {__VA_ARGS__}, __FILE__, __FUNCTION__, __LINE__)
+
+#define LTC_ERROR_KV(category, message, ...) \
+    Logger::GetInstance().LogFieldsWithLocation(LogLevel::L_ERROR, category, message, {__VA_ARGS__}, __FILE__, __FUNCTION__, __LINE__)
+
+#define LTC_FATAL_KV(category, message, ...) \
+    Logger::GetInstance().LogFieldsWithLocation(LogLevel::L_FATAL, category, message, {__VA_ARGS__}, __FILE__, __FUNCTION__, __LINE__)
+
+
+// Scoped timing macro - records the duration of the enclosing scope into a per-callsite histogram
+#define LTC_CONCAT_IMPL(a, b) a##b
+#define LTC_CONCAT(a, b) LTC_CONCAT_IMPL(a, b)
+
+#define LTC_SCOPE_TIMER(category, name) \
+    static ScopeTimerSite& LTC_CONCAT(ltcScopeTimerSite_, __LINE__) = \
+        Logger::GetInstance().RegisterScopeTimer(category, name, __FILE__, __FUNCTION__, __LINE__); \
+    ScopeTimer LTC_CONCAT(ltcScopeTimer_, __LINE__)(LTC_CONCAT(ltcScopeTimerSite_, __LINE__))
+
+
+// Mapped diagnostic context for the rest of the enclosing scope
+#define LTC_CONTEXT(name, value) \
+    LogContextGuard LTC_CONCAT(ltcContextGuard_, __LINE__)(LogField(name, value))
+
+
+// Log-derived metrics - aggregated in process and flushed periodically as one event per category
+#define LTC_COUNTER(category, name, delta) \
+    do { \
+        static MetricSite& ltcMetricSite = Logger::GetInstance().RegisterMetric(category, name, MetricKind::Counter); \
+        ltcMetricSite.Add(delta); \
+    } while (0)
+
+#define LTC_GAUGE(category, name, value) \
+    do { \
+        static MetricSite& ltcMetricSite = Logger::GetInstance().RegisterMetric(category, name, MetricKind::Gauge); \
+        ltcMetricSite.Set(value); \
+    } while (0)
+
 
 // Printf-style macros with automatic file/function/line info
 #define LTC_TRACE_F1(category, format, value) \
@@ -284,108 +697,209 @@ private:
 #include <sstream>
 #include <iomanip>
 #include <type_traits>
-#include <tuple>
 #include <utility>
 #include <functional>
 
 template<typename T>
-void Logger::Log(LogLevel level, const std::string& category, const std::string& format, T value) {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    
-    if (!m_initialized || !m_client) {
+void Logger::Log(LogLevel level, LogStringRef category, LogStringRef format, T value) {
+    LogStats::CallTimer timer;
+    LogRcu::ReadGuard guard;
+
+    const Config* config = AcquireConfig(level, category);
+    if (!config) {
         return;
     }
 
-    std::string message = FormatMessage(format, value);
-    m_client->Log(level, category, message);
+    LogBuffer message;
+    AppendMessage(*message, format, value);
+    Write(guard, *config, level, category, *message, nullptr, nullptr, 0);
 }
 
 template<typename T>
-void Logger::LogWithLocation(LogLevel level, const std::string& category, const std::string& format, T value,
+void Logger::LogWithLocation(LogLevel level, LogStringRef category, LogStringRef format, T value,
                             const char* file, const char* function, int line) {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    
-    if (!m_initialized || !m_client) {
+    LogStats::CallTimer timer;
+    LogRcu::ReadGuard guard;
+
+    const Config* config = AcquireConfig(level, category);
+    if (!config) {
         return;
     }
 
-    std::string message = FormatMessage(format, value);
-    m_client->Log(level, category, message, file, function, line);
+    LogBuffer message;
+    AppendMessage(*message, format, value);
+    Write(guard, *config, level, category, *message, file, function, line);
 }
 
 // Template implementations for fmt::format style logging with two parameters
 template<typename T1, typename T2>
-void Logger::Log(LogLevel level, const std::string& category, const std::string& format, T1 value1, T2 value2) {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    
-    if (!m_initialized || !m_client) {
+void Logger::Log(LogLevel level, LogStringRef category, LogStringRef format, T1 value1, T2 value2) {
+    LogStats::CallTimer timer;
+    LogRcu::ReadGuard guard;
+
+    const Config* config = AcquireConfig(level, category);
+    if (!config) {
         return;
     }
 
-    std::string message = FormatMessage(format, value1, value2);
-    m_client->Log(level, category, message);
+    LogBuffer message;
+    AppendMessage(*message, format, value1, value2);
+    Write(guard, *config, level, category, *message, nullptr, nullptr, 0);
 }
 
 template<typename T1, typename T2>
-void Logger::LogWithLocation(LogLevel level, const std::string& category, const std::string& format, T1 value1, T2 value2,
+void Logger::LogWithLocation(LogLevel level, LogStringRef category, LogStringRef format, T1 value1, T2 value2,
                             const char* file, const char* function, int line) {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    
-    if (!m_initialized || !m_client) {
+    LogStats::CallTimer timer;
+    LogRcu::ReadGuard guard;
+
+    const Config* config = AcquireConfig(level, category);
+    if (!config) {
         return;
     }
 
-    std::string message = FormatMessage(format, value1, value2);
-    m_client->Log(level, category, message, file, function, line);
+    LogBuffer message;
+    AppendMessage(*message, format, value1, value2);
+    Write(guard, *config, level, category, *message, file, function, line);
 }
 
 // Template implementations for fmt::format style logging with three parameters
 template<typename T1, typename T2, typename T3>
-void Logger::Log(LogLevel level, const std::string& category, const std::string& format, T1 value1, T2 value2, T3 value3) {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    
-    if (!m_initialized || !m_client) {
+void Logger::Log(LogLevel level, LogStringRef category, LogStringRef format, T1 value1, T2 value2, T3 value3) {
+    LogStats::CallTimer timer;
+    LogRcu::ReadGuard guard;
+
+    const Config* config = AcquireConfig(level, category);
+    if (!config) {
         return;
     }
 
-    std::string message = FormatMessage(format, value1, value2, value3);
-    m_client->Log(level, category, message);
+    LogBuffer message;
+    AppendMessage(*message, format, value1, value2, value3);
+    Write(guard, *config, level, category, *message, nullptr, nullptr, 0);
 }
 
 template<typename T1, typename T2, typename T3>
-void Logger::LogWithLocation(LogLevel level, const std::string& category, const std::string& format, T1 value1, T2 value2, T3 value3,
+void Logger::LogWithLocation(LogLevel level, LogStringRef category, LogStringRef format, T1 value1, T2 value2, T3 value3,
                             const char* file, const char* function, int line) {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    
-    if (!m_initialized || !m_client) {
+    LogStats::CallTimer timer;
+    LogRcu::ReadGuard guard;
+
+    const Config* config = AcquireConfig(level, category);
+    if (!config) {
         return;
     }
 
-    std::string message = FormatMessage(format, value1, value2, value3);
-    m_client->Log(level, category, message, file, function, line);
+    LogBuffer message;
+    AppendMessage(*message, format, value1, value2, value3);
+    Write(guard, *config, level, category, *message, file, function, line);
 }
 
 // FormatValue helper function implementation
 template<typename T>
-std::string Logger::FormatValue(T value, const std::string& specifier) {
+std::string Logger::FormatValue(const T& value, LogStringRef specifier) {
+    std::string result;
+    AppendValue(result, value, specifier);
+    return result;
+}
+
+// FormatMessage unified helper function implementation
+template<typename... Args>
+std::string Logger::FormatMessage(LogStringRef format, const Args&... args) {
+    std::string message;
+    message.reserve(format.Size() + 16 * sizeof...(args));
+    AppendMessage(message, format, args...);
+    return message;
+}
+
+template<typename... Args>
+void Logger::AppendMessage(std::string& out, LogStringRef format, const Args&... args) {
+    std::size_t position = 0;
+    AppendPlaceholders(out, format, position, args...);
+    out.append(format.Data() + position, format.Size() - position);
+}
+
+template<typename T, typename... Rest>
+void Logger::AppendPlaceholders(std::string& out, LogStringRef format, std::size_t& position,
+                                const T& value, const Rest&... rest) {
+    std::size_t open = format.Find('{', position);
+    std::size_t close = open == std::string::npos ? open : format.Find('}', open);
+    if (close == std::string::npos) {
+        // No placeholder left, the remaining values are not used
+        return;
+    }
+
+    out.append(format.Data() + position, open - position);
+    AppendValue(out, value, format.Substr(open + 1, close - open - 1));
+    position = close + 1;
+    AppendPlaceholders(out, format, position, rest...);
+}
+
+// Characters and bool keep their stream rendering; everything not listed is streamed
+template<typename T>
+constexpr Logger::ValueKind Logger::KindOf() {
+    return std::is_same<T, bool>::value || std::is_same<T, char>::value || std::is_same<T, signed char>::value ||
+               std::is_same<T, unsigned char>::value || std::is_same<T, wchar_t>::value ||
+               std::is_same<T, char16_t>::value || std::is_same<T, char32_t>::value ? ValueKind::Streamed
+         : std::is_integral<T>::value ? (std::is_signed<T>::value ? ValueKind::Signed : ValueKind::Unsigned)
+         : std::is_same<T, float>::value || std::is_same<T, double>::value ? ValueKind::Floating
+         : std::is_convertible<const T&, LogStringRef>::value ? ValueKind::String
+         : ValueKind::Streamed;
+}
+
+template<typename T>
+void Logger::AppendValue(std::string& out, const T& value, LogStringRef specifier) {
+    AppendValue(out, value, specifier, ValueKindTag<KindOf<T>()>());
+}
+
+template<typename T>
+void Logger::AppendValue(std::string& out, const T& value, LogStringRef specifier, ValueKindTag<ValueKind::Signed>) {
+    bool uppercase = false;
+    bool prefix = false;
+    if (IsHexSpecifier(specifier, uppercase, prefix)) {
+        // Two's complement in the width of the type, as std::hex prints negative values
+        using Unsigned = typename std::make_unsigned<T>::type;
+        Log2ConsoleFormatter::AppendHex(out, static_cast<unsigned long long>(static_cast<Unsigned>(value)), uppercase, prefix);
+    } else {
+        Log2ConsoleFormatter::AppendDecimal(out, static_cast<long long>(value));
+    }
+}
+
+template<typename T>
+void Logger::AppendValue(std::string& out, const T& value, LogStringRef specifier, ValueKindTag<ValueKind::Unsigned>) {
+    bool uppercase = false;
+    bool prefix = false;
+    if (IsHexSpecifier(specifier, uppercase, prefix)) {
+        Log2ConsoleFormatter::AppendHex(out, static_cast<unsigned long long>(value), uppercase, prefix);
+    } else {
+        Log2ConsoleFormatter::AppendDecimal(out, static_cast<unsigned long long>(value));
+    }
+}
+
+template<typename T>
+void Logger::AppendValue(std::string& out, const T& value, LogStringRef specifier, ValueKindTag<ValueKind::Floating>) {
+    AppendFloating(out, static_cast<double>(value), specifier);
+}
+
+template<typename T>
+void Logger::AppendValue(std::string& out, const T& value, LogStringRef, ValueKindTag<ValueKind::String>) {
+    LogStringRef text(value);
+    out.append(text.Data(), text.Size());
+}
+
+template<typename T>
+void Logger::AppendValue(std::string& out, const T& value, LogStringRef specifier, ValueKindTag<ValueKind::Streamed>) {
     std::ostringstream oss;
+    bool uppercase = false;
+    bool prefix = false;
     
-    if (specifier.empty()) {
+    if (specifier.Empty()) {
         // Default formatting: {}
         oss << value;
-    } else if (specifier == "x") {
-        // Hexadecimal lowercase: {x}
-        FormatHex(oss, value, false, false, std::is_integral<T>());
-    } else if (specifier == "X") {
-        // Hexadecimal uppercase: {X}
-        FormatHex(oss, value, true, false, std::is_integral<T>());
-    } else if (specifier.substr(0, 2) == "#x") {
-        // Hexadecimal with prefix: {#x}
-        FormatHex(oss, value, false, true, std::is_integral<T>());
-    } else if (specifier.substr(0, 2) == "#X") {
-        // Hexadecimal with prefix uppercase: {#X}
-        FormatHex(oss, value, true, true, std::is_integral<T>());
-    } else if (specifier[0] == ':' && specifier[1] == '.') {
+    } else if (IsHexSpecifier(specifier, uppercase, prefix)) {
+        // Hexadecimal: {x} {X} {#x} {#X}
+        FormatHex(oss, value, uppercase, prefix, std::is_integral<T>());
+    } else if (specifier.StartsWith(":.")) {
         // Precision formatting: {:.4}
         FormatPrecision(oss, value, specifier, std::is_floating_point<T>());
     } else {
@@ -393,54 +907,12 @@ std::string Logger::FormatValue(T value, const std::string& specifier) {
         oss << value;
     }
     
-    return oss.str();
-}
-
-// FormatMessage unified helper function implementation
-template<typename... Args>
-std::string Logger::FormatMessage(const std::string& format, Args... args) {
-    std::string message = format;
-    size_t pos = 0;
-    int replacements = 0;
-    
-    // Pack arguments into a tuple for indexed access
-    auto argTuple = std::make_tuple(args...);
-    constexpr size_t argCount = sizeof...(args);
-    
-    while ((pos = message.find('{', pos)) != std::string::npos && replacements < argCount) {
-        size_t endPos = message.find('}', pos);
-        if (endPos != std::string::npos) {
-            std::string specifier = message.substr(pos + 1, endPos - pos - 1);
-            std::string valueStr = GetFormattedValueByIndex(argTuple, replacements, specifier);
-            message.replace(pos, endPos - pos + 1, valueStr);
-            pos += valueStr.length();
-            replacements++;
-        } else {
-            pos++;
-        }
-    }
-    
-    return message;
-}
-
-// Helper to get formatted value by index from tuple
-template<typename Tuple>
-std::string Logger::GetFormattedValueByIndex(const Tuple& tuple, int index, const std::string& specifier) {
-    return GetFormattedValueByIndexImpl(tuple, index, specifier, std::make_index_sequence<std::tuple_size<Tuple>::value>{});
-}
-
-// Implementation detail for tuple index access  
-template<typename Tuple, std::size_t... Is>
-std::string Logger::GetFormattedValueByIndexImpl(const Tuple& tuple, int index, const std::string& specifier, std::index_sequence<Is...>) {
-    std::string result;
-    auto dummy = {(index == Is ? (result = FormatValue(std::get<Is>(tuple), specifier), 0) : 0)...};
-    (void)dummy; // Suppress unused variable warning
-    return result;
+    out += oss.str();
 }
 
 // C++14 compatibility helper implementations
 template<typename T>
-void Logger::FormatHex(std::ostringstream& oss, T value, bool uppercase, bool prefix, std::true_type) {
+void Logger::FormatHex(std::ostringstream& oss, const T& value, bool uppercase, bool prefix, std::true_type) {
     if (prefix) {
         oss << (uppercase ? "0X" : "0x");
     }
@@ -452,177 +924,147 @@ void Logger::FormatHex(std::ostringstream& oss, T value, bool uppercase, bool pr
 }
 
 template<typename T>
-void Logger::FormatHex(std::ostringstream& oss, T value, bool uppercase, bool prefix, std::false_type) {
+void Logger::FormatHex(std::ostringstream& oss, const T& value, bool uppercase, bool prefix, std::false_type) {
     // Not an integral type, just output as default
     oss << value;
 }
 
 template<typename T>
-void Logger::FormatPrecision(std::ostringstream& oss, T value, const std::string& specifier, std::true_type) {
-    try {
-        int precision = std::stoi(specifier.substr(2));
+void Logger::FormatPrecision(std::ostringstream& oss, const T& value, LogStringRef specifier, std::true_type) {
+    int precision = 0;
+    if (ParsePrecision(specifier, precision)) {
         oss << std::fixed << std::setprecision(precision) << value;
-    } catch (...) {
+    } else {
         oss << value;
     }
 }
 
 template<typename T>
-void Logger::FormatPrecision(std::ostringstream& oss, T value, const std::string& specifier, std::false_type) {
+void Logger::FormatPrecision(std::ostringstream& oss, const T& value, LogStringRef specifier, std::false_type) {
     // Not a floating point type, just output as default
     oss << value;
 }
 
 // Token-based template implementations
 template<typename T>
-void Logger::LogToken(const std::string& tokenId, LogLevel level, const std::string& category, const std::string& format, T value) {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    
-    if (!m_initialized || !m_client) {
+void Logger::LogToken(const std::string& tokenId, LogLevel level, LogStringRef category, LogStringRef format, T value) {
+    LogStats::CallTimer timer;
+    LogRcu::ReadGuard guard;
+
+    const Config* config = AcquireConfig(level, category);
+    if (!config) {
         return;
     }
 
-    std::string message = FormatMessage(format, value);
+    LogBuffer message;
+    AppendMessage(*message, format, value);
     
-    // Calculate hash of the formatted message
-    std::size_t messageHash = std::hash<std::string>{}(message);
-    
-    // Check if we've seen this message for this token before
-    auto it = m_tokenHashes.find(tokenId);
-    if (it != m_tokenHashes.end() && it->second == messageHash) {
-        // Same message, don't log
+    // Only log when the message for this token changed
+    if (IsTokenRepeat(tokenId, *message)) {
         return;
     }
-    
-    // New or different message, update hash and log
-    m_tokenHashes[tokenId] = messageHash;
-    m_client->Log(level, category, message);
+    Write(guard, *config, level, category, *message, nullptr, nullptr, 0);
 }
 
 template<typename T>
-void Logger::LogTokenWithLocation(const std::string& tokenId, LogLevel level, const std::string& category, const std::string& format, T value,
+void Logger::LogTokenWithLocation(const std::string& tokenId, LogLevel level, LogStringRef category, LogStringRef format, T value,
                                  const char* file, const char* function, int line) {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    
-    if (!m_initialized || !m_client) {
+    LogStats::CallTimer timer;
+    LogRcu::ReadGuard guard;
+
+    const Config* config = AcquireConfig(level, category);
+    if (!config) {
         return;
     }
 
-    std::string message = FormatMessage(format, value);
+    LogBuffer message;
+    AppendMessage(*message, format, value);
     
-    // Calculate hash of the formatted message
-    std::size_t messageHash = std::hash<std::string>{}(message);
-    
-    // Check if we've seen this message for this token before
-    auto it = m_tokenHashes.find(tokenId);
-    if (it != m_tokenHashes.end() && it->second == messageHash) {
-        // Same message, don't log
+    // Only log when the message for this token changed
+    if (IsTokenRepeat(tokenId, *message)) {
         return;
     }
-    
-    // New or different message, update hash and log
-    m_tokenHashes[tokenId] = messageHash;
-    m_client->Log(level, category, message, file, function, line);
+    Write(guard, *config, level, category, *message, file, function, line);
 }
 
 template<typename T1, typename T2>
-void Logger::LogToken(const std::string& tokenId, LogLevel level, const std::string& category, const std::string& format, T1 value1, T2 value2) {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    
-    if (!m_initialized || !m_client) {
+void Logger::LogToken(const std::string& tokenId, LogLevel level, LogStringRef category, LogStringRef format, T1 value1, T2 value2) {
+    LogStats::CallTimer timer;
+    LogRcu::ReadGuard guard;
+
+    const Config* config = AcquireConfig(level, category);
+    if (!config) {
         return;
     }
 
-    std::string message = FormatMessage(format, value1, value2);
-    
-    // Calculate hash of the formatted message
-    std::size_t messageHash = std::hash<std::string>{}(message);
+    LogBuffer message;
+    AppendMessage(*message, format, value1, value2);
     
-    // Check if we've seen this message for this token before
-    auto it = m_tokenHashes.find(tokenId);
-    if (it != m_tokenHashes.end() && it->second == messageHash) {
-        // Same message, don't log
+    // Only log when the message for this token changed
+    if (IsTokenRepeat(tokenId, *message)) {
         return;
     }
-    
-    // New or different message, update hash and log
-    m_tokenHashes[tokenId] = messageHash;
-    m_client->Log(level, category, message);
+    Write(guard, *config, level, category, *message, nullptr, nullptr, 0);
 }
 
 template<typename T1, typename T2>
-void Logger::LogTokenWithLocation(const std::string& tokenId, LogLevel level, const std::string& category, const std::string& format, T1 value1, T2 value2,
+void Logger::LogTokenWithLocation(const std::string& tokenId, LogLevel level, LogStringRef category, LogStringRef format, T1 value1, T2 value2,
                                  const char* file, const char* function, int line) {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    
-    if (!m_initialized || !m_client) {
+    LogStats::CallTimer timer;
+    LogRcu::ReadGuard guard;
+
+    const Config* config = AcquireConfig(level, category);
+    if (!config) {
         return;
     }
 
-    std::string message = FormatMessage(format, value1, value2);
-    
-    // Calculate hash of the formatted message
-    std::size_t messageHash = std::hash<std::string>{}(message);
+    LogBuffer message;
+    AppendMessage(*message, format, value1, value2);
     
-    // Check if we've seen this message for this token before
-    auto it = m_tokenHashes.find(tokenId);
-    if (it != m_tokenHashes.end() && it->second == messageHash) {
-        // Same message, don't log
+    // Only log when the message for this token changed
+    if (IsTokenRepeat(tokenId, *message)) {
         return;
     }
-    
-    // New or different message, update hash and log
-    m_tokenHashes[tokenId] = messageHash;
-    m_client->Log(level, category, message, file, function, line);
+    Write(guard, *config, level, category, *message, file, function, line);
 }
 
 template<typename T1, typename T2, typename T3>
-void Logger::LogToken(const std::string& tokenId, LogLevel level, const std::string& category, const std::string& format, T1 value1, T2 value2, T3 value3) {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    
-    if (!m_initialized || !m_client) {
+void Logger::LogToken(const std::string& tokenId, LogLevel level, LogStringRef category, LogStringRef format, T1 value1, T2 value2, T3 value3) {
+    LogStats::CallTimer timer;
+    LogRcu::ReadGuard guard;
+
+    const Config* config = AcquireConfig(level, category);
+    if (!config) {
         return;
     }
 
-    std::string message = FormatMessage(format, value1, value2, value3);
+    LogBuffer message;
+    AppendMessage(*message, format, value1, value2, value3);
     
-    // Calculate hash of the formatted message
-    std::size_t messageHash = std::hash<std::string>{}(message);
-    
-    // Check if we've seen this message for this token before
-    auto it = m_tokenHashes.find(tokenId);
-    if (it != m_tokenHashes.end() && it->second == messageHash) {
-        // Same message, don't log
+    // Only log when the message for this token changed
+    if (IsTokenRepeat(tokenId, *message)) {
         return;
     }
-    
-    // New or different message, update hash and log
-    m_tokenHashes[tokenId] = messageHash;
-    m_client->Log(level, category, message);
+    Write(guard, *config, level, category, *message, nullptr, nullptr, 0);
 }
 
 template<typename T1, typename T2, typename T3>
-void Logger::LogTokenWithLocation(const std::string& tokenId, LogLevel level, const std::string& category, const std::string& format, T1 value1, T2 value2, T3 value3,
+void Logger::LogTokenWithLocation(const std::string& tokenId, LogLevel level, LogStringRef category, LogStringRef format, T1 value1, T2 value2, T3 value3,
                                  const char* file, const char* function, int line) {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    
-    if (!m_initialized || !m_client) {
+    LogStats::CallTimer timer;
+    LogRcu::ReadGuard guard;
+
+    const Config* config = AcquireConfig(level, category);
+    if (!config) {
         return;
     }
 
-    std::string message = FormatMessage(format, value1, value2, value3);
+    LogBuffer message;
+    AppendMessage(*message, format, value1, value2, value3);
     
-    // Calculate hash of the formatted message
-    std::size_t messageHash = std::hash<std::string>{}(message);
-    
-    // Check if we've seen this message for this token before
-    auto it = m_tokenHashes.find(tokenId);
-    if (it != m_tokenHashes.end() && it->second == messageHash) {
-        // Same message, don't log
+    // Only log when the message for this token changed
+    if (IsTokenRepeat(tokenId, *message)) {
         return;
     }
-    
-    // New or different message, update hash and log
-    m_tokenHashes[tokenId] = messageHash;
-    m_client->Log(level, category, message, file, function, line);
+    Write(guard, *config, level, category, *message, file, function, line);
 }
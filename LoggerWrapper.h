@@ -9,7 +9,10 @@
 #else
 
 // Include required headers for mock implementation
+#include "Log2ConsoleStats.h"
+#include "Log2ConsoleUdpClient.h"
 #include <string>
+#include <vector>
 
 // Mock macros that do nothing when logging is disabled
 
@@ -22,6 +25,28 @@
 #define LTC_FATAL(category, message) do { } while(0)
 
 
+// Scoped timing macro - does nothing
+#define LTC_SCOPE_TIMER(category, name) do { } while(0)
+
+
+// Mapped diagnostic context macro - does nothing
+#define LTC_CONTEXT(name, value) do { } while(0)
+
+
+// Structured logging macros - do nothing
+#define LTC_TRACE_KV(category, message, ...) do { } while(0)
+#define LTC_DEBUG_KV(category, message, ...) do { } while(0)
+#define LTC_INFO_KV(category, message, ...) do { } while(0)
+#define LTC_WARN_KV(category, message, ...) do { } while(0)
+#define LTC_ERROR_KV(category, message, ...) do { } while(0)
+#define LTC_FATAL_KV(category, message, ...) do { } while(0)
+
+
+// Log-derived metric macros - do nothing
+#define LTC_COUNTER(category, name, delta) do { } while(0)
+#define LTC_GAUGE(category, name, value) do { } while(0)
+
+
 // Printf-style macros (with file/function/line info) - do nothing
 #define LTC_TRACE_F1(category, format, value) do { } while(0)
 #define LTC_TRACE_F1_POS(category, format, value, file, function, line) do { } while(0)
@@ -96,9 +121,44 @@ namespace LoggerMock {
         }
         
         bool Initialize(const std::string& = "localhost", int = 4445, bool = true) { return true; }
+        bool Initialize(const std::vector<LogDestination>&, LogDistribution = LogDistribution::ShardByCategory,
+                        bool = true) { return true; }
         void Cleanup() { }
         bool IsInitialized() const { return false; }
         void SetXmlFormat(bool) { }
+        void SetStartupBufferSize(std::size_t) { }
+        void SetResolveInterval(unsigned int) { }
+        void SetMaxDatagramSize(std::size_t, LogOversizePolicy = LogOversizePolicy::Truncate) { }
+        void SetFormattingWorkers(std::size_t) { }
+        void SetFlushPolicy(const LogFlushPolicy&) { }
+        void SetPriorityLanes(const LogPriorityLanes&) { }
+        void Flush() { }
+        bool SetBackendThreadOptions(const LogThreadOptions&) { return false; }
+        template<typename T>
+        void SetMinimumLevel(T) { }
+        template<typename T>
+        void SetCategoryLevel(const std::string&, T) { }
+        void ClearCategoryLevel(const std::string&) { }
+        template<typename T>
+        void SetLoadShedding(const T&) { }
+        bool LoadConfiguration(const std::string&, bool = true) { return false; }
+        template<typename T>
+        bool SetClockSource(T) { return false; }
+        void SetRepeatCollapsing(bool, unsigned int = 1000) { }
+        void FlushRepeats() { }
+        LogStatsSnapshot GetStats() const { return LogStatsSnapshot(); }
+        std::vector<DestinationStats> GetDestinationStats() const { return std::vector<DestinationStats>(); }
+        void SetStatsReportInterval(unsigned int) { }
+        std::vector<EmitterStats> GetTopEmitters(EmitterKind, std::size_t) const { return std::vector<EmitterStats>(); }
+        void EnableTopTalkerDumpOnSignal(int, std::size_t = 20) { }
+        void SetScopeTimerReportInterval(unsigned int) { }
+        void SetMetricsFlushInterval(unsigned int) { }
+        bool StartSpanRecording(const std::string&) { return false; }
+
+        struct ContextGuard { };
+        template<typename T>
+        static ContextGuard PushContext(const char*, const T&) { return ContextGuard(); }
+        void StopSpanRecording() { }
         
         // Mock log methods that do nothing
         template<typename... Args>
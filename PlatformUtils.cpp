@@ -21,6 +21,14 @@ unsigned long GetCurrentThreadId() {
 #endif
 }
 
+unsigned long GetCurrentProcessId() {
+#ifdef LTC_PLATFORM_WINDOWS
+    return static_cast<unsigned long>(::GetCurrentProcessId());
+#else
+    return static_cast<unsigned long>(getpid());
+#endif
+}
+
 std::string GetHostName() {
 #ifdef LTC_PLATFORM_WINDOWS
     char buffer[MAX_COMPUTERNAME_LENGTH + 1];
@@ -49,9 +57,11 @@ std::string GetUserName() {
     }
     return "User";
 #else
-    // Linux
-    struct passwd* pw = getpwuid(getuid());
-    if (pw && pw->pw_name) {
+    // Linux: reentrant variant, log calls may format concurrently
+    struct passwd entry;
+    struct passwd* pw = nullptr;
+    char buffer[1024];
+    if (getpwuid_r(getuid(), &entry, buffer, sizeof(buffer), &pw) == 0 && pw && pw->pw_name) {
         return std::string(pw->pw_name);
     }
     return "User";
@@ -27,6 +27,9 @@ namespace PlatformUtils {
     // Get current thread ID
     unsigned long GetCurrentThreadId();
     
+    // Get current process ID
+    unsigned long GetCurrentProcessId();
+    
     // Get hostname
     std::string GetHostName();
     
@@ -9,18 +9,23 @@
     #endif
     #include <winsock2.h>
     #include <ws2tcpip.h>
+    #include <iphlpapi.h>
     #pragma comment(lib, "ws2_32.lib")
+    #pragma comment(lib, "iphlpapi.lib")
     
     typedef SOCKET socket_t;
     #define INVALID_SOCKET_VALUE INVALID_SOCKET
     #define SOCKET_ERROR_VALUE SOCKET_ERROR
     #define closesocket_platform closesocket
+    #define SEND_FLAGS_PLATFORM 0
     
 #else // Linux/Unix
     #include <sys/types.h>
     #include <sys/socket.h>
+    #include <sys/uio.h>
     #include <netinet/in.h>
     #include <arpa/inet.h>
+    #include <net/if.h>
     #include <netdb.h>
     #include <unistd.h>
     #include <errno.h>
@@ -31,6 +36,13 @@
     #define closesocket_platform close
     #define SOCKET_ERROR -1
     #define INVALID_SOCKET -1
+
+    // A peer closing a TCP connection must not raise SIGPIPE in the logging process
+    #ifdef MSG_NOSIGNAL
+        #define SEND_FLAGS_PLATFORM MSG_NOSIGNAL
+    #else
+        #define SEND_FLAGS_PLATFORM 0
+    #endif
 #endif
 
 namespace SocketPlatform {
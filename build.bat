@@ -6,6 +6,7 @@ setlocal enabledelayedexpansion
 REM Default settings
 set BUILD_TYPE=Release
 set BUILD_EXAMPLES=ON
+set BUILD_BENCHMARKS=OFF
 set GENERATOR="Visual Studio 16 2019"
 set SHARED_LIBS=OFF
 
@@ -22,6 +23,11 @@ if /i "%~1"=="--no-examples" (
     shift
     goto parse_args
 )
+if /i "%~1"=="--benchmarks" (
+    set BUILD_BENCHMARKS=ON
+    shift
+    goto parse_args
+)
 if /i "%~1"=="--shared" (
     set SHARED_LIBS=ON
     shift
@@ -37,6 +43,7 @@ if /i "%~1"=="--help" (
     echo Options:
     echo   --debug        Build in debug mode
     echo   --no-examples  Don't build example programs
+    echo   --benchmarks   Build benchmark programs
     echo   --shared       Build shared library instead of static
     echo   --vs2022       Use Visual Studio 2022 generator
     echo   --help         Show this help message
@@ -56,6 +63,7 @@ echo Configuring with CMake...
 cmake .. -G %GENERATOR% ^
     -DCMAKE_BUILD_TYPE=%BUILD_TYPE% ^
     -DBUILD_EXAMPLES=%BUILD_EXAMPLES% ^
+    -DBUILD_BENCHMARKS=%BUILD_BENCHMARKS% ^
     -DBUILD_SHARED_LIBS=%SHARED_LIBS%
 
 if errorlevel 1 (
@@ -4,6 +4,7 @@
 # Default build type
 BUILD_TYPE="Release"
 BUILD_EXAMPLES="ON"
+BUILD_BENCHMARKS="OFF"
 
 # Parse command line arguments
 while [[ $# -gt 0 ]]; do
@@ -16,6 +17,10 @@ while [[ $# -gt 0 ]]; do
             BUILD_EXAMPLES="OFF"
             shift
             ;;
+        --benchmarks)
+            BUILD_BENCHMARKS="ON"
+            shift
+            ;;
         --shared)
             BUILD_SHARED="-DBUILD_SHARED_LIBS=ON"
             shift
@@ -25,6 +30,7 @@ while [[ $# -gt 0 ]]; do
             echo "Options:"
             echo "  --debug        Build in debug mode"
             echo "  --no-examples  Don't build example programs"
+            echo "  --benchmarks   Build benchmark programs"
             echo "  --shared       Build shared library instead of static"
             echo "  --help         Show this help message"
             exit 0
@@ -45,6 +51,7 @@ echo "Configuring with CMake..."
 cmake .. \
     -DCMAKE_BUILD_TYPE=${BUILD_TYPE} \
     -DBUILD_EXAMPLES=${BUILD_EXAMPLES} \
+    -DBUILD_BENCHMARKS=${BUILD_BENCHMARKS} \
     ${BUILD_SHARED}
 
 # Build
@@ -0,0 +1,536 @@
+// Microbenchmarks for the Log2Console logging library
+//
+// Reports ns/op and heap allocations/op for the formatting helpers and the end-to-end
+// Logger::Log path. Events are sent to a local UDP sink that drains and discards them.
+// With --require-zero-alloc the run fails if a steady-state log call allocated at all.
+// The caller-latency section times single paced Logger::Log calls with formatting workers under
+// each wait strategy and reports percentiles.
+//
+// Usage: log2console_bench [--threads N] [--min-time-ms MS] [--out results.json] [--require-zero-alloc]
+//                          [--latency-events N]
+
+#include "Logger.h"
+#include "SocketPlatform.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Allocation counting - every operator new in the process is counted
+namespace {
+    std::atomic<std::uint64_t> g_allocations(0);
+}
+
+void* operator new(std::size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return ::operator new(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+namespace {
+
+struct BenchResult {
+    std::string name;
+    int threads;
+    std::uint64_t iterations;
+    std::uint64_t allocations;
+    double nsPerOp;
+    double allocsPerOp;
+    double opsPerSecond;
+};
+
+struct LatencyResult {
+    std::string name;
+    int threads;
+    std::uint64_t count;
+    std::uint64_t p50;
+    std::uint64_t p90;
+    std::uint64_t p99;
+    std::uint64_t p999;
+    std::uint64_t max;
+};
+
+// Local UDP receiver standing in for Log2Console, discards everything it receives
+class UdpSink {
+public:
+    UdpSink() : m_socket(INVALID_SOCKET_VALUE), m_port(0), m_running(false), m_received(0) {}
+
+    ~UdpSink() {
+        Stop();
+    }
+
+    bool Start() {
+        SocketPlatform::Initialize();
+
+        m_socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        if (m_socket == INVALID_SOCKET_VALUE) {
+            return false;
+        }
+
+        struct sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = 0;
+        if (bind(m_socket, (struct sockaddr*)&addr, sizeof(addr)) == SOCKET_ERROR_VALUE) {
+            return false;
+        }
+
+        socklen_t length = sizeof(addr);
+        getsockname(m_socket, (struct sockaddr*)&addr, &length);
+        m_port = ntohs(addr.sin_port);
+
+#ifdef LTC_PLATFORM_WINDOWS
+        DWORD timeout = 100;
+        setsockopt(m_socket, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
+#else
+        struct timeval timeout{0, 100000};
+        setsockopt(m_socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+#endif
+
+        m_running = true;
+        m_thread = std::thread([this]() {
+            std::vector<char> buffer(65536);
+            while (m_running) {
+                int result = recv(m_socket, buffer.data(), static_cast<int>(buffer.size()), 0);
+                if (result > 0) {
+                    m_received.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        });
+        return true;
+    }
+
+    void Stop() {
+        m_running = false;
+        if (m_thread.joinable()) {
+            m_thread.join();
+        }
+        if (m_socket != INVALID_SOCKET_VALUE) {
+            closesocket_platform(m_socket);
+            m_socket = INVALID_SOCKET_VALUE;
+            SocketPlatform::Cleanup();
+        }
+    }
+
+    int GetPort() const { return m_port; }
+    std::uint64_t GetReceived() const { return m_received.load(); }
+
+private:
+    socket_t m_socket;
+    int m_port;
+    std::atomic<bool> m_running;
+    std::atomic<std::uint64_t> m_received;
+    std::thread m_thread;
+};
+
+// Runs fn(iterations) on each thread, growing the iteration count until the run takes minTime
+BenchResult RunBenchmark(const std::string& name, int threads, std::chrono::milliseconds minTime,
+                         const std::function<void(std::uint64_t)>& fn) {
+    // Warm up caches, thread-locals and lazily created state
+    fn(100);
+
+    std::uint64_t iterations = 100;
+    for (;;) {
+        std::atomic<int> ready(0);
+        std::atomic<bool> go(false);
+        std::vector<std::thread> workers;
+
+        for (int i = 0; i < threads; i++) {
+            workers.emplace_back([&]() {
+                // Each thread warms its own thread-locals (buffer pool, stats block) before counting starts
+                fn(100);
+                ready.fetch_add(1);
+                while (!go.load()) {
+                    std::this_thread::yield();
+                }
+                fn(iterations);
+            });
+        }
+
+        while (ready.load() < threads) {
+            std::this_thread::yield();
+        }
+
+        std::uint64_t allocationsBefore = g_allocations.load();
+        auto start = std::chrono::steady_clock::now();
+        go.store(true);
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        std::uint64_t allocations = g_allocations.load() - allocationsBefore;
+
+        if (elapsed >= minTime || iterations >= (1ULL << 32)) {
+            double elapsedNs = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+            double totalOps = static_cast<double>(iterations) * threads;
+
+            BenchResult result;
+            result.name = name;
+            result.threads = threads;
+            result.iterations = iterations;
+            result.allocations = allocations;
+            result.nsPerOp = elapsedNs / static_cast<double>(iterations);
+            result.allocsPerOp = static_cast<double>(allocations) / totalOps;
+            result.opsPerSecond = totalOps * 1e9 / elapsedNs;
+            return result;
+        }
+
+        iterations *= 2;
+    }
+}
+
+// Times every call of threads that log one event per interval, so formatting workers go idle between
+// events and have to be woken the way their wait strategy says
+LatencyResult RunLatency(const std::string& name, int threads, std::uint64_t eventsPerThread,
+                         std::chrono::microseconds interval, const std::function<void(std::uint64_t)>& fn) {
+    std::vector<std::vector<std::uint64_t>> samples(static_cast<std::size_t>(threads));
+    std::vector<std::thread> workers;
+
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&, t]() {
+            std::vector<std::uint64_t>& own = samples[static_cast<std::size_t>(t)];
+            own.reserve(eventsPerThread);
+            fn(100);
+
+            auto next = std::chrono::steady_clock::now();
+            for (std::uint64_t i = 0; i < eventsPerThread; i++) {
+                next += interval;
+                std::this_thread::sleep_until(next);
+
+                auto start = std::chrono::steady_clock::now();
+                fn(1);
+                own.push_back(static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - start).count()));
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    std::vector<std::uint64_t> all;
+    for (const auto& own : samples) {
+        all.insert(all.end(), own.begin(), own.end());
+    }
+    std::sort(all.begin(), all.end());
+
+    auto at = [&all](double q) {
+        return all.empty() ? 0 : all[std::min(all.size() - 1, static_cast<std::size_t>(q * static_cast<double>(all.size())))];
+    };
+    LatencyResult result;
+    result.name = name;
+    result.threads = threads;
+    result.count = all.size();
+    result.p50 = at(0.5);
+    result.p90 = at(0.9);
+    result.p99 = at(0.99);
+    result.p999 = at(0.999);
+    result.max = all.empty() ? 0 : all.back();
+    return result;
+}
+
+void PrintLatency(const LatencyResult& result) {
+    std::cout << std::left << std::setw(28) << result.name
+              << std::right << std::setw(4) << result.threads
+              << std::setw(10) << result.count
+              << std::setw(10) << result.p50
+              << std::setw(10) << result.p90
+              << std::setw(10) << result.p99
+              << std::setw(10) << result.p999
+              << std::setw(12) << result.max
+              << std::endl;
+}
+
+void PrintResult(const BenchResult& result) {
+    std::cout << std::left << std::setw(28) << result.name
+              << std::right << std::setw(4) << result.threads
+              << std::setw(14) << result.iterations
+              << std::setw(12) << std::fixed << std::setprecision(1) << result.nsPerOp
+              << std::setw(12) << std::setprecision(2) << result.allocsPerOp
+              << std::setw(16) << std::setprecision(0) << result.opsPerSecond
+              << std::endl;
+}
+
+bool WriteJson(const std::string& path, const std::vector<BenchResult>& results,
+               const std::vector<LatencyResult>& latencies) {
+    std::ofstream out(path);
+    if (!out) {
+        return false;
+    }
+
+    out << "{\n  \"benchmarks\": [\n";
+    for (std::size_t i = 0; i < results.size(); i++) {
+        const BenchResult& r = results[i];
+        out << "    {\"name\": \"" << r.name << "\", \"threads\": " << r.threads
+            << ", \"iterations\": " << r.iterations
+            << ", \"ns_per_op\": " << std::fixed << std::setprecision(2) << r.nsPerOp
+            << ", \"allocs_per_op\": " << r.allocsPerOp
+            << ", \"ops_per_second\": " << std::setprecision(0) << r.opsPerSecond << "}"
+            << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    out << "  ],\n  \"caller_latency_ns\": [\n";
+    for (std::size_t i = 0; i < latencies.size(); i++) {
+        const LatencyResult& r = latencies[i];
+        out << "    {\"name\": \"" << r.name << "\", \"threads\": " << r.threads << ", \"count\": " << r.count
+            << ", \"p50\": " << r.p50 << ", \"p90\": " << r.p90 << ", \"p99\": " << r.p99
+            << ", \"p999\": " << r.p999 << ", \"max\": " << r.max << "}"
+            << (i + 1 < latencies.size() ? ",\n" : "\n");
+    }
+    out << "  ]\n}\n";
+    return true;
+}
+
+// Keeps results alive so the optimizer cannot drop the benchmarked calls
+std::atomic<std::size_t> g_sink(0);
+
+void Consume(const std::string& value) {
+    g_sink.fetch_add(value.size(), std::memory_order_relaxed);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int maxThreads = static_cast<int>(std::thread::hardware_concurrency());
+    if (maxThreads < 1) {
+        maxThreads = 1;
+    }
+    std::chrono::milliseconds minTime(200);
+    std::string outPath = "log2console_bench.json";
+    bool requireZeroAlloc = false;
+    std::uint64_t latencyEvents = 5000;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) {
+            maxThreads = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--min-time-ms" && i + 1 < argc) {
+            minTime = std::chrono::milliseconds(std::max(1, std::atoi(argv[++i])));
+        } else if (arg == "--out" && i + 1 < argc) {
+            outPath = argv[++i];
+        } else if (arg == "--require-zero-alloc") {
+            requireZeroAlloc = true;
+        } else if (arg == "--latency-events" && i + 1 < argc) {
+            latencyEvents = std::strtoull(argv[++i], nullptr, 10);
+        } else {
+            std::cout << "Usage: " << argv[0] << " [--threads N] [--min-time-ms MS] [--out results.json] [--require-zero-alloc]"
+                      << " [--latency-events N]" << std::endl;
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+
+    UdpSink sink;
+    if (!sink.Start()) {
+        std::cerr << "Failed to start local UDP sink" << std::endl;
+        return 1;
+    }
+
+    // GetInstance() auto-initializes with defaults, so reconfigure to point at the sink
+    Logger& logger = Logger::GetInstance();
+    logger.Cleanup();
+    if (!logger.Initialize("127.0.0.1", sink.GetPort(), true)) {
+        std::cerr << "Failed to initialize logger" << std::endl;
+        return 1;
+    }
+
+    const std::string category = "Bench.Category";
+    const std::string message = "Order 4711 accepted for account <ACME & Sons> after 3 retries";
+    const std::string largeMessage(16384, 'x');
+
+    // steadyState cases are the log calls that must not allocate once a thread is warm; cases with
+    // formattingWorkers run with that many formatting threads
+    struct Case {
+        const char* name;
+        std::function<void(std::uint64_t)> fn;
+        bool steadyState;
+        std::size_t formattingWorkers;
+    };
+
+    std::vector<Case> cases = {
+        {"FormatMessage", [](std::uint64_t n) {
+            for (std::uint64_t i = 0; i < n; i++) {
+                Consume(Logger::FormatMessage("value {} hex {#x} pi {:.3}", 42, 255, 3.14159));
+            }
+        }, false, 0},
+        {"FormatValue", [](std::uint64_t n) {
+            const std::string specifier = "#x";
+            for (std::uint64_t i = 0; i < n; i++) {
+                Consume(Logger::FormatValue(123456789, specifier));
+            }
+        }, false, 0},
+        {"EscapeXml", [&](std::uint64_t n) {
+            for (std::uint64_t i = 0; i < n; i++) {
+                Consume(Log2ConsoleFormatter::EscapeXml(message));
+            }
+        }, false, 0},
+        {"FormatLog4jXml", [&](std::uint64_t n) {
+            for (std::uint64_t i = 0; i < n; i++) {
+                Consume(Log2ConsoleFormatter::FormatLog4jXml(LogLevel::L_INFO, category, message));
+            }
+        }, false, 0},
+        {"FormatLog4jXml/location", [&](std::uint64_t n) {
+            for (std::uint64_t i = 0; i < n; i++) {
+                Consume(Log2ConsoleFormatter::FormatLog4jXml(LogLevel::L_INFO, category, message,
+                                                             __FILE__, __FUNCTION__, __LINE__));
+            }
+        }, false, 0},
+        {"FormatPlainText", [&](std::uint64_t n) {
+            for (std::uint64_t i = 0; i < n; i++) {
+                Consume(Log2ConsoleFormatter::FormatPlainText(LogLevel::L_INFO, category, message));
+            }
+        }, false, 0},
+        {"LogToken/suppressed", [&](std::uint64_t n) {
+            for (std::uint64_t i = 0; i < n; i++) {
+                logger.LogToken("bench.token", LogLevel::L_INFO, category, message);
+            }
+        }, true, 0},
+        {"Logger::Log", [&](std::uint64_t n) {
+            for (std::uint64_t i = 0; i < n; i++) {
+                logger.Log(LogLevel::L_INFO, category, message);
+            }
+        }, true, 0},
+        {"Logger::Log/16KiB", [&](std::uint64_t n) {
+            for (std::uint64_t i = 0; i < n; i++) {
+                logger.Log(LogLevel::L_INFO, category, largeMessage);
+            }
+        }, true, 0},
+        {"Logger::Log/literal", [&](std::uint64_t n) {
+            for (std::uint64_t i = 0; i < n; i++) {
+                logger.Log(LogLevel::L_INFO, "Bench.LiteralCategory", "Order accepted for account <ACME & Sons>");
+            }
+        }, true, 0},
+        {"Logger::Log/format", [&](std::uint64_t n) {
+            for (std::uint64_t i = 0; i < n; i++) {
+                logger.Log(LogLevel::L_INFO, category, "Order {} accepted after {} retries at {:.2} ms", i, 3, 0.25);
+            }
+        }, true, 0},
+        // Includes waiting for the workers, so it is throughput rather than caller latency; queues
+        // grow with the burst size, hence not steady state
+        {"Logger::Log/workers", [&](std::uint64_t n) {
+            for (std::uint64_t i = 0; i < n; i++) {
+                logger.Log(LogLevel::L_INFO, category, message);
+            }
+            logger.Flush();
+        }, false, 2},
+    };
+
+    std::cout << std::left << std::setw(28) << "benchmark"
+              << std::right << std::setw(4) << "thr"
+              << std::setw(14) << "iterations"
+              << std::setw(12) << "ns/op"
+              << std::setw(12) << "allocs/op"
+              << std::setw(16) << "ops/s" << std::endl;
+
+    std::vector<BenchResult> results;
+    std::vector<std::string> allocating;
+    for (const Case& benchCase : cases) {
+        logger.SetFormattingWorkers(benchCase.formattingWorkers);
+        for (int threads = 1; threads <= maxThreads; threads = (threads < maxThreads && threads * 2 > maxThreads) ? maxThreads : threads * 2) {
+            results.push_back(RunBenchmark(benchCase.name, threads, minTime, benchCase.fn));
+            PrintResult(results.back());
+            if (benchCase.steadyState && results.back().allocations > 0) {
+                allocating.push_back(std::string(benchCase.name) + " (" + std::to_string(threads) + " threads, " +
+                                     std::to_string(results.back().allocations) + " allocations)");
+            }
+        }
+    }
+
+    // Caller-latency distribution per wait strategy of two formatting workers, against formatting
+    // on the calling thread; events are paced so the workers idle between them
+    struct LatencyCase {
+        const char* name;
+        std::size_t formattingWorkers;
+        LogWaitStrategy waitStrategy;
+    };
+    const LatencyCase latencyCases[] = {
+        {"latency/synchronous", 0, LogWaitStrategy::Block},
+        {"latency/Block", 2, LogWaitStrategy::Block},
+        {"latency/Yield", 2, LogWaitStrategy::Yield},
+        {"latency/SpinThenPark", 2, LogWaitStrategy::SpinThenPark},
+        {"latency/BusyPoll", 2, LogWaitStrategy::BusyPoll},
+    };
+    const std::chrono::microseconds latencyInterval(50);
+
+    std::vector<LatencyResult> latencies;
+    if (latencyEvents > 0) {
+        std::cout << std::endl << std::left << std::setw(28) << "caller latency (ns)"
+                  << std::right << std::setw(4) << "thr"
+                  << std::setw(10) << "count"
+                  << std::setw(10) << "p50"
+                  << std::setw(10) << "p90"
+                  << std::setw(10) << "p99"
+                  << std::setw(10) << "p99.9"
+                  << std::setw(12) << "max" << std::endl;
+    }
+    for (const LatencyCase& latencyCase : latencyCases) {
+        if (latencyEvents == 0) {
+            break;
+        }
+        LogThreadOptions options;
+        options.waitStrategy = latencyCase.waitStrategy;
+        logger.SetBackendThreadOptions(options);
+        logger.SetFormattingWorkers(latencyCase.formattingWorkers);
+
+        auto fn = [&](std::uint64_t n) {
+            for (std::uint64_t i = 0; i < n; i++) {
+                logger.Log(LogLevel::L_INFO, category, message);
+            }
+        };
+        for (int threads = 1; threads <= maxThreads; threads = (threads < maxThreads && threads * 2 > maxThreads) ? maxThreads : threads * 2) {
+            latencies.push_back(RunLatency(latencyCase.name, threads, latencyEvents, latencyInterval, fn));
+            PrintLatency(latencies.back());
+            logger.Flush();
+        }
+    }
+    logger.SetFormattingWorkers(0);
+    logger.SetBackendThreadOptions(LogThreadOptions());
+
+    logger.Cleanup();
+    sink.Stop();
+
+    if (!WriteJson(outPath, results, latencies)) {
+        std::cerr << "Failed to write " << outPath << std::endl;
+        return 1;
+    }
+
+    std::cout << "Results written to " << outPath << " (" << sink.GetReceived() << " datagrams received)" << std::endl;
+
+    if (requireZeroAlloc && !allocating.empty()) {
+        for (const std::string& name : allocating) {
+            std::cerr << "Steady-state log call allocated: " << name << std::endl;
+        }
+        return 2;
+    }
+    return 0;
+}
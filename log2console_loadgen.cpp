@@ -0,0 +1,177 @@
+// Load generator for the Log2Console logging library
+//
+// Drives Logger::Log from several threads at a target rate with a configurable mix of
+// message sizes. Each message carries its send time ("sent_ns=") so log2console_receiver
+// can report end-to-end latency next to sequence gaps and reordering.
+//
+// Usage: log2console_loadgen [--host H] [--port P] [--threads N] [--rate EVENTS_PER_SEC]
+//                            [--duration SECONDS] [--sizes BYTES:WEIGHT,...] [--plain]
+
+#include "Logger.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct SizeClass {
+    std::size_t bytes;
+    unsigned int weight;
+};
+
+// Parses "64:70,512:25,4096:5" into size classes
+bool ParseSizes(const std::string& text, std::vector<SizeClass>& sizes) {
+    sizes.clear();
+    std::stringstream ss(text);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        std::size_t colon = item.find(':');
+        SizeClass size;
+        size.bytes = static_cast<std::size_t>(std::strtoul(item.substr(0, colon).c_str(), nullptr, 10));
+        size.weight = colon == std::string::npos ? 1 : static_cast<unsigned int>(std::strtoul(item.substr(colon + 1).c_str(), nullptr, 10));
+        if (size.weight == 0) {
+            continue;
+        }
+        sizes.push_back(size);
+    }
+    return !sizes.empty();
+}
+
+std::int64_t NowNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::string host = "127.0.0.1";
+    int port = 4445;
+    int threads = 4;
+    double rate = 10000.0;
+    double durationSeconds = 10.0;
+    bool useXml = true;
+    std::vector<SizeClass> sizes = {{64, 70}, {512, 25}, {4096, 5}};
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--host" && i + 1 < argc) {
+            host = argv[++i];
+        } else if (arg == "--port" && i + 1 < argc) {
+            port = std::atoi(argv[++i]);
+        } else if (arg == "--threads" && i + 1 < argc) {
+            threads = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--rate" && i + 1 < argc) {
+            rate = std::atof(argv[++i]);
+        } else if (arg == "--duration" && i + 1 < argc) {
+            durationSeconds = std::atof(argv[++i]);
+        } else if (arg == "--sizes" && i + 1 < argc) {
+            if (!ParseSizes(argv[++i], sizes)) {
+                std::cerr << "Invalid --sizes, expected BYTES:WEIGHT,..." << std::endl;
+                return 1;
+            }
+        } else if (arg == "--plain") {
+            useXml = false;
+        } else {
+            std::cout << "Usage: " << argv[0] << " [--host H] [--port P] [--threads N] [--rate EVENTS_PER_SEC]\n"
+                      << "       [--duration SECONDS] [--sizes BYTES:WEIGHT,...] [--plain]\n"
+                      << "A rate of 0 sends as fast as possible." << std::endl;
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+
+    // GetInstance() auto-initializes with defaults, so reconfigure to the requested target
+    Logger& logger = Logger::GetInstance();
+    logger.Cleanup();
+    if (!logger.Initialize(host, port, useXml)) {
+        std::cerr << "Failed to initialize logger for " << host << ":" << port << std::endl;
+        return 1;
+    }
+
+    // Pre-build the padding for each size class so the generator itself stays cheap
+    std::vector<std::string> paddings;
+    std::vector<unsigned int> cumulativeWeights;
+    unsigned int totalWeight = 0;
+    for (const SizeClass& size : sizes) {
+        paddings.push_back(std::string(size.bytes, 'x'));
+        totalWeight += size.weight;
+        cumulativeWeights.push_back(totalWeight);
+    }
+
+    std::cout << "Sending to " << host << ":" << port << " with " << threads << " threads at "
+              << (rate > 0 ? std::to_string(static_cast<long long>(rate)) + " events/s" : std::string("max rate"))
+              << " for " << durationSeconds << " s" << std::endl;
+
+    std::atomic<std::uint64_t> totalSent(0);
+    std::atomic<std::uint64_t> totalBytes(0);
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(durationSeconds));
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&, t]() {
+            std::mt19937 random(static_cast<unsigned int>(t * 7919 + 1));
+            std::uniform_int_distribution<unsigned int> pick(0, totalWeight - 1);
+            const std::string category = "LoadGen.Thread" + std::to_string(t);
+
+            // Each thread paces itself to its share of the target rate
+            std::chrono::nanoseconds interval(0);
+            if (rate > 0) {
+                interval = std::chrono::nanoseconds(static_cast<std::int64_t>(1e9 * threads / rate));
+            }
+
+            std::uint64_t sent = 0;
+            std::uint64_t bytes = 0;
+            auto next = std::chrono::steady_clock::now();
+
+            for (;;) {
+                auto now = std::chrono::steady_clock::now();
+                if (now >= deadline) {
+                    break;
+                }
+                if (interval.count() > 0) {
+                    if (now < next) {
+                        // Sleep only when far enough ahead of schedule, spin otherwise
+                        if (next - now > std::chrono::milliseconds(1)) {
+                            std::this_thread::sleep_until(next);
+                        }
+                        continue;
+                    }
+                    next += interval;
+                }
+
+                unsigned int roll = pick(random);
+                std::size_t index = std::upper_bound(cumulativeWeights.begin(), cumulativeWeights.end(), roll) -
+                                    cumulativeWeights.begin();
+                const std::string& padding = paddings[index];
+
+                logger.Log(LogLevel::L_INFO, category, "sent_ns={} {}", NowNanos(), padding);
+                sent++;
+                bytes += padding.size();
+            }
+
+            totalSent.fetch_add(sent);
+            totalBytes.fetch_add(bytes);
+        });
+    }
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    logger.Cleanup();
+
+    std::cout << "Sent " << totalSent.load() << " events (" << totalBytes.load() << " payload bytes) in "
+              << elapsed << " s = " << static_cast<std::uint64_t>(totalSent.load() / elapsed) << " events/s" << std::endl;
+    return 0;
+}
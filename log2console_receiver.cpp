@@ -0,0 +1,245 @@
+// Loss-measuring receiver standing in for Log2Console
+//
+// Receives log4j XML datagrams on a UDP port and reports throughput, sequence gaps (loss)
+// and reordering per sender using nlog:eventSequenceNumber. Messages produced by
+// log2console_loadgen carry "sent_ns=" and additionally yield latency percentiles.
+//
+// Usage: log2console_receiver [--port P] [--rcvbuf BYTES] [--duration SECONDS] [--idle SECONDS]
+
+#include "SocketPlatform.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct SenderStats {
+    std::uint64_t firstSequence = 0;
+    std::uint64_t highestSequence = 0;
+    std::uint64_t received = 0;
+    std::uint64_t gaps = 0;
+    std::uint64_t reordered = 0;
+};
+
+struct Totals {
+    std::uint64_t events = 0;
+    std::uint64_t bytes = 0;
+    std::uint64_t unparsed = 0;
+};
+
+// Returns the unsigned number following marker in text, or false if absent
+bool FindNumber(const char* text, std::size_t length, const char* marker, std::uint64_t& value) {
+    std::size_t markerLength = std::strlen(marker);
+    if (length < markerLength) {
+        return false;
+    }
+    for (std::size_t i = 0; i + markerLength <= length; i++) {
+        if (std::memcmp(text + i, marker, markerLength) == 0) {
+            std::size_t pos = i + markerLength;
+            if (pos >= length || text[pos] < '0' || text[pos] > '9') {
+                return false;
+            }
+            value = 0;
+            while (pos < length && text[pos] >= '0' && text[pos] <= '9') {
+                value = value * 10 + static_cast<std::uint64_t>(text[pos] - '0');
+                pos++;
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+std::int64_t NowNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+double Percentile(const std::vector<std::int64_t>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    std::size_t index = static_cast<std::size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5);
+    return static_cast<double>(sorted[index]) / 1000.0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int port = 4445;
+    int receiveBuffer = 0;
+    double durationSeconds = 0.0;
+    double idleSeconds = 3.0;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--port" && i + 1 < argc) {
+            port = std::atoi(argv[++i]);
+        } else if (arg == "--rcvbuf" && i + 1 < argc) {
+            receiveBuffer = std::atoi(argv[++i]);
+        } else if (arg == "--duration" && i + 1 < argc) {
+            durationSeconds = std::atof(argv[++i]);
+        } else if (arg == "--idle" && i + 1 < argc) {
+            idleSeconds = std::atof(argv[++i]);
+        } else {
+            std::cout << "Usage: " << argv[0] << " [--port P] [--rcvbuf BYTES] [--duration SECONDS] [--idle SECONDS]\n"
+                      << "Stops after --duration seconds (0 = unlimited) or --idle seconds without traffic." << std::endl;
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+
+    SocketPlatform::Initialize();
+
+    socket_t sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock == INVALID_SOCKET_VALUE) {
+        std::cerr << "Failed to create socket" << std::endl;
+        return 1;
+    }
+
+    if (receiveBuffer > 0) {
+        setsockopt(sock, SOL_SOCKET, SO_RCVBUF, (const char*)&receiveBuffer, sizeof(receiveBuffer));
+    }
+
+    struct sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(static_cast<unsigned short>(port));
+    if (bind(sock, (struct sockaddr*)&addr, sizeof(addr)) == SOCKET_ERROR_VALUE) {
+        std::cerr << "Failed to bind UDP port " << port << std::endl;
+        closesocket_platform(sock);
+        return 1;
+    }
+
+#ifdef LTC_PLATFORM_WINDOWS
+    DWORD timeout = 200;
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
+#else
+    struct timeval timeout{0, 200000};
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+#endif
+
+    std::cout << "Listening on UDP port " << port << std::endl;
+
+    std::map<std::string, SenderStats> senders;
+    std::vector<std::int64_t> latencies;
+    latencies.reserve(1 << 20);
+    Totals totals;
+    Totals interval;
+
+    std::vector<char> buffer(65536);
+    auto start = std::chrono::steady_clock::now();
+    auto lastPacket = start;
+    auto lastReport = start;
+    bool receivedAny = false;
+
+    for (;;) {
+        struct sockaddr_in from{};
+        socklen_t fromLength = sizeof(from);
+        int length = recvfrom(sock, buffer.data(), static_cast<int>(buffer.size()), 0,
+                              (struct sockaddr*)&from, &fromLength);
+        std::int64_t receivedAt = NowNanos();
+        auto now = std::chrono::steady_clock::now();
+
+        if (length > 0) {
+            if (!receivedAny) {
+                start = now;
+                lastReport = now;
+                receivedAny = true;
+            }
+            lastPacket = now;
+            totals.events++;
+            totals.bytes += static_cast<std::uint64_t>(length);
+            interval.events++;
+            interval.bytes += static_cast<std::uint64_t>(length);
+
+            std::uint64_t sequence = 0;
+            if (FindNumber(buffer.data(), static_cast<std::size_t>(length), "<nlog:eventSequenceNumber>", sequence)) {
+                char address[64];
+                inet_ntop(AF_INET, &from.sin_addr, address, sizeof(address));
+                std::string key = std::string(address) + ":" + std::to_string(ntohs(from.sin_port));
+
+                SenderStats& stats = senders[key];
+                if (stats.received == 0) {
+                    stats.firstSequence = sequence;
+                    stats.highestSequence = sequence;
+                } else if (sequence > stats.highestSequence) {
+                    if (sequence > stats.highestSequence + 1) {
+                        stats.gaps++;
+                    }
+                    stats.highestSequence = sequence;
+                } else {
+                    stats.reordered++;
+                    stats.firstSequence = std::min(stats.firstSequence, sequence);
+                }
+                stats.received++;
+            } else {
+                totals.unparsed++;
+            }
+
+            std::uint64_t sentAt = 0;
+            if (FindNumber(buffer.data(), static_cast<std::size_t>(length), "sent_ns=", sentAt)) {
+                latencies.push_back(receivedAt - static_cast<std::int64_t>(sentAt));
+            }
+        }
+
+        if (receivedAny && now - lastReport >= std::chrono::seconds(1)) {
+            double seconds = std::chrono::duration<double>(now - lastReport).count();
+            std::cout << std::fixed << std::setprecision(0)
+                      << interval.events / seconds << " events/s, "
+                      << std::setprecision(2) << interval.bytes / seconds / (1024.0 * 1024.0) << " MiB/s" << std::endl;
+            interval = Totals();
+            lastReport = now;
+        }
+
+        if (durationSeconds > 0 && now - start >= std::chrono::duration<double>(durationSeconds)) {
+            break;
+        }
+        if (receivedAny && idleSeconds > 0 && now - lastPacket >= std::chrono::duration<double>(idleSeconds)) {
+            break;
+        }
+    }
+
+    closesocket_platform(sock);
+    SocketPlatform::Cleanup();
+
+    double elapsed = std::chrono::duration<double>(lastPacket - start).count();
+    if (elapsed <= 0) {
+        elapsed = 1e-9;
+    }
+
+    std::cout << std::endl << "Received " << totals.events << " events, " << totals.bytes << " bytes in "
+              << std::fixed << std::setprecision(3) << elapsed << " s ("
+              << std::setprecision(0) << totals.events / elapsed << " events/s)" << std::endl;
+    if (totals.unparsed > 0) {
+        std::cout << "Datagrams without sequence number: " << totals.unparsed << std::endl;
+    }
+
+    for (const auto& entry : senders) {
+        const SenderStats& stats = entry.second;
+        std::uint64_t expected = stats.highestSequence - stats.firstSequence + 1;
+        std::uint64_t lost = expected > stats.received ? expected - stats.received : 0;
+        std::cout << "Sender " << entry.first << ": received " << stats.received
+                  << ", expected " << expected
+                  << ", lost " << lost << " (" << std::setprecision(3) << 100.0 * lost / expected << "%)"
+                  << ", gaps " << stats.gaps
+                  << ", reordered " << stats.reordered << std::endl;
+    }
+
+    if (!latencies.empty()) {
+        std::sort(latencies.begin(), latencies.end());
+        std::cout << "Latency (us): p50 " << std::setprecision(1) << Percentile(latencies, 0.50)
+                  << ", p90 " << Percentile(latencies, 0.90)
+                  << ", p99 " << Percentile(latencies, 0.99)
+                  << ", p99.9 " << Percentile(latencies, 0.999)
+                  << ", max " << static_cast<double>(latencies.back()) / 1000.0 << std::endl;
+    }
+
+    return 0;
+}
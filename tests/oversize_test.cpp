@@ -0,0 +1,216 @@
+// Events above the maximum datagram size: truncation marker, split chunks, and destinations
+// that are exempt from the limit. Sends to sockets on the loopback interface.
+
+#include "Log2ConsoleUdpClient.h"
+#include "SocketPlatform.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace {
+
+int g_failures = 0;
+
+void Check(bool condition, const char* what, int line) {
+    if (!condition) {
+        std::fprintf(stderr, "oversize_test.cpp:%d: check failed: %s\n", line, what);
+        g_failures++;
+    }
+}
+
+#define CHECK(condition) Check((condition), #condition, __LINE__)
+
+void SetReceiveTimeout(socket_t socket, int milliseconds) {
+#ifdef LTC_PLATFORM_WINDOWS
+    DWORD timeout = static_cast<DWORD>(milliseconds);
+#else
+    struct timeval timeout;
+    timeout.tv_sec = milliseconds / 1000;
+    timeout.tv_usec = (milliseconds % 1000) * 1000;
+#endif
+    setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+}
+
+// Socket bound to an ephemeral loopback port
+socket_t Listen(int type, int& port) {
+    socket_t listener = socket(AF_INET, type, 0);
+    struct sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(listener, reinterpret_cast<struct sockaddr*>(&address), sizeof(address));
+    if (type == SOCK_STREAM) {
+        listen(listener, 1);
+    }
+
+    socklen_t length = sizeof(address);
+    getsockname(listener, reinterpret_cast<struct sockaddr*>(&address), &length);
+    port = ntohs(address.sin_port);
+    SetReceiveTimeout(listener, type == SOCK_STREAM ? 1000 : 300);
+    return listener;
+}
+
+// Datagrams that arrive until the socket stays quiet
+std::vector<std::string> ReceiveAll(socket_t receiver) {
+    std::vector<std::string> datagrams;
+    char buffer[65536];
+    for (;;) {
+        int received = static_cast<int>(recv(receiver, buffer, sizeof(buffer), 0));
+        if (received <= 0) {
+            return datagrams;
+        }
+        datagrams.push_back(std::string(buffer, static_cast<std::size_t>(received)));
+    }
+}
+
+std::string Between(const std::string& text, const std::string& open, const std::string& close) {
+    std::size_t start = text.find(open);
+    if (start == std::string::npos) {
+        return std::string();
+    }
+    start += open.size();
+    std::size_t end = text.find(close, start);
+    return end == std::string::npos ? std::string() : text.substr(start, end - start);
+}
+
+// A message of distinct lines, so a lost or repeated piece shows when chunks are joined
+std::string MakeMessage(std::size_t size) {
+    std::string message;
+    for (int i = 0; message.size() < size; i++) {
+        message += "line " + std::to_string(i) + ";";
+    }
+    message.resize(size);
+    return message;
+}
+
+void TestTruncateCountsRemovedBytes(bool xml) {
+    int port = 0;
+    socket_t receiver = Listen(SOCK_DGRAM, port);
+    Log2ConsoleUdpClient client({LogDestination("127.0.0.1", port)}, LogDistribution::Failover, xml);
+    client.SetMaxDatagramSize(400);
+    CHECK(client.Initialize());
+
+    std::string message = MakeMessage(3000);
+    client.Log(LogLevel::L_INFO, "Oversize", message);
+    std::vector<std::string> datagrams = ReceiveAll(receiver);
+    client.Cleanup();
+    closesocket_platform(receiver);
+
+    CHECK(datagrams.size() == 1);
+    if (datagrams.size() != 1) {
+        return;
+    }
+    const std::string& datagram = datagrams[0];
+    CHECK(datagram.size() <= 400);
+
+    // The kept part is a prefix of the message, and the marker counts exactly what is missing
+    std::size_t markerStart = datagram.find("... [truncated ");
+    CHECK(markerStart != std::string::npos);
+    std::size_t messageStart = xml ? datagram.find("<![CDATA[") + 9 : datagram.find("[Oversize] ") + 11;
+    std::string kept = datagram.substr(messageStart, markerStart - messageStart);
+    CHECK(message.compare(0, kept.size(), kept) == 0);
+    std::string removed = Between(datagram, "... [truncated ", " bytes]");
+    CHECK(removed == std::to_string(message.size() - kept.size()));
+
+    if (xml) {
+        CHECK(datagram.find("</log4j:event>") != std::string::npos);
+    } else {
+        CHECK(datagram.compare(datagram.size() - 2, 2, "\r\n") == 0);
+    }
+}
+
+void TestSplitChunksHaveOwnSequenceNumbers(std::size_t workers) {
+    int port = 0;
+    socket_t receiver = Listen(SOCK_DGRAM, port);
+    Log2ConsoleUdpClient client({LogDestination("127.0.0.1", port)}, LogDistribution::Failover, true);
+    client.SetMaxDatagramSize(600, LogOversizePolicy::Split);
+    client.SetFormattingWorkers(workers);
+    CHECK(client.Initialize());
+
+    std::string message = MakeMessage(5000);
+    client.Log(LogLevel::L_INFO, "Oversize", message);
+    client.Flush();
+    std::vector<std::string> datagrams = ReceiveAll(receiver);
+    client.SetFormattingWorkers(0);
+    client.Cleanup();
+    closesocket_platform(receiver);
+
+    CHECK(datagrams.size() > 1);
+    std::string joined;
+    std::set<std::string> sequenceNumbers;
+    for (std::size_t i = 0; i < datagrams.size(); i++) {
+        const std::string& datagram = datagrams[i];
+        CHECK(datagram.size() <= 600);
+
+        std::string label = "[" + std::to_string(i + 1) + "/" + std::to_string(datagrams.size()) + "] ";
+        std::string text = Between(datagram, "<![CDATA[", "]]>");
+        CHECK(text.compare(0, label.size(), label) == 0);
+        joined += text.substr(std::min(label.size(), text.size()));
+
+        std::string sequence = Between(datagram, "<nlog:eventSequenceNumber>", "</nlog:eventSequenceNumber>");
+        CHECK(!sequence.empty());
+        sequenceNumbers.insert(sequence);
+    }
+    CHECK(joined == message);
+    CHECK(sequenceNumbers.size() == datagrams.size());
+}
+
+void TestStreamDestinationIsNotLimited() {
+    // A TCP primary with a UDP standby: the limit only applies to the standby, which is not used
+    int tcpPort = 0;
+    int udpPort = 0;
+    socket_t listener = Listen(SOCK_STREAM, tcpPort);
+    socket_t receiver = Listen(SOCK_DGRAM, udpPort);
+    Log2ConsoleUdpClient client({LogDestination("127.0.0.1", tcpPort, LogTransport::Tcp),
+                                 LogDestination("127.0.0.1", udpPort)},
+                                LogDistribution::Failover, false);
+    client.SetMaxDatagramSize(400);
+    CHECK(client.Initialize());
+
+    socket_t connection = accept(listener, nullptr, nullptr);
+    CHECK(connection != INVALID_SOCKET_VALUE);
+    SetReceiveTimeout(connection, 1000);
+
+    std::string message = MakeMessage(3000);
+    client.Log(LogLevel::L_INFO, "Oversize", message);
+
+    std::string stream;
+    char buffer[4096];
+    while (stream.find("\r\n") == std::string::npos) {
+        int received = static_cast<int>(recv(connection, buffer, sizeof(buffer), 0));
+        if (received <= 0) {
+            break;
+        }
+        stream.append(buffer, static_cast<std::size_t>(received));
+    }
+    CHECK(stream.find(message + "\r\n") != std::string::npos);
+    CHECK(stream.find("[truncated") == std::string::npos);
+    CHECK(ReceiveAll(receiver).empty());
+
+    client.Cleanup();
+    closesocket_platform(connection);
+    closesocket_platform(listener);
+    closesocket_platform(receiver);
+}
+
+}
+
+int main() {
+    SocketPlatform::Initialize();
+
+    TestTruncateCountsRemovedBytes(false);
+    TestTruncateCountsRemovedBytes(true);
+    TestSplitChunksHaveOwnSequenceNumbers(0);
+    TestSplitChunksHaveOwnSequenceNumbers(1);
+    TestStreamDestinationIsNotLimited();
+
+    SocketPlatform::Cleanup();
+    if (g_failures > 0) {
+        std::fprintf(stderr, "%d check(s) failed\n", g_failures);
+        return EXIT_FAILURE;
+    }
+    std::printf("oversize_test: all checks passed\n");
+    return EXIT_SUCCESS;
+}
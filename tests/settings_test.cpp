@@ -0,0 +1,204 @@
+// Parsing of configuration keys: destinations, priority lanes, the datagram size limit, numbers
+// that do not fit their setting, and how errors are reported.
+
+#include "Log2ConsoleSettings.h"
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace {
+
+int g_failures = 0;
+
+void Check(bool condition, const char* what, int line) {
+    if (!condition) {
+        std::fprintf(stderr, "settings_test.cpp:%d: check failed: %s\n", line, what);
+        g_failures++;
+    }
+}
+
+#define CHECK(condition) Check((condition), #condition, __LINE__)
+
+// Settings with one key set; false if it was rejected
+bool SetOne(const std::string& key, const std::string& value, LogSettings& settings) {
+    std::string error;
+    bool valid = settings.Set(key, value, error);
+    CHECK(valid == error.empty());
+    return valid;
+}
+
+bool IsValid(const std::string& key, const std::string& value) {
+    LogSettings settings;
+    return SetOne(key, value, settings);
+}
+
+void TestDestinations() {
+    LogSettings settings;
+    CHECK(SetOne("destinations", "tcp://console-a:4505, console-b", settings));
+    CHECK(settings.destinations.present);
+    CHECK(settings.destinations.value.size() == 2);
+    if (settings.destinations.value.size() == 2) {
+        CHECK(settings.destinations.value[0] == LogDestination("console-a", 4505, LogTransport::Tcp));
+        CHECK(settings.destinations.value[1] == LogDestination("console-b", 4445, LogTransport::Udp));
+    }
+
+    // IPv6 literals need brackets to carry a port; a bare one keeps the default port
+    LogSettings ipv6;
+    CHECK(SetOne("destinations", "[::1]:4446; udp://[ff02::1]:5000, tcp://[fe80::1], 2001:db8::7", ipv6));
+    CHECK(ipv6.destinations.value.size() == 4);
+    if (ipv6.destinations.value.size() == 4) {
+        CHECK(ipv6.destinations.value[0] == LogDestination("::1", 4446));
+        CHECK(ipv6.destinations.value[1] == LogDestination("ff02::1", 5000));
+        CHECK(ipv6.destinations.value[2] == LogDestination("fe80::1", 4445, LogTransport::Tcp));
+        CHECK(ipv6.destinations.value[3] == LogDestination("2001:db8::7", 4445));
+    }
+
+    CHECK(!IsValid("destinations", "[::1"));
+    CHECK(!IsValid("destinations", "[::1]4445"));
+    CHECK(!IsValid("destinations", "[]:4445"));
+    CHECK(!IsValid("destinations", ""));
+
+    // Ports outside 1..65535 and ports that are not numbers
+    CHECK(!IsValid("destinations", "console:0"));
+    CHECK(!IsValid("destinations", "console:65536"));
+    CHECK(!IsValid("destinations", "console:70000"));
+    CHECK(!IsValid("destinations", "console:-1"));
+    CHECK(!IsValid("destinations", "console:http"));
+    CHECK(!IsValid("destinations", "console:4445x"));
+    CHECK(!IsValid("destinations", "console:"));
+    CHECK(!IsValid("destinations", "[::1]:"));
+    CHECK(!IsValid("destinations", "[::1]:99999999999999999999999"));
+    CHECK(IsValid("destinations", "console:65535"));
+
+    // One bad item rejects the whole list
+    LogSettings partial;
+    CHECK(!SetOne("destinations", "console-a, console-b:0", partial));
+    CHECK(!partial.destinations.present);
+}
+
+void TestLanes() {
+    LogSettings settings;
+    CHECK(SetOne("lane.low", "100 drop_newest 3", settings));
+    const LogSetting<LogPriorityLane>& low = settings.lanes[static_cast<std::size_t>(LogSeverityClass::Low)];
+    CHECK(low.present);
+    CHECK(low.value.capacity == 100);
+    CHECK(low.value.overflow == LogOverflowPolicy::DropNewest);
+    CHECK(low.value.weight == 3);
+    CHECK(!settings.lanes[static_cast<std::size_t>(LogSeverityClass::High)].present);
+
+    // What is left out keeps the default of the class
+    CHECK(SetOne("LANE.HIGH", "50", settings));
+    const LogSetting<LogPriorityLane>& high = settings.lanes[static_cast<std::size_t>(LogSeverityClass::High)];
+    CHECK(high.value.capacity == 50);
+    CHECK(high.value.overflow == LogPriorityLanes()[LogSeverityClass::High].overflow);
+    CHECK(high.value.weight == LogPriorityLanes()[LogSeverityClass::High].weight);
+
+    CHECK(SetOne("lane.normal", "8, drop_oldest", settings));
+    CHECK(settings.lanes[static_cast<std::size_t>(LogSeverityClass::Normal)].value.overflow ==
+          LogOverflowPolicy::DropOldest);
+
+    CHECK(!IsValid("lane.low", ""));
+    CHECK(!IsValid("lane.low", "0"));
+    CHECK(!IsValid("lane.low", "-5"));
+    CHECK(!IsValid("lane.low", "100 discard"));
+    CHECK(!IsValid("lane.low", "100 block 0"));
+    CHECK(!IsValid("lane.low", "100 block 4294967296"));
+    CHECK(!IsValid("lane.low", "100 block 1 extra"));
+    CHECK(!IsValid("lane.low", "99999999999999999999999"));
+    CHECK(!IsValid("lane.urgent", "100"));
+}
+
+void TestMaxDatagramSize() {
+    LogSettings plain;
+    CHECK(SetOne("max_datagram_size", "1472", plain));
+    CHECK(plain.maxDatagramSize.present && plain.maxDatagramSize.value == 1472);
+    CHECK(!plain.oversizePolicy.present);
+
+    LogSettings split;
+    CHECK(SetOne("max_datagram_size", "1200 split", split));
+    CHECK(split.maxDatagramSize.value == 1200);
+    CHECK(split.oversizePolicy.present && split.oversizePolicy.value == LogOversizePolicy::Split);
+
+    LogSettings truncate;
+    CHECK(SetOne("max_datagram_size", "9000, TRUNCATE", truncate));
+    CHECK(truncate.oversizePolicy.present && truncate.oversizePolicy.value == LogOversizePolicy::Truncate);
+
+    CHECK(!IsValid("max_datagram_size", ""));
+    CHECK(!IsValid("max_datagram_size", "0"));
+    CHECK(!IsValid("max_datagram_size", "split"));
+    CHECK(!IsValid("max_datagram_size", "1472 fragment"));
+    CHECK(!IsValid("max_datagram_size", "1472 split truncate"));
+    CHECK(!IsValid("max_datagram_size", "1472.5"));
+}
+
+void TestNumberRange() {
+    // Too large for unsigned long long, or for the setting's own type
+    CHECK(!IsValid("formatting_workers", "99999999999999999999"));
+    CHECK(!IsValid("collapse_repeats_ms", "4294967296"));
+    CHECK(!IsValid("flush.max_delay_us", "18446744073709551615"));
+    CHECK(!IsValid("resolve_interval_ms", "-1"));
+    CHECK(!IsValid("startup_buffer", "+5"));
+    CHECK(!IsValid("startup_buffer", " 5"));
+
+    LogSettings settings;
+    CHECK(SetOne("collapse_repeats_ms", "4294967295", settings));
+    CHECK(settings.collapseRepeatsMs.value == 4294967295u);
+    CHECK(SetOne("formatting_workers", "0", settings));
+    CHECK(settings.formattingWorkers.present && settings.formattingWorkers.value == 0);
+}
+
+void TestParse() {
+    std::string text =
+        "# comment line\n"
+        "level = info\n"
+        "level.Orders = DEBUG    # keeps its case\n"
+        "levels = Net=WARN, Orders=ERROR\n"
+        "max_datagram_size = 1472 fragment\n"
+        "no equals sign\n"
+        "\n"
+        "colour = blue\n"
+        "destinations = console:0\n";
+    LogSettings settings;
+    std::vector<std::string> errors;
+    CHECK(!settings.Parse(text, errors));
+    CHECK(errors.size() == 4);
+    if (errors.size() == 4) {
+        CHECK(errors[0] == "line 5: invalid value '1472 fragment' for 'max_datagram_size'");
+        CHECK(errors[1] == "line 6: expected 'key = value'");
+        CHECK(errors[2] == "line 8: unknown key 'colour'");
+        CHECK(errors[3] == "line 9: invalid value 'console:0' for 'destinations'");
+    }
+
+    // The valid lines still apply; a later line for the same category replaces the earlier one
+    CHECK(settings.minimumLevel.present && settings.minimumLevel.value == LogLevel::L_INFO);
+    CHECK(settings.categoryLevels.size() == 2);
+    if (settings.categoryLevels.size() == 2) {
+        CHECK(settings.categoryLevels[0].first == "Orders");
+        CHECK(settings.categoryLevels[0].second == LogLevel::L_ERROR);
+        CHECK(settings.categoryLevels[1].first == "Net");
+        CHECK(settings.categoryLevels[1].second == LogLevel::L_WARN);
+    }
+
+    LogSettings clean;
+    errors.clear();
+    CHECK(clean.Parse("destinations = [::1]:4445\r\nlane.low = 4096 drop_newest 1\r\n", errors));
+    CHECK(errors.empty());
+}
+
+}
+
+int main() {
+    TestDestinations();
+    TestLanes();
+    TestMaxDatagramSize();
+    TestNumberRange();
+    TestParse();
+
+    if (g_failures > 0) {
+        std::fprintf(stderr, "%d check(s) failed\n", g_failures);
+        return EXIT_FAILURE;
+    }
+    std::printf("settings_test: all checks passed\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,99 @@
+// A severe event waits until it was sent, but not inside the logger's read section: a console that
+// stops reading must not hold up SetCategoryLevel() and other snapshot writers. The console is a
+// TCP socket on the loopback interface that accepts but never reads.
+
+#include "Logger.h"
+#include "SocketPlatform.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+namespace {
+
+int g_failures = 0;
+
+void Check(bool condition, const char* what, int line) {
+    if (!condition) {
+        std::fprintf(stderr, "severe_flush_test.cpp:%d: check failed: %s\n", line, what);
+        g_failures++;
+    }
+}
+
+#define CHECK(condition) Check((condition), #condition, __LINE__)
+
+// Listener with a small receive buffer, so the sender's socket fills up quickly
+socket_t Listen(int& port) {
+    socket_t listener = socket(AF_INET, SOCK_STREAM, 0);
+    int size = 4096;
+    setsockopt(listener, SOL_SOCKET, SO_RCVBUF, reinterpret_cast<const char*>(&size), sizeof(size));
+    struct sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(listener, reinterpret_cast<struct sockaddr*>(&address), sizeof(address));
+    listen(listener, 1);
+
+    socklen_t length = sizeof(address);
+    getsockname(listener, reinterpret_cast<struct sockaddr*>(&address), &length);
+    port = ntohs(address.sin_port);
+    return listener;
+}
+
+long long MillisSince(std::chrono::steady_clock::time_point start) {
+    return static_cast<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start).count());
+}
+
+void TestSevereFlushDoesNotBlockWriters() {
+    int port = 0;
+    socket_t listener = Listen(port);
+    Logger& logger = Logger::GetInstance();
+    logger.SetFormattingWorkers(1);
+    CHECK(logger.Initialize({LogDestination("127.0.0.1", port, LogTransport::Tcp)}, LogDistribution::Failover, false));
+    socket_t connection = accept(listener, nullptr, nullptr);
+    CHECK(connection != INVALID_SOCKET_VALUE);
+
+    // More than the socket buffers hold: the worker ends up blocked in send() until its timeout
+    std::string payload(60000, 'x');
+    for (int i = 0; i < 200; i++) {
+        logger.Log(LogLevel::L_INFO, "Fill", payload);
+    }
+
+    std::atomic<bool> errorReturned{false};
+    std::thread severe([&]() {
+        logger.Log(LogLevel::L_ERROR, "Severe", "waits for the worker");
+        errorReturned.store(true);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    CHECK(!errorReturned.load());   // otherwise the worker never blocked and nothing is tested
+
+    auto start = std::chrono::steady_clock::now();
+    logger.SetCategoryLevel("Orders", LogLevel::L_DEBUG);
+    logger.ClearCategoryLevel("Orders");
+    long long elapsedMs = MillisSince(start);
+    CHECK(elapsedMs < 300);
+    CHECK(!errorReturned.load());
+
+    severe.join();
+    logger.Cleanup();
+    closesocket_platform(connection);
+    closesocket_platform(listener);
+}
+
+}
+
+int main() {
+    SocketPlatform::Initialize();
+
+    TestSevereFlushDoesNotBlockWriters();
+
+    SocketPlatform::Cleanup();
+    if (g_failures > 0) {
+        std::fprintf(stderr, "%d check(s) failed\n", g_failures);
+        return EXIT_FAILURE;
+    }
+    std::printf("severe_flush_test: all checks passed\n");
+    return EXIT_SUCCESS;
+}